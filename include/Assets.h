@@ -0,0 +1,126 @@
+// Generated by tools/png2rle.py - do not edit by hand.
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "RleImage.h"
+
+// 54x64, 16 colours, 788 bytes RLE (raw RGB565 would be 6912)
+static const uint16_t imgLogoPalette[] PROGMEM = {
+    0xFFFF, 0xFFDF, 0xCE5B, 0xCE3B, 0xC61B, 0xD923, 0xD69C, 0xF79E, 0xF7BF, 0xE71D, 0xBDDA, 0xBDBA, 0xC5FA, 0xD903, 0xEF5E, 0xB579};
+static const uint8_t imgLogoData[] PROGMEM = {
+    0x0F, 0x09, 0xC1, 0x53, 0x71, 0x0F, 0x03, 0x0F, 0x09, 0xC1, 0x53, 0x71, 0x0F, 0x03, 0x0F, 0x07,
+    0x31, 0x53, 0x71, 0x0F, 0x05, 0x0F, 0x07, 0x31, 0x53, 0x71, 0x0F, 0x05, 0x0F, 0x05, 0x71, 0x53,
+    0x91, 0x0F, 0x07, 0x0F, 0x05, 0x71, 0x53, 0x91, 0x0F, 0x07, 0x0F, 0x05, 0x31, 0x53, 0x71, 0x0F,
+    0x07, 0x0F, 0x05, 0x31, 0x53, 0x71, 0x0F, 0x07, 0x0F, 0x05, 0xF1, 0xD1, 0x51, 0x91, 0x0F, 0x07,
+    0x0F, 0x05, 0xF1, 0xD1, 0x51, 0x91, 0x0F, 0x07, 0x0F, 0x05, 0xF1, 0xD1, 0x51, 0xF1, 0x0F, 0x07,
+    0x0F, 0x05, 0xF1, 0xD1, 0x51, 0xF1, 0x0F, 0x07, 0x0F, 0x05, 0xF1, 0xD1, 0x53, 0x61, 0x0F, 0x05,
+    0x0F, 0x05, 0xF1, 0xD1, 0x53, 0x61, 0x0F, 0x05, 0x0F, 0x05, 0x61, 0x53, 0xD1, 0x51, 0x71, 0x0F,
+    0x03, 0x0F, 0x05, 0x61, 0x53, 0xD1, 0x51, 0x71, 0x0F, 0x03, 0x0F, 0x05, 0x11, 0xF1, 0x55, 0xC1,
+    0x0F, 0x03, 0x0F, 0x05, 0x11, 0xF1, 0x55, 0xC1, 0x0F, 0x03, 0x0F, 0x07, 0x71, 0x51, 0xD3, 0x51,
+    0x71, 0x0F, 0x01, 0x0F, 0x07, 0x71, 0x51, 0xD3, 0x51, 0x71, 0x0F, 0x01, 0x0F, 0x09, 0xC1, 0x55,
+    0x31, 0x0F, 0x01, 0x0F, 0x09, 0xC1, 0x55, 0x31, 0x0F, 0x01, 0x0F, 0x09, 0x91, 0x55, 0xC1, 0x0F,
+    0x01, 0x0F, 0x09, 0x91, 0x55, 0xC1, 0x0F, 0x01, 0x0F, 0x09, 0xC1, 0x55, 0x31, 0x0F, 0x01, 0x0F,
+    0x09, 0xC1, 0x55, 0x31, 0x0F, 0x01, 0x09, 0x11, 0xE1, 0x91, 0xE1, 0x11, 0x03, 0x91, 0x51, 0xD3,
+    0x51, 0x91, 0x13, 0x0D, 0x09, 0x11, 0xE1, 0x91, 0xE1, 0x11, 0x03, 0x91, 0x51, 0xD3, 0x51, 0x91,
+    0x13, 0x0D, 0x05, 0x11, 0x61, 0x31, 0x65, 0x31, 0x61, 0xC1, 0x51, 0xD1, 0x53, 0xF1, 0x27, 0x91,
+    0x11, 0x07, 0x05, 0x11, 0x61, 0x31, 0x65, 0x31, 0x61, 0xC1, 0x51, 0xD1, 0x53, 0xF1, 0x27, 0x91,
+    0x11, 0x07, 0x03, 0x81, 0x41, 0x91, 0x11, 0x05, 0x11, 0x91, 0xF9, 0xE1, 0x11, 0x03, 0x71, 0x61,
+    0x41, 0xE1, 0x05, 0x03, 0x81, 0x41, 0x91, 0x11, 0x05, 0x11, 0x91, 0xF9, 0xE1, 0x11, 0x03, 0x71,
+    0x61, 0x41, 0xE1, 0x05, 0x03, 0x21, 0x91, 0x0D, 0xE1, 0x21, 0xE1, 0x21, 0x0D, 0x71, 0x31, 0x91,
+    0x03, 0x03, 0x21, 0x91, 0x0D, 0xE1, 0x21, 0xE1, 0x21, 0x0D, 0x71, 0x31, 0x91, 0x03, 0x01, 0xE1,
+    0x21, 0x0F, 0x01, 0x21, 0xF1, 0x71, 0x0F, 0x11, 0x31, 0xE1, 0x01, 0x01, 0xE1, 0x21, 0x0F, 0x01,
+    0x21, 0xF1, 0x71, 0x0F, 0x11, 0x31, 0xE1, 0x01, 0x01, 0x93, 0x0F, 0x01, 0x61, 0xA1, 0x0F, 0x03,
+    0x71, 0x31, 0x11, 0x01, 0x93, 0x0F, 0x01, 0x61, 0xA1, 0x0F, 0x03, 0x71, 0x31, 0x11, 0x01, 0x61,
+    0xE1, 0x03, 0x71, 0x11, 0x01, 0x81, 0x91, 0xE1, 0x81, 0x15, 0x71, 0x81, 0x0D, 0x11, 0xC1, 0x91,
+    0x01, 0x61, 0xE1, 0x03, 0x71, 0x11, 0x01, 0x81, 0x91, 0xE1, 0x81, 0x15, 0x71, 0x81, 0x0D, 0x11,
+    0xC1, 0x91, 0x43, 0x21, 0x11, 0x01, 0x41, 0xF1, 0x31, 0x41, 0xB1, 0x43, 0x63, 0x41, 0xA1, 0xF1,
+    0xC1, 0x61, 0x43, 0x11, 0x01, 0x11, 0x41, 0xF3, 0x43, 0x21, 0x11, 0x01, 0x41, 0xF1, 0x31, 0x41,
+    0xB1, 0x43, 0x63, 0x41, 0xA1, 0xF1, 0xC1, 0x61, 0x43, 0x11, 0x01, 0x11, 0x41, 0xF3, 0xF3, 0xA1,
+    0x21, 0x13, 0x61, 0xB3, 0xA3, 0x91, 0x61, 0xA1, 0x61, 0x31, 0xC1, 0xA1, 0xF3, 0xE1, 0x01, 0x81,
+    0x31, 0xF3, 0xB1, 0xF3, 0xA1, 0x21, 0x13, 0x61, 0xB3, 0xA3, 0x91, 0x61, 0xA1, 0x61, 0x31, 0xC1,
+    0xA1, 0xF3, 0xE1, 0x01, 0x81, 0x31, 0xF3, 0xB1, 0x71, 0xF5, 0x21, 0x11, 0x01, 0x11, 0xE1, 0x91,
+    0x61, 0x21, 0x91, 0x61, 0x91, 0x31, 0x61, 0x91, 0xE1, 0x03, 0x71, 0xC1, 0xF3, 0x31, 0x01, 0x71,
+    0xF5, 0x21, 0x11, 0x01, 0x11, 0xE1, 0x91, 0x61, 0x21, 0x91, 0x61, 0x91, 0x31, 0x61, 0x91, 0xE1,
+    0x03, 0x71, 0xC1, 0xF3, 0x31, 0x01, 0x01, 0x71, 0xF3, 0xB1, 0x21, 0x11, 0x07, 0x61, 0x31, 0x21,
+    0x31, 0x81, 0x07, 0x71, 0xC1, 0xF3, 0x21, 0x03, 0x01, 0x71, 0xF3, 0xB1, 0x21, 0x11, 0x07, 0x61,
+    0x31, 0x21, 0x31, 0x81, 0x07, 0x71, 0xC1, 0xF3, 0x21, 0x03, 0x03, 0x81, 0xF3, 0x23, 0x11, 0x05,
+    0x91, 0x41, 0x23, 0x07, 0xE1, 0xF1, 0xB1, 0x61, 0x91, 0x05, 0x03, 0x81, 0xF3, 0x23, 0x11, 0x05,
+    0x91, 0x41, 0x23, 0x07, 0xE1, 0xF1, 0xB1, 0x61, 0x91, 0x05, 0x05, 0x71, 0x61, 0xF3, 0x21, 0x11,
+    0x03, 0x91, 0x41, 0x31, 0x21, 0x05, 0xE1, 0x41, 0xF3, 0x91, 0x07, 0x05, 0x71, 0x61, 0xF3, 0x21,
+    0x11, 0x03, 0x91, 0x41, 0x31, 0x21, 0x05, 0xE1, 0x41, 0xF3, 0x91, 0x07, 0x07, 0x11, 0xB1, 0xF1,
+    0xA1, 0x31, 0x81, 0x01, 0x91, 0x41, 0x31, 0x21, 0x03, 0x91, 0xF1, 0x31, 0x21, 0x61, 0x09, 0x07,
+    0x11, 0xB1, 0xF1, 0xA1, 0x31, 0x81, 0x01, 0x91, 0x41, 0x31, 0x21, 0x03, 0x91, 0xF1, 0x31, 0x21,
+    0x61, 0x09, 0x09, 0x11, 0xF3, 0xB1, 0x31, 0x81, 0xE1, 0xC1, 0x41, 0x21, 0x01, 0x91, 0xF5, 0x71,
+    0x0B, 0x09, 0x11, 0xF3, 0xB1, 0x31, 0x81, 0xE1, 0xC1, 0x41, 0x21, 0x01, 0x91, 0xF5, 0x71, 0x0B,
+    0x0B, 0x11, 0xF3, 0x23, 0xE1, 0x65, 0x91, 0xF5, 0x91, 0x0D, 0x0B, 0x11, 0xF3, 0x23, 0xE1, 0x65,
+    0x91, 0xF5, 0x91, 0x0D, 0x0D, 0x81, 0x61, 0xF1, 0xC1, 0x11, 0x03, 0x11, 0x61, 0xF3, 0xE1, 0x0F,
+    0x0D, 0x81, 0x61, 0xF1, 0xC1, 0x11, 0x03, 0x11, 0x61, 0xF3, 0xE1, 0x0F, 0x0F, 0x11, 0xF3, 0xA1,
+    0x41, 0x21, 0xB1, 0x91, 0x21, 0x71, 0x0F, 0x01, 0x0F, 0x11, 0xF3, 0xA1, 0x41, 0x21, 0xB1, 0x91,
+    0x21, 0x71, 0x0F, 0x01, 0x0F, 0x01, 0x81, 0xC3, 0xF5, 0x91, 0x0F, 0x05, 0x0F, 0x01, 0x81, 0xC3,
+    0xF5, 0x91, 0x0F, 0x05,
+};
+static const RleImage imgLogo PROGMEM = {54, 64, 16, imgLogoPalette, imgLogoData, sizeof(imgLogoData)};
+
+// 24x14, 2 colours, 60 bytes RLE (raw RGB565 would be 672)
+static const uint16_t imgBattery0Palette[] PROGMEM = {
+    0x001F, 0xFFFF};
+static const uint8_t imgBattery0Data[] PROGMEM = {
+    0x1F, 0x14, 0x02, 0x10, 0x0F, 0x02, 0x10, 0x02, 0x10, 0x0F, 0x02, 0x10, 0x02, 0x10, 0x0F, 0x02,
+    0x10, 0x02, 0x10, 0x0F, 0x02, 0x13, 0x10, 0x0F, 0x02, 0x13, 0x10, 0x0F, 0x02, 0x13, 0x10, 0x0F,
+    0x02, 0x13, 0x10, 0x0F, 0x02, 0x13, 0x10, 0x0F, 0x02, 0x13, 0x10, 0x0F, 0x02, 0x10, 0x02, 0x10,
+    0x0F, 0x02, 0x10, 0x02, 0x10, 0x0F, 0x02, 0x10, 0x02, 0x1F, 0x14, 0x02,
+};
+static const RleImage imgBattery0 PROGMEM = {24, 14, 2, imgBattery0Palette, imgBattery0Data, sizeof(imgBattery0Data)};
+
+// 24x14, 3 colours, 70 bytes RLE (raw RGB565 would be 672)
+static const uint16_t imgBattery1Palette[] PROGMEM = {
+    0x001F, 0xFFFF, 0xF800};
+static const uint8_t imgBattery1Data[] PROGMEM = {
+    0x1F, 0x14, 0x02, 0x10, 0x0F, 0x02, 0x10, 0x02, 0x10, 0x00, 0x24, 0x0C, 0x10, 0x02, 0x10, 0x00,
+    0x24, 0x0C, 0x10, 0x02, 0x10, 0x00, 0x24, 0x0C, 0x13, 0x10, 0x00, 0x24, 0x0C, 0x13, 0x10, 0x00,
+    0x24, 0x0C, 0x13, 0x10, 0x00, 0x24, 0x0C, 0x13, 0x10, 0x00, 0x24, 0x0C, 0x13, 0x10, 0x00, 0x24,
+    0x0C, 0x13, 0x10, 0x00, 0x24, 0x0C, 0x10, 0x02, 0x10, 0x00, 0x24, 0x0C, 0x10, 0x02, 0x10, 0x0F,
+    0x02, 0x10, 0x02, 0x1F, 0x14, 0x02,
+};
+static const RleImage imgBattery1 PROGMEM = {24, 14, 3, imgBattery1Palette, imgBattery1Data, sizeof(imgBattery1Data)};
+
+// 24x14, 3 colours, 90 bytes RLE (raw RGB565 would be 672)
+static const uint16_t imgBattery2Palette[] PROGMEM = {
+    0x001F, 0xFF00, 0xFFFF};
+static const uint8_t imgBattery2Data[] PROGMEM = {
+    0x2F, 0x24, 0x02, 0x20, 0x0F, 0x02, 0x20, 0x02, 0x20, 0x00, 0x14, 0x00, 0x14, 0x06, 0x20, 0x02,
+    0x20, 0x00, 0x14, 0x00, 0x14, 0x06, 0x20, 0x02, 0x20, 0x00, 0x14, 0x00, 0x14, 0x06, 0x23, 0x20,
+    0x00, 0x14, 0x00, 0x14, 0x06, 0x23, 0x20, 0x00, 0x14, 0x00, 0x14, 0x06, 0x23, 0x20, 0x00, 0x14,
+    0x00, 0x14, 0x06, 0x23, 0x20, 0x00, 0x14, 0x00, 0x14, 0x06, 0x23, 0x20, 0x00, 0x14, 0x00, 0x14,
+    0x06, 0x23, 0x20, 0x00, 0x14, 0x00, 0x14, 0x06, 0x20, 0x02, 0x20, 0x00, 0x14, 0x00, 0x14, 0x06,
+    0x20, 0x02, 0x20, 0x0F, 0x02, 0x20, 0x02, 0x2F, 0x24, 0x02,
+};
+static const RleImage imgBattery2 PROGMEM = {24, 14, 3, imgBattery2Palette, imgBattery2Data, sizeof(imgBattery2Data)};
+
+// 24x14, 3 colours, 110 bytes RLE (raw RGB565 would be 672)
+static const uint16_t imgBattery3Palette[] PROGMEM = {
+    0x07E0, 0x001F, 0xFFFF};
+static const uint8_t imgBattery3Data[] PROGMEM = {
+    0x2F, 0x24, 0x12, 0x20, 0x1F, 0x12, 0x20, 0x12, 0x20, 0x10, 0x04, 0x10, 0x04, 0x10, 0x04, 0x10,
+    0x20, 0x12, 0x20, 0x10, 0x04, 0x10, 0x04, 0x10, 0x04, 0x10, 0x20, 0x12, 0x20, 0x10, 0x04, 0x10,
+    0x04, 0x10, 0x04, 0x10, 0x23, 0x20, 0x10, 0x04, 0x10, 0x04, 0x10, 0x04, 0x10, 0x23, 0x20, 0x10,
+    0x04, 0x10, 0x04, 0x10, 0x04, 0x10, 0x23, 0x20, 0x10, 0x04, 0x10, 0x04, 0x10, 0x04, 0x10, 0x23,
+    0x20, 0x10, 0x04, 0x10, 0x04, 0x10, 0x04, 0x10, 0x23, 0x20, 0x10, 0x04, 0x10, 0x04, 0x10, 0x04,
+    0x10, 0x23, 0x20, 0x10, 0x04, 0x10, 0x04, 0x10, 0x04, 0x10, 0x20, 0x12, 0x20, 0x10, 0x04, 0x10,
+    0x04, 0x10, 0x04, 0x10, 0x20, 0x12, 0x20, 0x1F, 0x12, 0x20, 0x12, 0x2F, 0x24, 0x12,
+};
+static const RleImage imgBattery3 PROGMEM = {24, 14, 3, imgBattery3Palette, imgBattery3Data, sizeof(imgBattery3Data)};
+
+// 24x14, 3 colours, 70 bytes RLE (raw RGB565 would be 672)
+static const uint16_t imgBatteryExtPalette[] PROGMEM = {
+    0x001F, 0xFFFF, 0xFF00};
+static const uint8_t imgBatteryExtData[] PROGMEM = {
+    0x1F, 0x14, 0x02, 0x10, 0x0F, 0x02, 0x10, 0x02, 0x10, 0x09, 0x21, 0x06, 0x10, 0x02, 0x10, 0x08,
+    0x21, 0x07, 0x10, 0x02, 0x10, 0x08, 0x21, 0x07, 0x13, 0x10, 0x07, 0x21, 0x08, 0x13, 0x10, 0x07,
+    0x21, 0x08, 0x13, 0x10, 0x06, 0x25, 0x05, 0x13, 0x10, 0x09, 0x21, 0x06, 0x13, 0x10, 0x09, 0x21,
+    0x06, 0x13, 0x10, 0x08, 0x21, 0x07, 0x10, 0x02, 0x10, 0x08, 0x21, 0x07, 0x10, 0x02, 0x10, 0x0F,
+    0x02, 0x10, 0x02, 0x1F, 0x14, 0x02,
+};
+static const RleImage imgBatteryExt PROGMEM = {24, 14, 3, imgBatteryExtPalette, imgBatteryExtData, sizeof(imgBatteryExtData)};
+
+#endif
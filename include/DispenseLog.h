@@ -0,0 +1,42 @@
+#ifndef DISPENSE_LOG_H
+#define DISPENSE_LOG_H
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+#define DISPENSE_LOG_FILE "dispense.log"
+#define DISPENSE_LOG_RAM_RECORDS 8   // Records held in RAM between flushes (128 bytes)
+#define DISPENSE_LOG_IDLE_MS 5000    // Flush once nothing was logged for this long
+#define DISPENSE_LOG_VERSION 1
+
+// One record per dispensed tube. 16 bytes, so 32 records fill a 512-byte
+// sector exactly and no record ever straddles two sectors.
+struct DispenseLogRecord
+{
+  uint32_t timestamp;                // RTC unix time when the sequence finished
+  uint16_t sequence;                 // Record index in the file, wraps at 65536
+  uint16_t slotMinute;               // Scheduled slot, minutes since midnight
+  uint16_t latency;                  // Motor on to first pill, ms (saturates)
+  uint8_t tube;                      // 1-4, 0 for an unknown tube name
+  uint8_t pillsWanted;
+  uint8_t pillsSeen;
+  uint8_t outcome;                   // DISPENSE_* from Dispenser.h
+  uint8_t version;
+  uint8_t check;                     // XOR of the preceding 15 bytes
+};
+
+/*
+ * Binary append-only dispense log on the SD card.
+ *
+ * dispenseLogAdd() only copies the record into a RAM ring, so logging
+ * costs the dispense sequence nothing. The caller flushes the ring from
+ * loop() when the SD bus is free and the device is idle; all pending
+ * records go out in one append. If the ring fills before a flush (no
+ * card), the oldest records are dropped.
+ */
+bool dispenseLogBegin(SdFat &sd);    // Picks up the sequence and repairs a torn tail
+void dispenseLogAdd(DispenseLogRecord &record);
+bool dispenseLogFlushDue();
+bool dispenseLogFlush(SdFat &sd);    // Caller selects the SD card first
+
+#endif
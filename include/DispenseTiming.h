@@ -0,0 +1,33 @@
+#ifndef DISPENSE_TIMING_H
+#define DISPENSE_TIMING_H
+
+#include <Arduino.h>
+
+#define TIMING_TUBES 4
+#define TIMING_BUCKETS 12            // Motor-on to beam-break latency classes, see timingBucketEnd
+#define TIMING_MIN_SAMPLES 8         // Keep the fixed windows until a tube has this much history
+#define TIMING_STABILIZE_MIN_MS 200  // Never trust the beam sooner than this after motor start
+#define TIMING_TIMEOUT_MIN_MS 4000   // Shortest adaptive timeout
+#define TIMING_JAM_STREAK 2          // Misses in a row before a tube without history is treated as jammed
+#define TIMING_JAM_PROBE_MS 5000     // Feed window for a jammed tube
+
+/*
+ * Per-tube dispense timing learned from the beam sensor.
+ *
+ * Every detected pill adds its latency to a small histogram per tube, kept
+ * in EEPROM. Once a tube has enough samples the stabilize window shrinks to
+ * just under its fastest typical pill (5th percentile) and the timeout to
+ * twice its slow typical pill (95th percentile). A tube with that history
+ * that misses its window is reported jammed straight away; one without
+ * it is after a second miss in a row. Attempts after two misses only
+ * probe the tube briefly until a pill comes out again.
+ */
+void timingBegin();
+void timingRecord(uint8_t tube, bool detected, unsigned long latency);
+unsigned int timingStabilizeMs(uint8_t tube);
+unsigned int timingTimeoutMs(uint8_t tube);
+bool timingJamSuspected(uint8_t tube);
+void timingSave();                   // Writes changed bytes only
+void timingPrint();
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef DISPENSER_H
+#define DISPENSER_H
+
+#include <Arduino.h>
+#include <Servo.h>
+#include "MotorDrive.h"
+
+#define DISPENSE_MAX_JOBS 4          // Tubes in one dispensing sequence
+#define MAX_ACTIVE_ACTUATORS 2       // Servos moving + motors running at once (supply budget)
+
+#define SERVO_STANDBY_POS 91
+#define SERVO_OPEN_POS 55
+#define SERVO_CLOSE_POS 125
+#define SERVO_SLEW_US 60             // Max pulse change per 20 ms servo frame while ramping
+#define SERVO_ACCEL_US 20            // Pulse change added to the slew rate per frame
+#define SERVO_GATE_HOLD_MS 420       // Full-speed hold between the ramps; ~ the old 600 ms flat drive
+
+#define STABILIZE_DELAY 500          // Default for ignoring the beam after the motor starts
+#define DISPENSE_TIMEOUT_MS 30000    // Default for giving up on a tube without detection
+#define BEAM_GAP_MS 300              // Beam must stay free this long between two tubes
+#define DISPENSE_MAX_PILLS 9         // Most pills fed in one motor run
+#define PILL_DEBOUNCE_MS 15          // Beam must stay clear this long before the next pill can count
+#define PILL_MIN_GAP_MS 80           // Edges closer than this to the last pill are the same pill
+
+struct TubeMapping
+{
+  char tubeName[8];
+  int servoIndex;
+  int motorPin;
+  Servo *servo;
+  MotorProfile motor;
+};
+
+// Job phases, in the order a tube goes through them
+#define PHASE_WAITING 0   // Queued, waiting for an actuator slot to open the gate
+#define PHASE_OPENING 1   // Servo opening the gate
+#define PHASE_READY 2     // Gate open, waiting for the beam
+#define PHASE_FEEDING 3   // Motor running, owns the beam
+#define PHASE_CLOSING 4   // Servo closing the gate
+#define PHASE_DONE 5
+
+#define DISPENSE_PENDING 0
+#define DISPENSE_OK 1
+#define DISPENSE_TIMEOUT 2
+#define DISPENSE_UNKNOWN_TUBE 3
+#define DISPENSE_JAMMED 4             // Timed out on a tube that already missed repeatedly
+#define DISPENSE_MISSED 5             // Log only: the dose was never taken within its grace window
+
+struct DispenseJob
+{
+  TubeMapping *tube;
+  uint8_t phase;
+  uint8_t outcome;
+  unsigned long phaseStart;
+  unsigned long latency;     // Motor on to first beam break, ms
+  unsigned int stabilizeMs;  // Feed windows for this tube, from DispenseTiming
+  unsigned int timeoutMs;
+  uint8_t pillsWanted;
+  uint8_t pillsSeen;
+  unsigned long lastPillAt;
+};
+
+/*
+ * Actuator scheduler for a dispensing sequence.
+ *
+ * Tubes are independent except for the single drop beam, so each queued
+ * tube runs its own open -> feed -> close phases and the scheduler overlaps
+ * them: the next gate opens while the current motor feeds, and a finished
+ * gate closes while the next motor starts. Only the feed window, where a
+ * beam break is attributed to the running motor, is serialized, in queue
+ * order. MAX_ACTIVE_ACTUATORS caps how many servos and motors draw current
+ * at the same time; dispenserSetActuatorLimit(1) moves one actuator at a
+ * time, which is the sequential baseline the scheduler is measured against.
+ *
+ * The feed windows of each tube adapt to its history, see DispenseTiming.h.
+ * A job for N pills keeps its motor running and counts beam edges until N
+ * pills have passed.
+ */
+void dispenserBegin(TubeMapping *tubes, uint8_t tubeCount, uint8_t beamPin);
+void dispenserSetActuatorLimit(uint8_t limit);
+TubeMapping *getTubeMapping(const char *tubeName);
+
+void dispenserReset();
+bool dispenserQueue(const char *tubeName, uint8_t pills = 1);
+bool dispenserUpdate();              // Advances all jobs, returns true while any is unfinished
+bool dispenserBusy();
+void runDispenseSequence();          // Blocks until every queued job is finished
+
+uint8_t dispenserJobCount();
+const DispenseJob *dispenserJob(uint8_t index);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef DOSE_STATE_H
+#define DOSE_STATE_H
+
+#include <Arduino.h>
+
+#define DOSE_SLOTS 16                // Hash table size, power of two above MAX_GROUPED
+#define DOSE_GRACE_MIN 60            // A dose can still be taken this long after its time
+#define DOSE_RENOTIFY_MS 900000UL    // Re-raise a notification this long after its auto-dismiss
+
+#define DOSE_NONE 0                  // No dose at this minute
+#define DOSE_PENDING 1               // Upcoming, or due and not yet announced
+#define DOSE_NOTIFIED 2              // Announced, waiting for DROP
+#define DOSE_DISPENSED 3
+#define DOSE_MISSED 4                // Grace window ran out
+
+/*
+ * Per-dose state table keyed by minute of day.
+ *
+ * Each daily slot is an entry in a small open-addressed hash table, so
+ * looking a slot up by minute is O(1). An entry remembers which day's
+ * occurrence its state belongs to; when the clock reaches the next
+ * occurrence the entry starts over as pending. That also covers a grace
+ * window running past midnight and resets that skip whole days.
+ *
+ * The table is saved to EEPROM on every state change, so a dose that was
+ * taken before a reset is not dispensed again, a dose announced but not
+ * taken is announced again straight after the reset, and a dose whose
+ * time passed while the device was off is still offered inside its grace
+ * window.
+ */
+void doseBegin();                    // Loads saved states, call before the schedule is loaded
+void doseClear();
+void doseAddSlot(uint16_t minute, uint8_t group);
+void doseCommit();                   // Finishes a rebuild, keeping saved states of unchanged slots
+
+uint16_t doseUpdate(uint16_t day, uint16_t minute); // Returns a bitmask of groups that just became missed
+int8_t doseDueGroup();               // Oldest dose inside its window and not taken, -1 if none
+uint8_t doseState(uint8_t group);
+void doseNotified(uint8_t group);
+void doseDispensed(uint8_t group);
+
+#endif
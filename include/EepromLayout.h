@@ -0,0 +1,20 @@
+#ifndef EEPROM_LAYOUT_H
+#define EEPROM_LAYOUT_H
+
+/*
+ * Fixed EEPROM map (ATmega2560, 4096 bytes). Each region starts with its
+ * own magic and version byte, so changing one module's record format only
+ * resets that module's data. Keep regions in address order.
+ */
+#define EEPROM_TIMING_ADDR 0         // DispenseTiming: latency histograms
+#define EEPROM_TIMING_SIZE 64
+
+#define EEPROM_INVENTORY_ADDR 64     // Inventory: wear-levelled ring of stock snapshots
+#define EEPROM_INVENTORY_SLOTS 32
+#define EEPROM_INVENTORY_SLOT_SIZE 12
+#define EEPROM_INVENTORY_SIZE (EEPROM_INVENTORY_SLOTS * EEPROM_INVENTORY_SLOT_SIZE)
+
+#define EEPROM_DOSE_ADDR 448         // DoseState: today's dose states by slot
+#define EEPROM_DOSE_SIZE 128
+
+#endif
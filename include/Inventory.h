@@ -0,0 +1,33 @@
+#ifndef INVENTORY_H
+#define INVENTORY_H
+
+#include <Arduino.h>
+
+#define INVENTORY_TUBES 4
+#define INVENTORY_LOW_DAYS 7         // Warn when a tube lasts fewer days than this
+#define INVENTORY_NO_USE 0xFFFF      // Days remaining for a tube the schedule never uses, or of unknown stock
+#define INVENTORY_UNKNOWN 0xFFFF     // Stock of a tube never filled through tube setup
+
+/*
+ * Live pill stock per tube.
+ *
+ * Stock is set when a tube is filled during tube setup and decremented by
+ * the pills the beam actually counted. Until then it is INVENTORY_UNKNOWN,
+ * which never counts as low. Each change is saved as a new
+ * snapshot in a ring of EEPROM slots (sequence numbered, newest wins), so
+ * the cells wear EEPROM_INVENTORY_SLOTS times slower than rewriting one
+ * record. Daily use per tube comes from the grouped schedule and is only
+ * recomputed when the schedule changes; days remaining and the low-stock
+ * mask are cached, so a redraw just reads them.
+ */
+void inventoryBegin();
+void inventorySetStock(uint8_t tube, uint16_t pills);
+void inventoryConsume(uint8_t tube, uint8_t pills);
+void inventoryClearUse();
+void inventoryAddUse(uint8_t tube, uint8_t pillsPerDay);
+void inventoryCommit();              // Recomputes the cache and saves a snapshot if stock changed
+
+uint16_t inventoryDaysLeft(uint8_t tube);
+uint8_t inventoryLowMask();          // Bit n set when tube n+1 is low
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef MOTOR_DRIVE_H
+#define MOTOR_DRIVE_H
+
+#include <Arduino.h>
+
+#ifndef MOTOR_PWM
+#define MOTOR_PWM 0                  // 1: driver inputs rewired to PWM pins (env megaatmega2560_pwm), 0: on/off on 22-28
+#endif
+#define MOTOR_MAX 4
+#define MOTOR_BRAKE_MS 60            // Brake input held this long after a stop
+
+struct MotorProfile
+{
+  uint8_t startDuty;                 // Duty at motor on, 0-255
+  uint8_t runDuty;                   // Duty reached at the end of the ramp
+  uint8_t coastDuty;                 // Slower duty between pills of one dose
+  uint16_t rampMs;                   // startDuty -> runDuty
+  int8_t brakePin;                   // Driver brake input, -1 if the driver has none
+};
+
+#define MOTOR_PROFILE_DEFAULT {90, 200, 140, 250, -1}
+
+/*
+ * Feed motor control. With MOTOR_PWM (env megaatmega2560_pwm, driver
+ * inputs rewired to the timer 3 / timer 1 pins; timer 5 stays with the
+ * servos) a started motor ramps up linearly and drops to a coast duty
+ * between pills of one dose. The default build keeps the on/off pins
+ * 22-28: motors start at full speed and there is no soft start.
+ *
+ * Stopping is a power cut issued by the dispenser's poll loop when it
+ * counts the last pill; the beam pin has no interrupt to start it any
+ * sooner. There is no ramp-down, since a motor still turning feeds the
+ * next pill. A profile may name a driver brake input, held for
+ * MOTOR_BRAKE_MS after the stop, but the current driver has none and
+ * every tube uses MOTOR_PROFILE_DEFAULT until profiles are tuned on the
+ * hardware. motorUpdate() advances ramps and releases brakes and must
+ * be polled while motors run.
+ */
+void motorAttach(uint8_t motor, uint8_t pin, const MotorProfile *profile);
+void motorStart(uint8_t motor);
+void motorCoast(uint8_t motor);
+void motorStop(uint8_t motor);
+void motorUpdate();
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef RLEIMAGE_H
+#define RLEIMAGE_H
+
+#include <Arduino.h>
+#include <Adafruit_SPITFT.h>
+
+/*
+ * Palette-indexed, run-length encoded bitmap produced by tools/png2rle.py.
+ * Each data byte is one run: palette index in the high nibble, run length
+ * minus one in the low nibble. Runs never cross a row, so images are decoded
+ * top to bottom straight into the display's address window. Decoding needs
+ * only the 16-entry palette in RAM, whatever the image size. Images that run
+ * off the screen are clipped row by row.
+ */
+struct RleImage
+{
+  uint16_t width;
+  uint16_t height;
+  uint8_t paletteSize;
+  const uint16_t *palette; // PROGMEM, RGB565
+  const uint8_t *data;     // PROGMEM
+  uint16_t dataSize;
+};
+
+#define RLE_MAX_PALETTE 16
+
+bool drawRleImage(Adafruit_SPITFT &tft, int16_t x, int16_t y, const RleImage *image);
+uint16_t rleImageWidth(const RleImage *image);
+uint16_t rleImageHeight(const RleImage *image);
+
+#endif
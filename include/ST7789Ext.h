@@ -0,0 +1,47 @@
+#ifndef ST7789EXT_H
+#define ST7789EXT_H
+
+#include <Adafruit_ST7789.h>
+
+// ST7789 commands the Adafruit driver does not wrap
+#define ST7789_PTLON 0x12   // Partial display mode on
+#define ST7789_NORON 0x13   // Normal display mode on
+#define ST7789_PTLAR 0x30   // Partial area
+#define ST7789_IDMOFF 0x38  // Idle mode off
+#define ST7789_IDMON 0x39   // Idle mode on (8 colours, reduced frame rate)
+
+#define ST7789_MEMORY_ROWS 320 // Frame memory height, independent of the glass
+
+/*
+ * Adafruit_ST7789 with the controller's partial display and idle modes
+ * exposed, for night mode.
+ *
+ * Partial areas are addressed in panel rows: 0 is the first
+ * visible gate line of the glass and (panelRows() - 1) the last. The gate
+ * lines run along the screen's y axis in rotations 0/2 and along its x axis
+ * in rotations 1/3; panelRowsForScreenSpan() converts a span of screen
+ * coordinates on that axis into panel rows for the current rotation.
+ */
+class ST7789Ext : public Adafruit_ST7789
+{
+public:
+  ST7789Ext(int8_t cs, int8_t dc, int8_t rst);
+
+  void init(uint16_t width, uint16_t height, uint8_t spiMode = SPI_MODE0);
+
+  uint16_t panelRows() const { return nativeHeight; }
+  bool scrollAxisIsScreenY() const { return (getRotation() & 1) == 0; }
+  bool panelRowsForScreenSpan(int16_t pos, int16_t len, uint16_t &firstRow, uint16_t &lastRow) const;
+
+  void setPartialArea(uint16_t firstRow, uint16_t lastRow);
+  void enablePartialMode(bool enable);
+  void enableIdleMode(bool enable);
+
+private:
+  void writeRowPair(uint8_t command, uint16_t first, uint16_t second);
+
+  uint16_t nativeHeight;
+  uint16_t rowOffset;   // Frame memory rows above the first visible row
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef SCHEDULE_FORMAT_H
+#define SCHEDULE_FORMAT_H
+
+#include <Arduino.h>
+
+#define SCHEDULE_BIN_FILE "data.bin"
+#define SCHEDULE_JSON_FILE "data.json"
+#define SCHEDULE_MAGIC "PDS"
+#define SCHEDULE_VERSION 1
+#define SCHEDULE_TEXT_FLAG 0x80      // Coded byte is followed by (b & 0x7F) bytes of text
+#define SCHEDULE_NEW_FILE "data.new" // data.bin rewritten after edits, renamed into place
+
+// Delta operations, identified by tube (one medication per tube)
+#define SCHEDULE_OP_BASE 0           // fingerprint(LE16) the edits were made against
+#define SCHEDULE_OP_ADD_TIME 1       // tube amount name minute dosage
+#define SCHEDULE_OP_REMOVE_TIME 2    // tube minute
+#define SCHEDULE_OP_MODIFY_TIME 3    // tube minute newMinute dosage
+#define SCHEDULE_OP_REMOVE_MED 4     // tube
+#define SCHEDULE_OP_MODIFY_MED 5     // tube amount name
+
+// scheduleApplyDelta() results
+#define SCHEDULE_DELTA_OK 0
+#define SCHEDULE_DELTA_REFILL 1      // Applied; the tube now holds a different medication or amount
+#define SCHEDULE_DELTA_NOT_FOUND 2
+#define SCHEDULE_DELTA_FULL 3
+#define SCHEDULE_DELTA_MALFORMED 4
+
+struct MedicationTime
+{
+  char time[6];
+  char dosage[16];
+  char medication[24];
+  char tube[8];
+  int amount;
+  uint8_t pills;
+};
+
+/*
+ * Binary schedule written by the desktop app (src/schedule_format.py),
+ * saved as data.bin and decoded straight into MedicationTime.
+ *
+ *   "PDS" version medCount
+ *   per medication:
+ *     tube     coded: n -> "tube<n>", else inline text
+ *     amount   uint16 LE
+ *     nameLen name[nameLen]
+ *     timeCount
+ *     per time:
+ *       minute   uint16 LE, minutes since midnight
+ *       dosage   coded: n -> "n tablet(s)" and n pills, else inline text
+ *
+ * A "coded" byte below SCHEDULE_TEXT_FLAG is a number; with the flag set
+ * its low 7 bits are the length of text that follows. Text longer than
+ * the MedicationTime field is truncated.
+ */
+struct ScheduleDelta
+{
+  uint8_t op;
+  char tube[8];
+  uint16_t amount;
+  char name[24];
+  uint16_t minute;                   // OP_BASE: the fingerprint
+  uint16_t newMinute;
+  char dosage[16];
+};
+
+uint8_t parseDosagePills(const char *dosage);
+bool scheduleIsBinary(const uint8_t *head, uint8_t len);   // First bytes of a file carry the magic
+int scheduleDecode(Stream &in, MedicationTime *out, int maxCount); // Entries decoded, -1 if malformed
+
+/*
+ * Edits sent by the app instead of a whole new schedule. Each operation
+ * is applied to the MedicationTime table in place; the caller regroups
+ * and persists once a batch is complete. scheduleEncode() writes the
+ * table back out in the format above, and scheduleFingerprint() is the
+ * CRC of that encoding, which the app quotes in OP_BASE so edits made
+ * against a schedule the device no longer has are refused.
+ */
+bool scheduleReadDelta(const uint8_t *data, uint8_t len, ScheduleDelta &delta);
+uint8_t scheduleApplyDelta(const ScheduleDelta &delta, MedicationTime *table, int &count, int maxCount);
+void scheduleEncode(Print &out, const MedicationTime *table, int count);
+uint16_t scheduleFingerprint(const MedicationTime *table, int count);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef STAGE_TRACE_H
+#define STAGE_TRACE_H
+
+#include <Arduino.h>
+
+#define STAGE_RECEIVE 0              // Start of an upload or edit batch to its last byte
+#define STAGE_SAVE 1                 // Writing, syncing and renaming schedule files on SD
+#define STAGE_LOAD 2                 // Parsing the schedule file into MedicationTime
+#define STAGE_REGROUP 3              // Grouping by time, dose order, inventory and dose tables
+#define STAGE_COUNT 4
+
+/*
+ * Marks around the stages a new schedule goes through, for the host
+ * emulator (tools/firmware_emu), which builds with FIRMWARE_EMU and
+ * reports how long each one took. On the Mega they compile to nothing.
+ * A stage may be entered several times per upload; the times add up.
+ */
+#ifdef FIRMWARE_EMU
+void stageBegin(uint8_t stage);
+void stageEnd(uint8_t stage);
+#else
+inline void stageBegin(uint8_t) {}
+inline void stageEnd(uint8_t) {}
+#endif
+
+// Covers the rest of the enclosing block, for functions with many returns
+struct StageScope
+{
+  explicit StageScope(uint8_t stage) : stage(stage) { stageBegin(stage); }
+  ~StageScope() { stageEnd(stage); }
+  uint8_t stage;
+};
+
+#endif
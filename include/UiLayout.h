@@ -0,0 +1,61 @@
+#ifndef UILAYOUT_H
+#define UILAYOUT_H
+
+#include <Arduino.h>
+#include <Adafruit_SPITFT.h>
+#include "RleImage.h"
+
+// Layout opcodes
+#define UI_END 0        // Terminates a layout table
+#define UI_TEXT 1       // Print text at (x, y) with size and color
+#define UI_FILL_RECT 2  // Filled rectangle (x, y, w, h, color)
+#define UI_DRAW_RECT 3  // Rectangle outline (x, y, w, h, color)
+#define UI_FILL_ROUND 4 // Filled rounded rectangle, radius in size
+#define UI_DRAW_ROUND 5 // Rounded rectangle outline, radius in size
+#define UI_IMAGE 6      // RLE image at (x, y)
+
+/*
+ * One entry of a screen layout. Layout tables live in PROGMEM and are read
+ * entry by entry, so a screen costs no SRAM beyond a single UiElement on
+ * the stack while it is drawn. Coordinates are relative to the origin given
+ * to drawLayout().
+ */
+struct UiElement
+{
+  uint8_t op;
+  uint8_t size;      // Text size, or corner radius for rounded rectangles
+  int16_t x, y;
+  int16_t w, h;
+  uint16_t color;
+  const void *ref;   // PROGMEM string for UI_TEXT, RleImage for UI_IMAGE
+};
+
+struct UiRect
+{
+  int16_t x, y, w, h;
+};
+
+/*
+ * Where something drawn at run time goes: a clock, a count, a medication
+ * name. useAnchor() sets the text size, color and cursor (relative to the
+ * origin, like drawLayout()) and the caller prints; it returns the anchor
+ * for callers that step from it or draw an image there.
+ */
+struct UiAnchor
+{
+  int16_t x, y;
+  uint8_t size;
+  uint16_t color;
+};
+
+#define UI_TEXT_AT(x, y, size, color, text) {UI_TEXT, size, x, y, 0, 0, color, text}
+#define UI_RECT(op, x, y, w, h, color) {op, 0, x, y, w, h, color, nullptr}
+#define UI_ROUND(op, x, y, w, h, r, color) {op, r, x, y, w, h, color, nullptr}
+#define UI_IMAGE_AT(x, y, image) {UI_IMAGE, 0, x, y, 0, 0, 0, &(image)}
+#define UI_LAYOUT_END {UI_END, 0, 0, 0, 0, 0, 0, nullptr}
+
+void drawLayout(Adafruit_SPITFT &gfx, const UiElement *layout, int16_t originX = 0, int16_t originY = 0);
+UiRect readRect(const UiRect *rect);
+UiAnchor useAnchor(Adafruit_SPITFT &gfx, const UiAnchor *anchor, int16_t originX = 0, int16_t originY = 0);
+
+#endif
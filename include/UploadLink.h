@@ -0,0 +1,97 @@
+#ifndef UPLOAD_LINK_H
+#define UPLOAD_LINK_H
+
+#include <Arduino.h>
+
+#define LINK_SOF 0xA5
+#define LINK_MAX_PAYLOAD 64          // Data bytes per frame; a frame is payload + 7
+#define LINK_IDLE_MS 5000            // Session suspended after this much silence
+#define LINK_MAX_CHUNKS 256          // Largest file is LINK_MAX_CHUNKS * chunk size
+#define LINK_MAP_BYTES (LINK_MAX_CHUNKS / 8)
+#define LINK_MAP_SAVE_EVERY 8        // Chunks between resume map writes
+#define LINK_MAP_FILE "data.map"     // Resume map kept next to data.tmp
+#define LINK_MAP_VERSION 1
+
+// Host -> device
+#define LINK_FRAME_BEGIN 0x01        // payload: uint32 size, uint16 file CRC, uint8 chunk size
+#define LINK_FRAME_DATA 0x02         // seq = chunk index, payload = bytes at seq * chunk size
+#define LINK_FRAME_END 0x03
+#define LINK_FRAME_ABORT 0x04
+#define LINK_FRAME_DELTA 0x05        // seq = index in the edit batch, payload = one ScheduleFormat op
+
+// Device -> host
+#define LINK_FRAME_ACK 0x81          // seq = first missing chunk; answer to BEGIN carries a LinkResume
+#define LINK_FRAME_NAK 0x82          // seq = first missing chunk, resend from there
+#define LINK_FRAME_DONE 0x83         // payload: LINK_STATUS_* byte, schedule fingerprint (LE16)
+
+#define LINK_STATUS_OK 0
+#define LINK_STATUS_BAD_FILE 1       // Size or whole-file CRC mismatch
+#define LINK_STATUS_SD_ERROR 2
+#define LINK_STATUS_BAD_SCHEDULE 3   // Saved but loadScheduleData() rejected it
+#define LINK_STATUS_STALE 4          // Edits were made against a schedule the device doesn't have
+#define LINK_STATUS_REJECTED 5       // An edit did not apply (unknown tube or time, table full)
+
+struct LinkFrame
+{
+  uint8_t type;
+  uint16_t seq;
+  uint8_t len;
+  uint8_t payload[LINK_MAX_PAYLOAD];
+};
+
+// Which chunks of an upload are already on the card. Written to
+// LINK_MAP_FILE so an upload cut off by a dropped link can carry on.
+struct LinkResumeMap
+{
+  uint32_t fileSize;
+  uint16_t fileCrc;
+  uint8_t chunkSize;
+  uint8_t version;
+  uint8_t chunks[LINK_MAP_BYTES];    // Bit n set once chunk n is on the card
+};
+
+// Payload of the ACK answering BEGIN
+struct LinkResume
+{
+  uint32_t offset;                   // First byte the device still needs
+  uint8_t chunks[LINK_MAP_BYTES];    // Copy of LinkResumeMap::chunks
+};
+
+/*
+ * Framed binary upload protocol on Serial1.
+ *
+ * Frame: SOF, type, seq (LE16), len, payload[len], CRC16 (LE16).
+ * The CRC is CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over
+ * type..payload, the same as Python's binascii.crc_hqx(data, 0xFFFF).
+ *
+ * The sender keeps several data frames in flight and sizes the window
+ * itself (see dispenser_link.py); the device sets no limit. It writes
+ * each chunk at its own offset in data.tmp, marks it in the resume map
+ * and acknowledges with the first chunk it is still missing;
+ * the first frame that arrives beyond a gap also draws a NAK so the
+ * sender goes back to the hole instead of waiting for its timeout.
+ * Frames with a bad CRC are dropped silently.
+ *
+ * A link that goes quiet only suspends the upload: data.tmp and the
+ * map stay on the card, and a later BEGIN for the same size, CRC and
+ * chunk size is answered with the map so the sender sends only the gaps.
+ *
+ * Small edits skip the file transfer: DELTA frames, numbered from 0 and
+ * sent one at a time, each carry one schedule operation, starting with
+ * OP_BASE. END saves the batch; a batch rejected part way, or one that
+ * goes quiet or is followed by a new BASE or BEGIN before its END, is
+ * undone. DONE always carries the fingerprint of the schedule the device
+ * now holds, which the app quotes next time.
+ */
+uint16_t linkCrc16(uint16_t crc, const uint8_t *data, uint16_t len);
+void linkReset();                    // Discards a partially parsed frame
+bool linkFeed(uint8_t c, LinkFrame &frame); // True when frame holds a complete, valid frame
+void linkMapClear(LinkResumeMap &map, uint32_t fileSize, uint16_t fileCrc, uint8_t chunkSize);
+bool linkMapMatches(const LinkResumeMap &map, uint32_t fileSize, uint16_t fileCrc, uint8_t chunkSize);
+uint16_t linkMapChunkCount(const LinkResumeMap &map);
+bool linkMapHas(const LinkResumeMap &map, uint16_t chunk);
+void linkMapMark(LinkResumeMap &map, uint16_t chunk);
+uint16_t linkMapFirstMissing(const LinkResumeMap &map, uint16_t from = 0);
+void linkSend(Stream &port, uint8_t type, uint16_t seq, const uint8_t *payload = nullptr, uint8_t len = 0);
+
+#endif
@@ -107,6 +107,10 @@ typedef struct {
   volatile unsigned int ticks;
 } servo_t;
 
+#if defined(ARDUINO_ARCH_AVR)
+typedef void (*ServoMoveCallback)(uint8_t servoIndex); // called from the timer ISR when a profiled move ends
+#endif
+
 class Servo
 {
 public:
@@ -119,7 +123,19 @@ public:
   int read();                        // returns current pulse width as an angle between 0 and 180 degrees
   int readMicroseconds();            // returns current pulse width in microseconds for this servo (was read_us() in first release)
   bool attached();                   // return true if this servo is attached, otherwise false
+#if defined(ARDUINO_ARCH_AVR)
+  // Profiled moves, stepped once per REFRESH_INTERVAL by the timer ISR. maxSpeed and accel are in
+  // microseconds of pulse width per refresh frame (and per frame squared); value is as for write().
+  void moveTo(int value, int maxSpeed, int accel, ServoMoveCallback onComplete = NULL);
+  // As moveTo(), then holds for holdMs and moves back to returnValue; completes after the return.
+  void sweepTo(int value, int maxSpeed, int accel, unsigned int holdMs, int returnValue, ServoMoveCallback onComplete = NULL);
+  bool moving();                     // true until the current profiled move has completed
+#endif
 private:
+#if defined(ARDUINO_ARCH_AVR)
+  int toMicroseconds(int value);
+  void startProfile(int value, int maxSpeed, int accel, unsigned int holdFrames, int returnValue, bool sweep, ServoMoveCallback onComplete);
+#endif
    uint8_t servoIndex;               // index into the channel data for this servo
    int8_t min;                       // minimum is this value times 4 added to MIN_PULSE_WIDTH
    int8_t max;                       // maximum is this value times 4 added to MAX_PULSE_WIDTH
@@ -28,11 +28,34 @@
 #define ticksToUs(_ticks) (( (unsigned)_ticks * 8)/ clockCyclesPerMicrosecond() ) // converts from ticks back to microseconds
 
 
+#if defined(SERVO_HW_PWM)
+#define TRIM_DURATION       0                               // output compare hardware drives the pin, nothing to trim
+#else
 #define TRIM_DURATION       2                               // compensation ticks to trim adjust for digitalWrite delays // 12 August 2009
+#endif
 
 //#define NBR_TIMERS        (MAX_SERVOS / SERVOS_PER_TIMER)
 
 static servo_t servos[MAX_SERVOS];                          // static array of servo structures
+
+#define PROFILE_IDLE      0
+#define PROFILE_MOVING    1                                 // ramping towards target
+#define PROFILE_HOLDING   2                                 // sweep: waiting at target before returning
+#define PROFILE_RETURNING 3                                 // sweep: ramping back to returnTarget
+
+typedef struct {
+  volatile uint8_t state;
+  bool sweep;
+  unsigned int target;                                      // ticks
+  unsigned int returnTarget;                                // ticks
+  unsigned int speed;                                       // current ticks per refresh frame
+  unsigned int maxSpeed;                                    // ticks per refresh frame
+  unsigned int accel;                                       // ticks per refresh frame squared
+  unsigned int holdFrames;
+  ServoMoveCallback onComplete;
+} servoProfile_t;
+
+static servoProfile_t profiles[MAX_SERVOS];                 // motion profile state, touched by the ISR
 static volatile int8_t Channel[_Nbr_16timers ];             // counter for the servo being pulsed for each timer (or -1 if refresh interval)
 
 uint8_t ServoCount = 0;                                     // the total number of attached servos
@@ -49,10 +72,185 @@ uint8_t ServoCount = 0;                                     // the total number
 
 /************ static functions common to all instances ***********************/
 
+// Advances the trapezoidal profile of one servo by one refresh frame. Speed ramps up by accel
+// until maxSpeed and starts ramping down once the stopping distance (v^2 / 2a) reaches the
+// remaining distance, so each move takes the least time its limits allow.
+static inline void step_profile(uint8_t index)
+{
+  servoProfile_t *p = &profiles[index];
+  if (p->state == PROFILE_IDLE)
+    return;
+
+  if (p->state == PROFILE_HOLDING) {
+    if (p->holdFrames > 0) {
+      p->holdFrames--;
+      return;
+    }
+    p->target = p->returnTarget;
+    p->state = PROFILE_RETURNING;
+  }
+
+  unsigned int pos = servos[index].ticks;
+  unsigned int dist = pos > p->target ? pos - p->target : p->target - pos;
+  uint32_t stopping = ((uint32_t)p->speed * p->speed) / (2UL * p->accel);
+
+  if (stopping >= dist)
+    p->speed = p->speed > p->accel ? p->speed - p->accel : p->accel;
+  else if (p->speed < p->maxSpeed && stopping + p->speed + p->accel < dist)
+    p->speed = p->speed + p->accel < p->maxSpeed ? p->speed + p->accel : p->maxSpeed;
+  else if (p->speed == 0)
+    p->speed = p->accel;
+
+  if (p->speed >= dist)
+    pos = p->target;
+  else if (pos > p->target)
+    pos -= p->speed;
+  else
+    pos += p->speed;
+  servos[index].ticks = pos;
+
+  if (pos == p->target) {
+    p->speed = 0;
+    if (p->state == PROFILE_MOVING && p->sweep) {
+      p->state = PROFILE_HOLDING;
+    }
+    else {
+      p->state = PROFILE_IDLE;
+      if (p->onComplete)
+        p->onComplete(index);
+    }
+  }
+}
+
+#if defined(SERVO_HW_PWM)
+/*
+ * Hardware PWM backend: each servo owns an output compare pin of timer 4 or 5, running in
+ * fast PWM mode 14 with TOP = ICR = one refresh interval. The compare unit sets and clears
+ * the pin, so no interrupt sits between the pulse edges and other ISRs cannot stretch them.
+ * OCRnx is double buffered to BOTTOM, so a new width never cuts a pulse short. The overflow
+ * interrupt, once per frame, only steps motion profiles.
+ */
+#define HW_TIMER_NONE 0xFF
+
+#ifndef SERVO_HW_USE_TIMER4
+#define SERVO_HW_USE_TIMER4 1                               // 0 leaves timer 4 (pins 6-8) to the sketch
+#endif
+
+typedef struct {
+  uint8_t pin;
+  uint8_t timer;                                            // 4 or 5
+  uint8_t comBit;                                           // COMnx1 bit in TCCRnA
+  volatile uint16_t *ocr;
+} hwChannel_t;
+
+static const hwChannel_t hwChannels[] = {
+  {46, 5, COM5A1, &OCR5A}, {45, 5, COM5B1, &OCR5B}, {44, 5, COM5C1, &OCR5C},
+#if SERVO_HW_USE_TIMER4
+  { 6, 4, COM4A1, &OCR4A}, { 7, 4, COM4B1, &OCR4B}, { 8, 4, COM4C1, &OCR4C},
+#endif
+};
+#define HW_CHANNEL_COUNT (sizeof(hwChannels) / sizeof(hwChannels[0]))
+
+static uint8_t hwChannelOf[MAX_SERVOS];                     // index into hwChannels, HW_TIMER_NONE if unattached
+
+static const hwChannel_t *findHwChannel(uint8_t pin, uint8_t *slot)
+{
+  for (uint8_t i = 0; i < HW_CHANNEL_COUNT; i++) {
+    if (hwChannels[i].pin == pin) {
+      *slot = i;
+      return &hwChannels[i];
+    }
+  }
+  return NULL;
+}
+
+static void hw_frame(uint8_t timer)
+{
+  for (uint8_t index = 0; index < ServoCount; index++) {
+    uint8_t slot = hwChannelOf[index];
+    if (slot == HW_TIMER_NONE || hwChannels[slot].timer != timer)
+      continue;
+    step_profile(index);
+    *hwChannels[slot].ocr = servos[index].ticks;
+  }
+}
+
+#if SERVO_HW_USE_TIMER4
+SIGNAL (TIMER4_OVF_vect)
+{
+  hw_frame(4);
+}
+#endif
+
+SIGNAL (TIMER5_OVF_vect)
+{
+  hw_frame(5);
+}
+
+static bool hwTimerInUse(uint8_t timer)
+{
+  for (uint8_t index = 0; index < ServoCount; index++) {
+    uint8_t slot = hwChannelOf[index];
+    if (slot != HW_TIMER_NONE && hwChannels[slot].timer == timer)
+      return true;
+  }
+  return false;
+}
+
+static void hwTimerStart(uint8_t timer)
+{
+  uint16_t top = usToTicks(REFRESH_INTERVAL) - 1;
+  if (timer == 4) {
+    TCCR4B = 0;
+    TCCR4A = _BV(WGM41);                                    // fast PWM, TOP = ICR4 (mode 14)
+    ICR4 = top;
+    TCNT4 = 0;
+    TIFR4 = _BV(TOV4);
+    TIMSK4 = _BV(TOIE4);
+    TCCR4B = _BV(WGM43) | _BV(WGM42) | _BV(CS41);           // prescaler 8
+  }
+  else {
+    TCCR5B = 0;
+    TCCR5A = _BV(WGM51);
+    ICR5 = top;
+    TCNT5 = 0;
+    TIFR5 = _BV(TOV5);
+    TIMSK5 = _BV(TOIE5);
+    TCCR5B = _BV(WGM53) | _BV(WGM52) | _BV(CS51);
+  }
+}
+
+static void hwTimerStop(uint8_t timer)
+{
+  if (timer == 4) {
+    TIMSK4 = 0;
+    TCCR4B = 0;
+  }
+  else {
+    TIMSK5 = 0;
+    TCCR5B = 0;
+  }
+}
+
+#else
+
+// Advances the profiles of every moving channel on this timer by one refresh frame.
+static inline void step_profiles(timer16_Sequence_t timer)
+{
+  for (uint8_t channel = 0; channel < SERVOS_PER_TIMER; channel++) {
+    uint8_t index = SERVO_INDEX(timer, channel);
+    if (index >= ServoCount)
+      break;
+    step_profile(index);
+  }
+}
+
 static inline void handle_interrupts(timer16_Sequence_t timer, volatile uint16_t *TCNTn, volatile uint16_t* OCRnA)
 {
-  if( Channel[timer] < 0 )
+  if( Channel[timer] < 0 ) {
     *TCNTn = 0; // channel set to -1 indicated that refresh interval completed so reset the timer
+    step_profiles(timer);
+  }
   else{
     if( SERVO_INDEX(timer,Channel[timer]) < ServoCount && SERVO(timer,Channel[timer]).Pin.isActive == true )
       digitalWrite( SERVO(timer,Channel[timer]).Pin.nbr,LOW); // pulse this channel low if activated
@@ -217,6 +415,7 @@ static boolean isTimerActive(timer16_Sequence_t timer)
   return false;
 }
 
+#endif // SERVO_HW_PWM
 
 /****************** end of static functions ******************************/
 
@@ -225,6 +424,9 @@ Servo::Servo()
   if( ServoCount < MAX_SERVOS) {
     this->servoIndex = ServoCount++;                    // assign a servo index to this instance
 	servos[this->servoIndex].ticks = usToTicks(DEFAULT_PULSE_WIDTH);   // store default values  - 12 Aug 2009
+#if defined(SERVO_HW_PWM)
+    hwChannelOf[this->servoIndex] = HW_TIMER_NONE;
+#endif
   }
   else
     this->servoIndex = INVALID_SERVO ;  // too many servos
@@ -237,6 +439,32 @@ uint8_t Servo::attach(int pin)
 
 uint8_t Servo::attach(int pin, int min, int max)
 {
+#if defined(SERVO_HW_PWM)
+  uint8_t slot;
+  const hwChannel_t *hw = findHwChannel(pin, &slot);
+  if(this->servoIndex < MAX_SERVOS && hw != NULL) {
+    this->min  = (MIN_PULSE_WIDTH - min)/4;
+    this->max  = (MAX_PULSE_WIDTH - max)/4;
+    bool timerRunning = hwTimerInUse(hw->timer);
+
+    uint8_t oldSREG = SREG;
+    cli();
+    hwChannelOf[this->servoIndex] = slot;
+    *hw->ocr = servos[this->servoIndex].ticks;
+    if (!timerRunning)
+      hwTimerStart(hw->timer);
+    if (hw->timer == 4)
+      TCCR4A |= _BV(hw->comBit);
+    else
+      TCCR5A |= _BV(hw->comBit);
+    SREG = oldSREG;
+
+    pinMode(pin, OUTPUT);
+    servos[this->servoIndex].Pin.nbr = pin;
+    servos[this->servoIndex].Pin.isActive = true;
+  }
+  return this->servoIndex ;                                 // like the ISR backend; attached() tells if the pin was usable
+#else
   if(this->servoIndex < MAX_SERVOS ) {
     pinMode( pin, OUTPUT) ;                                   // set servo pin to output
     servos[this->servoIndex].Pin.nbr = pin;
@@ -250,18 +478,44 @@ uint8_t Servo::attach(int pin, int min, int max)
     servos[this->servoIndex].Pin.isActive = true;  // this must be set after the check for isTimerActive
   }
   return this->servoIndex ;
+#endif
 }
 
 void Servo::detach()
 {
+#if defined(SERVO_HW_PWM)
+  if(this->servoIndex >= MAX_SERVOS || hwChannelOf[this->servoIndex] == HW_TIMER_NONE)
+    return;
+  const hwChannel_t *hw = &hwChannels[hwChannelOf[this->servoIndex]];
+
+  uint8_t oldSREG = SREG;
+  cli();
+  if (hw->timer == 4)
+    TCCR4A &= ~_BV(hw->comBit);
+  else
+    TCCR5A &= ~_BV(hw->comBit);
+  hwChannelOf[this->servoIndex] = HW_TIMER_NONE;
+  if (!hwTimerInUse(hw->timer))
+    hwTimerStop(hw->timer);
+  SREG = oldSREG;
+
+  digitalWrite(hw->pin, LOW);
+  servos[this->servoIndex].Pin.isActive = false;
+#else
   servos[this->servoIndex].Pin.isActive = false;
   timer16_Sequence_t timer = SERVO_INDEX_TO_TIMER(servoIndex);
   if(isTimerActive(timer) == false) {
     finISR(timer);
   }
+#endif
 }
 
 void Servo::write(int value)
+{
+  this->writeMicroseconds(this->toMicroseconds(value));
+}
+
+int Servo::toMicroseconds(int value)
 {
   if(value < MIN_PULSE_WIDTH)
   {  // treat values less than 544 as angles in degrees (valid values in microseconds are handled as microseconds)
@@ -269,7 +523,50 @@ void Servo::write(int value)
     if(value > 180) value = 180;
     value = map(value, 0, 180, SERVO_MIN(),  SERVO_MAX());
   }
-  this->writeMicroseconds(value);
+  if( value < SERVO_MIN() )
+    value = SERVO_MIN();
+  else if( value > SERVO_MAX() )
+    value = SERVO_MAX();
+  return value;
+}
+
+void Servo::startProfile(int value, int maxSpeed, int accel, unsigned int holdFrames, int returnValue, bool sweep, ServoMoveCallback onComplete)
+{
+  byte channel = this->servoIndex;
+  if( channel >= MAX_SERVOS )
+    return;
+
+  servoProfile_t p;
+  p.state = PROFILE_MOVING;
+  p.sweep = sweep;
+  p.target = usToTicks(this->toMicroseconds(value) - TRIM_DURATION);
+  p.returnTarget = sweep ? usToTicks(this->toMicroseconds(returnValue) - TRIM_DURATION) : p.target;
+  p.speed = 0;
+  p.maxSpeed = usToTicks(maxSpeed > 0 ? maxSpeed : 1);
+  p.accel = usToTicks(accel > 0 ? accel : 1);
+  p.holdFrames = holdFrames;
+  p.onComplete = onComplete;
+
+  uint8_t oldSREG = SREG;
+  cli();
+  profiles[channel] = p;
+  SREG = oldSREG;
+}
+
+void Servo::moveTo(int value, int maxSpeed, int accel, ServoMoveCallback onComplete)
+{
+  this->startProfile(value, maxSpeed, accel, 0, value, false, onComplete);
+}
+
+void Servo::sweepTo(int value, int maxSpeed, int accel, unsigned int holdMs, int returnValue, ServoMoveCallback onComplete)
+{
+  unsigned int holdFrames = (unsigned long)holdMs * 1000UL / REFRESH_INTERVAL;
+  this->startProfile(value, maxSpeed, accel, holdFrames, returnValue, true, onComplete);
+}
+
+bool Servo::moving()
+{
+  return this->servoIndex < MAX_SERVOS && profiles[this->servoIndex].state != PROFILE_IDLE;
 }
 
 void Servo::writeMicroseconds(int value)
@@ -289,6 +586,11 @@ void Servo::writeMicroseconds(int value)
     uint8_t oldSREG = SREG;
     cli();
     servos[channel].ticks = value;
+    profiles[channel].state = PROFILE_IDLE; // a direct write cancels any profiled move
+#if defined(SERVO_HW_PWM)
+    if (hwChannelOf[channel] != HW_TIMER_NONE)
+      *hwChannels[hwChannelOf[channel]].ocr = value;  // takes effect at the next frame start
+#endif
     SREG = oldSREG;
   }
 }
@@ -7,7 +7,8 @@ Simple Prescription Builder (Tkinter UI)
     * time1 and dosage1 are REQUIRED
     * dosageN for N>=2 is OPTIONAL (if omitted, it defaults to dosage1 for the internal schedule)
     * You may have multiple lines (one medicine per line)
-- Exports: PNG or PDF (with a QR code that encodes the exact multiline prescription text)
+- Exports: PNG or PDF with QR codes for the prescription text, packed and split into
+  as many small codes as it needs (see qr_parts.py)
 - Now supports table format and multi-page layout for many medications
 
 Dependencies (install locally if missing):
@@ -18,12 +19,10 @@ Run:
 """
 
 import io
+import multiprocessing
 import os
-import re
-import sys
-from datetime import datetime
-from typing import List, Tuple, Dict
-import math
+import threading
+from typing import List
 
 try:
     import tkinter as tk
@@ -33,355 +32,12 @@ except Exception as e:
     raise
 
 try:
-    from PIL import Image, ImageDraw, ImageFont
+    from PIL import Image
 except ImportError:
     print("This app needs Pillow. Install with: pip install pillow")
     raise
 
-try:
-    import qrcode
-except ImportError:
-    qrcode = None  # We'll check at export time and ask the user to install
-
-# -----------------------------
-# Parsing helpers
-# -----------------------------
-TIME_RE = re.compile(r"^([01]?\d|2[0-3]):[0-5]\d$")
-
-
-def is_valid_time(t: str) -> bool:
-    return TIME_RE.match(t) is not None
-
-
-def parse_line(line: str) -> Dict:
-    """Parse one prescription line.
-    Expected at least: Name|Amount|time1|dosage1
-    Then pairs of timeN with optional dosageN.
-
-    Returns dict {name, amount, schedules: [(time, dosage_int), ...], normalized_line}
-    normalized_line keeps EXACT optional dosage behavior for QR (don't add missing dosageN).
-    """
-    raw = line.strip()
-    if not raw:
-        raise ValueError("Empty line")
-    # Keep trailing empties out but preserve intended empties between pipes
-    tokens = [tok.strip() for tok in raw.split("|")]
-    # Drop trailing empty tokens from a trailing pipe (visual convenience)
-    while tokens and tokens[-1] == "":
-        tokens.pop()
-
-    if len(tokens) < 4:
-        raise ValueError(f"Need at least Name|Amount|time1|dosage1 -- got: {raw}")
-
-    name = tokens[0]
-    if not name:
-        raise ValueError("Name cannot be empty")
-
-    try:
-        amount = int(tokens[1])
-    except ValueError:
-        raise ValueError(f"Amount must be an integer for '{name}'")
-
-    time1, dose1 = tokens[2], tokens[3]
-    if not is_valid_time(time1):
-        raise ValueError(f"Invalid time1 '{time1}' for '{name}' (HH:mm)")
-    try:
-        d1_int = int(dose1)
-    except ValueError:
-        raise ValueError(f"Invalid dosage1 '{dose1}' for '{name}' (int)")
-
-    schedules: List[Tuple[str, int]] = [(time1, d1_int)]
-
-    # Subsequent items: expect timeN, and optional dosageN (if missing -> default to dose1)
-    i = 4
-    while i < len(tokens):
-        t = tokens[i].strip()
-        if not is_valid_time(t):
-            raise ValueError(f"Expected time at position {i} for '{name}', got '{t}'")
-        d = d1_int
-        if i + 1 < len(tokens) and tokens[i + 1].strip() != "":
-            try:
-                d = int(tokens[i + 1].strip())
-                i += 2
-            except ValueError:
-                raise ValueError(f"Invalid dosage after time '{t}' for '{name}'")
-        else:
-            # no dosage provided -> default to dosage1
-            i += 1
-        schedules.append((t, d))
-
-    # normalized_line for QR = reflect exactly the optional dosage behavior
-    # We DO NOT inject defaulted dosage into the string; keep as original structure
-    normalized_line = raw
-
-    return {
-        "name": name,
-        "amount": amount,
-        "schedules": schedules,
-        "normalized_line": normalized_line,
-    }
-
-
-def parse_multiline(text: str) -> Tuple[List[Dict], str]:
-    """Parse the textarea content into list of meds and the QR payload string (joined by \n).
-    Raises ValueError with a human-friendly message on first error.
-    """
-    lines = [ln for ln in (text or "").replace("\r\n", "\n").replace("\r", "\n").split("\n") if ln.strip()]
-    meds = []
-    normalized_lines = []
-    for idx, ln in enumerate(lines, start=1):
-        try:
-            rec = parse_line(ln)
-            meds.append(rec)
-            normalized_lines.append(rec["normalized_line"])  # keep exact input shape for QR
-        except Exception as e:
-            raise ValueError(f"Line {idx}: {e}")
-    qr_payload = "\n".join(normalized_lines)
-    return meds, qr_payload
-
-
-# -----------------------------
-# Rendering helpers (PNG/PDF)
-# -----------------------------
-PAGE_W = 1240  # ~A4 @ 150 dpi width
-PAGE_H = 1754  # ~A4 @ 150 dpi height
-MARGIN = 64
-LINE_H = 36
-TABLE_ROW_H = 32
-HEADER_H = 240
-QR_BLOCK_H = 280
-
-MAX_QR_SIZE = 200  # Maximum QR code size to prevent overflow
-MEDS_PER_PAGE = 15  # Maximum medications per page
-
-
-def load_logo(path: str, max_w: int = 200, max_h: int = 200) -> Image.Image:
-    im = Image.open(path).convert("RGBA")
-    im.thumbnail((max_w, max_h), Image.LANCZOS)
-    return im
-
-
-def draw_text(draw: ImageDraw.ImageDraw, xy, text, font, fill=(0, 0, 0)):
-    draw.text(xy, text, font=font, fill=fill)
-
-
-def draw_table_header(draw: ImageDraw.ImageDraw, x: int, y: int, font, page_w: int, margin: int):
-    """Draw table header with columns for Medicine, Amount, and Schedule"""
-    col_widths = [400, 120, 400]  # Medicine, Amount, Schedule
-    col_x = [x, x + col_widths[0], x + col_widths[0] + col_widths[1]]
-    
-    # Draw header background
-    draw.rectangle([x, y, page_w - margin, y + TABLE_ROW_H], fill=(240, 240, 240), outline=(0, 0, 0))
-    
-    # Draw column separators
-    for i in range(1, len(col_x)):
-        draw.line([col_x[i], y, col_x[i], y + TABLE_ROW_H], fill=(0, 0, 0), width=1)
-    
-    # Draw header text
-    draw_text(draw, (col_x[0] + 8, y + 6), "Medicine", font, fill=(0, 0, 0))
-    draw_text(draw, (col_x[1] + 8, y + 6), "Amount", font, fill=(0, 0, 0))
-    draw_text(draw, (col_x[2] + 8, y + 6), "Schedule", font, fill=(0, 0, 0))
-    
-    return y + TABLE_ROW_H
-
-
-def draw_table_row(draw: ImageDraw.ImageDraw, x: int, y: int, med_data: Dict, font, page_w: int, margin: int):
-    """Draw a single table row for a medication"""
-    col_widths = [400, 120, 400]
-    col_x = [x, x + col_widths[0], x + col_widths[0] + col_widths[1]]
-    
-    # Draw row background and borders
-    draw.rectangle([x, y, page_w - margin, y + TABLE_ROW_H], fill=(255, 255, 255), outline=(0, 0, 0))
-    
-    # Draw column separators
-    for i in range(1, len(col_x)):
-        draw.line([col_x[i], y, col_x[i], y + TABLE_ROW_H], fill=(0, 0, 0), width=1)
-    
-    # Draw cell content
-    name = med_data["name"]
-    amount = str(med_data["amount"])
-    schedules = med_data["schedules"]
-    schedule_text = ", ".join([f"{t}×{d}" for (t, d) in schedules])
-    
-    # Truncate text if too long
-    if len(name) > 35:
-        name = name[:32] + "..."
-    if len(schedule_text) > 40:
-        schedule_text = schedule_text[:37] + "..."
-    
-    draw_text(draw, (col_x[0] + 8, y + 6), name, font)
-    draw_text(draw, (col_x[1] + 8, y + 6), amount, font)
-    draw_text(draw, (col_x[2] + 8, y + 6), schedule_text, font)
-    
-    return y + TABLE_ROW_H
-
-
-def calculate_qr_size(qr_payload: str) -> int:
-    """Calculate appropriate QR code size based on data length"""
-    if qrcode is None:
-        return MAX_QR_SIZE
-    
-    data_length = len(qr_payload)
-    if data_length < 100:
-        return min(120, MAX_QR_SIZE)
-    elif data_length < 300:
-        return min(160, MAX_QR_SIZE)
-    else:
-        return MAX_QR_SIZE
-
-
-def generate_page(hospital_name: str, logo_path: str, meds: List[Dict], qr_payload: str, page_num: int, total_pages: int, doctor_name: str = "", patient_name: str = "", notes: str = "") -> Image.Image:
-    """Generate a single page of the prescription"""
-    try:
-        font_title = ImageFont.truetype("arial.ttf", 42)
-        font_sub = ImageFont.truetype("arial.ttf", 24)
-        font_body = ImageFont.truetype("arial.ttf", 20)
-        font_table = ImageFont.truetype("arial.ttf", 18)
-    except Exception:
-        font_title = ImageFont.load_default()
-        font_sub = ImageFont.load_default()
-        font_body = ImageFont.load_default()
-        font_table = ImageFont.load_default()
-
-    img = Image.new("RGB", (PAGE_W, PAGE_H), "white")
-    draw = ImageDraw.Draw(img)
-
-    x = MARGIN
-    y = MARGIN
-
-    # Header section
-    if logo_path and os.path.isfile(logo_path):
-        try:
-            logo = load_logo(logo_path, 180, 180)
-            img.paste(logo, (x, y), logo)
-        except Exception:
-            pass
-    
-    draw_text(draw, (x + 200, y + 10), hospital_name or "Hospital / Clinic", font_title)
-    draw_text(draw, (x + 200, y + 60), f"Prescription", font_sub)
-    draw_text(draw, (x + 200, y + 90), datetime.now().strftime("Date: %Y-%m-%d %H:%M"), font_sub)
-    
-    if doctor_name:
-        draw_text(draw, (x + 200, y + 120), f"Doctor: {doctor_name}", font_sub)
-    if patient_name:
-        draw_text(draw, (x + 200, y + 150), f"Patient: {patient_name}", font_sub)
-    
-    # Page number if multiple pages
-    if total_pages > 1:
-        page_y = y + 180 if (doctor_name or patient_name) else y + 120
-        draw_text(draw, (x + 200, page_y), f"Page {page_num} of {total_pages}", font_sub)
-
-    y += HEADER_H
-
-    # Table section
-    draw.line((MARGIN, y, PAGE_W - MARGIN, y), fill=(0, 0, 0), width=2)
-    y += 20
-
-    # Draw table header
-    y = draw_table_header(draw, x, y, font_table, PAGE_W, MARGIN)
-
-    # Draw medication rows
-    for med in meds:
-        y = draw_table_row(draw, x, y, med, font_table, PAGE_W, MARGIN)
-
-    y += 20
-    draw.line((MARGIN, y, PAGE_W - MARGIN, y), fill=(0, 0, 0), width=2)
-    y += 30
-
-    if notes and notes.strip():
-        draw_text(draw, (x, y), "Notes:", font_sub)
-        y += LINE_H + 5
-        
-        # Split notes into multiple lines if too long
-        note_lines = []
-        words = notes.strip().split()
-        current_line = ""
-        max_chars_per_line = 80
-        
-        for word in words:
-            if len(current_line + " " + word) <= max_chars_per_line:
-                current_line += (" " + word) if current_line else word
-            else:
-                if current_line:
-                    note_lines.append(current_line)
-                current_line = word
-        if current_line:
-            note_lines.append(current_line)
-        
-        for note_line in note_lines:
-            draw_text(draw, (x, y), note_line, font_body)
-            y += LINE_H
-        
-        y += 20
-
-    # QR code section (only on last page)
-    if page_num == total_pages:
-        if qrcode is None:
-            draw_text(draw, (x, y), "[Install 'qrcode' to embed QR]", font_body, fill=(180, 0, 0))
-        else:
-            # Calculate appropriate QR size
-            qr_size = calculate_qr_size(qr_payload)
-            box_size = max(3, min(8, qr_size // 30))  # Adaptive box size
-            
-            qr = qrcode.QRCode(
-                version=None,
-                error_correction=qrcode.constants.ERROR_CORRECT_M,  # Medium error correction
-                box_size=box_size,
-                border=2,
-            )
-            qr.add_data(qr_payload)
-            qr.make(fit=True)
-            qr_img = qr.make_image(fill_color="black", back_color="white").convert("RGB")
-            
-            # Resize if still too large
-            if qr_img.size[0] > MAX_QR_SIZE:
-                qr_img = qr_img.resize((MAX_QR_SIZE, MAX_QR_SIZE), Image.LANCZOS)
-            
-            # Position QR code
-            qr_x = PAGE_W - MARGIN - qr_img.size[0]
-            qr_y = min(y, PAGE_H - MARGIN - qr_img.size[1])
-            img.paste(qr_img, (qr_x, qr_y))
-
-        # QR legend
-        draw_text(draw, (x, y), "QR: Complete prescription data", font_body)
-        y += LINE_H
-        
-        # # Show compact preview
-        # preview = qr_payload.replace("\n", " | ")
-        # if len(preview) > 100:
-        #     preview = preview[:97] + "..."
-        # draw_text(draw, (x, y), f"Data: {preview}", font_body)
-
-    return img
-
-
-def generate_images(hospital_name: str, logo_path: str, prescription_text: str, doctor_name: str = "", patient_name: str = "", notes: str = "") -> List[Image.Image]:
-    """Generate all pages of the prescription as separate images"""
-    meds, qr_payload = parse_multiline(prescription_text)
-    
-    if not meds:
-        raise ValueError("No valid medications found")
-    
-    # Split medications into pages
-    pages = []
-    total_pages = math.ceil(len(meds) / MEDS_PER_PAGE)
-    
-    for page_num in range(1, total_pages + 1):
-        start_idx = (page_num - 1) * MEDS_PER_PAGE
-        end_idx = min(start_idx + MEDS_PER_PAGE, len(meds))
-        page_meds = meds[start_idx:end_idx]
-        
-        page_img = generate_page(hospital_name, logo_path, page_meds, qr_payload, page_num, total_pages, doctor_name, patient_name, notes)
-        pages.append(page_img)
-    
-    return pages
-
-
-# Keep the old function for backward compatibility but redirect to new multi-page version
-def generate_image(hospital_name: str, logo_path: str, prescription_text: str, doctor_name: str = "", patient_name: str = "", notes: str = "") -> Image.Image:
-    """Generate prescription image (returns first page for preview)"""
-    pages = generate_images(hospital_name, logo_path, prescription_text, doctor_name, patient_name, notes)
-    return pages[0] if pages else None
+from prescription import qrcode, generate_images, render_batch
 
 
 # -----------------------------
@@ -445,6 +101,7 @@ class App(tk.Tk):
         ttk.Button(btns, text="Preview (Page 1)", command=self.preview).pack(side=tk.LEFT, padx=4)
         ttk.Button(btns, text="Export PNG", command=self.export_png).pack(side=tk.LEFT, padx=4)
         ttk.Button(btns, text="Export PDF", command=self.export_pdf).pack(side=tk.LEFT, padx=4)
+        ttk.Button(btns, text="Batch Export…", command=self.batch_export).pack(side=tk.LEFT, padx=4)
 
         self.page_info_lbl = ttk.Label(btns, text="")
         self.page_info_lbl.pack(side=tk.LEFT, padx=12)
@@ -561,6 +218,68 @@ class App(tk.Tk):
                 rgb_pages[0].save(path, "PDF", resolution=150.0, save_all=True, append_images=rgb_pages[1:])
             messagebox.showinfo("Saved", f"PDF with {len(pages)} page(s) exported to:\n{path}")
 
+    def batch_export(self):
+        """Render many prescription text files (one prescription each) with the
+        hospital, logo, doctor, patient and notes from the form."""
+        if qrcode is None:
+            messagebox.showerror("Missing dependency", "Please install 'qrcode' first: pip install qrcode")
+            return
+        paths = filedialog.askopenfilenames(
+            title="Select prescription text files",
+            filetypes=[("Text files", "*.txt"), ("All files", "*.*")],
+        )
+        if not paths:
+            return
+        out_dir = filedialog.askdirectory(title="Export pages to")
+        if not out_dir:
+            return
+        fmt = "pdf" if messagebox.askyesno("Batch export", "Export one PDF per prescription?\n(No exports PNG pages)") else "png"
+
+        jobs = []
+        for path in paths:
+            try:
+                with open(path, "r", encoding="utf-8") as f:
+                    text = f.read()
+            except OSError as e:
+                messagebox.showerror("Error", f"{os.path.basename(path)}: {e}")
+                return
+            jobs.append({
+                "name": os.path.splitext(os.path.basename(path))[0],
+                "text": text,
+                "out_dir": out_dir,
+                "format": fmt,
+                "hospital_name": self.hospital_var.get().strip(),
+                "logo_path": self.logo_path,
+                "doctor_name": self.doctor_var.get().strip(),
+                "patient_name": self.patient_var.get().strip(),
+                "notes": self.notes_text.get("1.0", tk.END).strip(),
+            })
+
+        errors = []
+        done_count = [0]
+
+        def on_done(name, pages, error):
+            done_count[0] += 1
+            if error:
+                errors.append(f"{name}: {error}")
+            text = f"Batch: {done_count[0]}/{len(jobs)} prescriptions"
+            self.after(0, lambda: self.page_info_lbl.config(text=text))
+
+        def task():
+            totals = render_batch(jobs, on_done=on_done)
+            summary = (f"{totals['pages']} pages from {totals['prescriptions'] - totals['failed']} prescriptions "
+                       f"in {totals['elapsed_s']} s ({totals['pages_per_s']} pages/s)")
+            if errors:
+                summary += "\n\nFailed:\n" + "\n".join(errors[:10])
+            self.after(0, lambda: [
+                self.page_info_lbl.config(text=f"Batch: {totals['pages_per_s']} pages/s"),
+                messagebox.showinfo("Batch export", summary),
+            ])
+
+        self.page_info_lbl.config(text=f"Batch: 0/{len(jobs)} prescriptions")
+        threading.Thread(target=task, daemon=True).start()
+
 
 if __name__ == "__main__":
+    multiprocessing.freeze_support()  # The batch renderer's workers in the frozen app
     App().mainloop()
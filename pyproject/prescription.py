@@ -0,0 +1,536 @@
+"""
+Prescription parsing and page rendering, without any UI.
+
+Used by the Tkinter app in main.py and by tools/dispenser_cli.py, which
+renders prescriptions and turns them into dispenser schedules in batches.
+Line format and rules are described in main.py.
+
+Dependencies:
+    pip install pillow qrcode
+"""
+
+import functools
+import os
+import re
+import time
+from concurrent.futures import ProcessPoolExecutor
+from datetime import datetime
+from typing import List, Tuple, Dict, Optional
+import math
+
+from PIL import Image, ImageDraw, ImageFont
+
+import qr_parts
+
+try:
+    import qrcode
+except ImportError:
+    qrcode = None  # Callers check before exporting and ask the user to install
+
+# -----------------------------
+# Parsing helpers
+# -----------------------------
+TIME_RE = re.compile(r"^([01]?\d|2[0-3]):[0-5]\d$")
+
+
+# Every string TIME_RE accepts, so checking a time is one set lookup
+VALID_TIMES = frozenset(
+    [f"{h:02d}:{m:02d}" for h in range(24) for m in range(60)]
+    + [f"{h}:{m:02d}" for h in range(10) for m in range(60)]
+)
+
+
+def is_valid_time(t: str) -> bool:
+    return t in VALID_TIMES
+
+
+def parse_line(line: str) -> Dict:
+    """Parse one prescription line.
+    Expected at least: Name|Amount|time1|dosage1
+    Then pairs of timeN with optional dosageN.
+
+    Returns dict {name, amount, schedules: [(time, dosage_int), ...], normalized_line}
+    normalized_line keeps EXACT optional dosage behavior for QR (don't add missing dosageN).
+    """
+    raw = line.strip()
+    if not raw:
+        raise ValueError("Empty line")
+    # Keep trailing empties out but preserve intended empties between pipes
+    tokens = [tok.strip() for tok in raw.split("|")]
+    # Drop trailing empty tokens from a trailing pipe (visual convenience)
+    while tokens and tokens[-1] == "":
+        tokens.pop()
+
+    if len(tokens) < 4:
+        raise ValueError(f"Need at least Name|Amount|time1|dosage1 -- got: {raw}")
+
+    name = tokens[0]
+    if not name:
+        raise ValueError("Name cannot be empty")
+
+    try:
+        amount = int(tokens[1])
+    except ValueError:
+        raise ValueError(f"Amount must be an integer for '{name}'")
+
+    time1, dose1 = tokens[2], tokens[3]
+    if not is_valid_time(time1):
+        raise ValueError(f"Invalid time1 '{time1}' for '{name}' (HH:mm)")
+    try:
+        d1_int = int(dose1)
+    except ValueError:
+        raise ValueError(f"Invalid dosage1 '{dose1}' for '{name}' (int)")
+
+    schedules: List[Tuple[str, int]] = [(time1, d1_int)]
+
+    # Subsequent items: expect timeN, and optional dosageN (if missing -> default to dose1)
+    i = 4
+    while i < len(tokens):
+        t = tokens[i].strip()
+        if not is_valid_time(t):
+            raise ValueError(f"Expected time at position {i} for '{name}', got '{t}'")
+        d = d1_int
+        if i + 1 < len(tokens) and tokens[i + 1].strip() != "":
+            try:
+                d = int(tokens[i + 1].strip())
+                i += 2
+            except ValueError:
+                raise ValueError(f"Invalid dosage after time '{t}' for '{name}'")
+        else:
+            # no dosage provided -> default to dosage1
+            i += 1
+        schedules.append((t, d))
+
+    # normalized_line for QR = reflect exactly the optional dosage behavior
+    # We DO NOT inject defaulted dosage into the string; keep as original structure
+    normalized_line = raw
+
+    return {
+        "name": name,
+        "amount": amount,
+        "schedules": schedules,
+        "normalized_line": normalized_line,
+    }
+
+
+def parse_multiline(text: str) -> Tuple[List[Dict], str]:
+    """Parse the textarea content into list of meds and the QR payload string (joined by \n).
+    Raises ValueError with a human-friendly message on first error.
+    """
+    lines = [ln for ln in (text or "").replace("\r\n", "\n").replace("\r", "\n").split("\n") if ln.strip()]
+    meds = []
+    normalized_lines = []
+    for idx, ln in enumerate(lines, start=1):
+        try:
+            rec = _parse_line_cached(ln)
+            rec = dict(rec, schedules=list(rec["schedules"]))
+            meds.append(rec)
+            normalized_lines.append(rec["normalized_line"])  # keep exact input shape for QR
+        except Exception as e:
+            raise ValueError(f"Line {idx}: {e}")
+    qr_payload = "\n".join(normalized_lines)
+    return meds, qr_payload
+
+
+# Clinics print the same medicine lines over and over; parse each once
+@functools.lru_cache(maxsize=4096)
+def _parse_line_cached(line: str) -> Dict:
+    return parse_line(line)
+
+
+def parse_batch(texts: List[str]) -> List:
+    """Parse many prescriptions at once. Each result is (meds, qr_payload),
+    or the ValueError parse_multiline() raised for that prescription."""
+    results = []
+    for text in texts:
+        try:
+            results.append(parse_multiline(text))
+        except ValueError as e:
+            results.append(e)
+    return results
+
+
+# -----------------------------
+# Rendering helpers (PNG/PDF)
+# -----------------------------
+PAGE_W = 1240  # ~A4 @ 150 dpi width
+PAGE_H = 1754  # ~A4 @ 150 dpi height
+MARGIN = 64
+LINE_H = 36
+TABLE_ROW_H = 32
+HEADER_H = 240
+QR_BLOCK_H = 280
+
+MAX_QR_SIZE = 200  # Maximum QR code size to prevent overflow
+QR_GAP = 16
+QR_LEGEND_W = 400  # Left of the codes, for the legend
+QR_PER_ROW = max(1, (PAGE_W - 2 * MARGIN - QR_LEGEND_W + QR_GAP) // (MAX_QR_SIZE + QR_GAP))
+QR_LAST_PAGE_MAX = 2 * QR_PER_ROW  # More parts than this are spread over the pages
+MEDS_PER_PAGE = 15  # Maximum medications per page
+
+
+def load_logo(path: str, max_w: int = 200, max_h: int = 200) -> Image.Image:
+    im = Image.open(path).convert("RGBA")
+    im.thumbnail((max_w, max_h), Image.LANCZOS)
+    return im
+
+
+# Pages share fonts, logos and the table header, so each is made once per
+# process and reused; the batch renderer keeps one copy in every worker
+@functools.lru_cache(maxsize=None)
+def load_fonts():
+    """(title, sub, body, table) fonts for generate_page()."""
+    try:
+        return (ImageFont.truetype("arial.ttf", 42), ImageFont.truetype("arial.ttf", 24),
+                ImageFont.truetype("arial.ttf", 20), ImageFont.truetype("arial.ttf", 18))
+    except Exception:
+        font = ImageFont.load_default()
+        return (font, font, font, font)
+
+
+@functools.lru_cache(maxsize=16)
+def _cached_logo(path: str, max_w: int, max_h: int, mtime: float) -> Image.Image:
+    return load_logo(path, max_w, max_h)
+
+
+def cached_logo(path: str, max_w: int = 200, max_h: int = 200) -> Image.Image:
+    """load_logo() for a file unchanged since last time; do not modify the result."""
+    return _cached_logo(path, max_w, max_h, os.path.getmtime(path))
+
+
+def draw_text(draw: ImageDraw.ImageDraw, xy, text, font, fill=(0, 0, 0)):
+    draw.text(xy, text, font=font, fill=fill)
+
+
+def draw_table_header(draw: ImageDraw.ImageDraw, x: int, y: int, font, page_w: int, margin: int):
+    """Draw table header with columns for Medicine, Amount, and Schedule"""
+    col_widths = [400, 120, 400]  # Medicine, Amount, Schedule
+    col_x = [x, x + col_widths[0], x + col_widths[0] + col_widths[1]]
+    
+    # Draw header background
+    draw.rectangle([x, y, page_w - margin, y + TABLE_ROW_H], fill=(240, 240, 240), outline=(0, 0, 0))
+    
+    # Draw column separators
+    for i in range(1, len(col_x)):
+        draw.line([col_x[i], y, col_x[i], y + TABLE_ROW_H], fill=(0, 0, 0), width=1)
+    
+    # Draw header text
+    draw_text(draw, (col_x[0] + 8, y + 6), "Medicine", font, fill=(0, 0, 0))
+    draw_text(draw, (col_x[1] + 8, y + 6), "Amount", font, fill=(0, 0, 0))
+    draw_text(draw, (col_x[2] + 8, y + 6), "Schedule", font, fill=(0, 0, 0))
+    
+    return y + TABLE_ROW_H
+
+
+@functools.lru_cache(maxsize=4)
+def table_header_strip(width: int, font) -> Image.Image:
+    """draw_table_header() output for a table `width` pixels wide, to paste."""
+    strip = Image.new("RGB", (width + 1, TABLE_ROW_H + 1), "white")
+    draw_table_header(ImageDraw.Draw(strip), 0, 0, font, width, 0)
+    return strip
+
+
+def draw_table_row(draw: ImageDraw.ImageDraw, x: int, y: int, med_data: Dict, font, page_w: int, margin: int):
+    """Draw a single table row for a medication"""
+    col_widths = [400, 120, 400]
+    col_x = [x, x + col_widths[0], x + col_widths[0] + col_widths[1]]
+    
+    # Draw row background and borders
+    draw.rectangle([x, y, page_w - margin, y + TABLE_ROW_H], fill=(255, 255, 255), outline=(0, 0, 0))
+    
+    # Draw column separators
+    for i in range(1, len(col_x)):
+        draw.line([col_x[i], y, col_x[i], y + TABLE_ROW_H], fill=(0, 0, 0), width=1)
+    
+    # Draw cell content
+    name = med_data["name"]
+    amount = str(med_data["amount"])
+    schedules = med_data["schedules"]
+    schedule_text = ", ".join([f"{t}×{d}" for (t, d) in schedules])
+    
+    # Truncate text if too long
+    if len(name) > 35:
+        name = name[:32] + "..."
+    if len(schedule_text) > 40:
+        schedule_text = schedule_text[:37] + "..."
+    
+    draw_text(draw, (col_x[0] + 8, y + 6), name, font)
+    draw_text(draw, (col_x[1] + 8, y + 6), amount, font)
+    draw_text(draw, (col_x[2] + 8, y + 6), schedule_text, font)
+    
+    return y + TABLE_ROW_H
+
+
+def calculate_qr_size(qr_payload: str) -> int:
+    """Calculate appropriate QR code size based on data length"""
+    if qrcode is None:
+        return MAX_QR_SIZE
+    
+    data_length = len(qr_payload)
+    if data_length < 100:
+        return min(120, MAX_QR_SIZE)
+    elif data_length < 300:
+        return min(160, MAX_QR_SIZE)
+    else:
+        return MAX_QR_SIZE
+
+
+@functools.lru_cache(maxsize=256)
+def qr_image(qr_payload: str) -> Image.Image:
+    """The QR block for qr_payload. Building the code (all eight mask
+    patterns are tried) is most of a page's render time, and a ward's
+    prescriptions often share a regimen, so codes are kept per payload."""
+    # Calculate appropriate QR size
+    qr_size = calculate_qr_size(qr_payload)
+    box_size = max(3, min(8, qr_size // 30))  # Adaptive box size
+    
+    qr = qrcode.QRCode(
+        version=None,
+        error_correction=qrcode.constants.ERROR_CORRECT_M,  # Medium error correction
+        box_size=box_size,
+        border=2,
+    )
+    qr.add_data(qr_payload)
+    qr.make(fit=True)
+    # Whole pixels per module: a code scaled by a fraction blurs its edges
+    qr.box_size = max(1, min(box_size, MAX_QR_SIZE // (qr.modules_count + 2 * qr.border)))
+    qr_img = qr.make_image(fill_color="black", back_color="white").convert("RGB")
+    
+    # Resize if still too large
+    if qr_img.size[0] > MAX_QR_SIZE:
+        qr_img = qr_img.resize((MAX_QR_SIZE, MAX_QR_SIZE), Image.LANCZOS)
+    return qr_img
+
+
+def generate_page(hospital_name: str, logo_path: str, meds: List[Dict], qr_payload: str, page_num: int, total_pages: int, doctor_name: str = "", patient_name: str = "", notes: str = "", parts: Optional[List[str]] = None) -> Image.Image:
+    """Generate a single page of the prescription.
+    parts are the QR codes (qr_parts.encode_parts()) this page carries;
+    by default the last page carries all of qr_payload's."""
+    font_title, font_sub, font_body, font_table = load_fonts()
+
+    img = Image.new("RGB", (PAGE_W, PAGE_H), "white")
+    draw = ImageDraw.Draw(img)
+
+    x = MARGIN
+    y = MARGIN
+
+    # Header section
+    if logo_path and os.path.isfile(logo_path):
+        try:
+            logo = cached_logo(logo_path, 180, 180)
+            img.paste(logo, (x, y), logo)
+        except Exception:
+            pass
+    
+    draw_text(draw, (x + 200, y + 10), hospital_name or "Hospital / Clinic", font_title)
+    draw_text(draw, (x + 200, y + 60), f"Prescription", font_sub)
+    draw_text(draw, (x + 200, y + 90), datetime.now().strftime("Date: %Y-%m-%d %H:%M"), font_sub)
+    
+    if doctor_name:
+        draw_text(draw, (x + 200, y + 120), f"Doctor: {doctor_name}", font_sub)
+    if patient_name:
+        draw_text(draw, (x + 200, y + 150), f"Patient: {patient_name}", font_sub)
+    
+    # Page number if multiple pages
+    if total_pages > 1:
+        page_y = y + 180 if (doctor_name or patient_name) else y + 120
+        draw_text(draw, (x + 200, page_y), f"Page {page_num} of {total_pages}", font_sub)
+
+    y += HEADER_H
+
+    # Table section
+    draw.line((MARGIN, y, PAGE_W - MARGIN, y), fill=(0, 0, 0), width=2)
+    y += 20
+
+    # Draw table header
+    img.paste(table_header_strip(PAGE_W - MARGIN - x, font_table), (x, y))
+    y += TABLE_ROW_H
+
+    # Draw medication rows
+    for med in meds:
+        y = draw_table_row(draw, x, y, med, font_table, PAGE_W, MARGIN)
+
+    y += 20
+    draw.line((MARGIN, y, PAGE_W - MARGIN, y), fill=(0, 0, 0), width=2)
+    y += 30
+
+    if notes and notes.strip():
+        draw_text(draw, (x, y), "Notes:", font_sub)
+        y += LINE_H + 5
+        
+        # Split notes into multiple lines if too long
+        note_lines = []
+        words = notes.strip().split()
+        current_line = ""
+        max_chars_per_line = 80
+        
+        for word in words:
+            if len(current_line + " " + word) <= max_chars_per_line:
+                current_line += (" " + word) if current_line else word
+            else:
+                if current_line:
+                    note_lines.append(current_line)
+                current_line = word
+        if current_line:
+            note_lines.append(current_line)
+        
+        for note_line in note_lines:
+            draw_text(draw, (x, y), note_line, font_body)
+            y += LINE_H
+        
+        y += 20
+
+    if parts is None:
+        parts = qr_parts.encode_parts(qr_payload.split("\n")) if page_num == total_pages else []
+
+    # QR code section: rows of codes from the right margin
+    if parts:
+        if qrcode is None:
+            draw_text(draw, (x, y), "[Install 'qrcode' to embed QR]", font_body, fill=(180, 0, 0))
+        else:
+            rows = math.ceil(len(parts) / QR_PER_ROW)
+            block_h = rows * MAX_QR_SIZE + (rows - 1) * QR_GAP
+            top = min(y, PAGE_H - MARGIN - block_h)
+            for i, part in enumerate(parts):
+                qr_img = qr_image(part)
+                row, col = divmod(i, QR_PER_ROW)
+                in_row = min(QR_PER_ROW, len(parts) - row * QR_PER_ROW)
+                right = in_row - col  # Slots from this one to the margin; parts read left to right
+                qr_x = PAGE_W - MARGIN - right * MAX_QR_SIZE - (right - 1) * QR_GAP + (MAX_QR_SIZE - qr_img.size[0])
+                qr_y = top + row * (MAX_QR_SIZE + QR_GAP)
+                img.paste(qr_img, (qr_x, qr_y))
+
+        # QR legend
+        first, count = qr_parts.part_info(parts[0])
+        if count == 1:
+            draw_text(draw, (x, y), "QR: Complete prescription data", font_body)
+        else:
+            last = first + len(parts) - 1
+            numbers = f"{first}" if last == first else f"{first}-{last}"
+            draw_text(draw, (x, y), f"QR {numbers} of {count}: scan every code", font_body)
+            y += LINE_H
+            draw_text(draw, (x, y), "to load the prescription", font_body)
+        y += LINE_H
+        
+        # # Show compact preview
+        # preview = qr_payload.replace("\n", " | ")
+        # if len(preview) > 100:
+        #     preview = preview[:97] + "..."
+        # draw_text(draw, (x, y), f"Data: {preview}", font_body)
+
+    return img
+
+
+def generate_images(hospital_name: str, logo_path: str, prescription_text: str, doctor_name: str = "", patient_name: str = "", notes: str = "") -> List[Image.Image]:
+    """Generate all pages of the prescription as separate images"""
+    meds, qr_payload = parse_multiline(prescription_text)
+    
+    if not meds:
+        raise ValueError("No valid medications found")
+    
+    # Split medications into pages
+    pages = []
+    total_pages = math.ceil(len(meds) / MEDS_PER_PAGE)
+
+    # A few QR codes go on the last page; more are shared out over the last pages
+    parts = qr_parts.encode_parts([med["normalized_line"] for med in meds])
+    per_page = len(parts) if len(parts) <= QR_LAST_PAGE_MAX else math.ceil(len(parts) / total_pages)
+    first_qr_page = total_pages - math.ceil(len(parts) / per_page) + 1
+    
+    for page_num in range(1, total_pages + 1):
+        start_idx = (page_num - 1) * MEDS_PER_PAGE
+        end_idx = min(start_idx + MEDS_PER_PAGE, len(meds))
+        page_meds = meds[start_idx:end_idx]
+        start_part = (page_num - first_qr_page) * per_page
+        page_parts = parts[start_part:start_part + per_page] if page_num >= first_qr_page else []
+        
+        page_img = generate_page(hospital_name, logo_path, page_meds, qr_payload, page_num, total_pages, doctor_name, patient_name, notes, page_parts)
+        pages.append(page_img)
+    
+    return pages
+
+
+# Keep the old function for backward compatibility but redirect to new multi-page version
+def generate_image(hospital_name: str, logo_path: str, prescription_text: str, doctor_name: str = "", patient_name: str = "", notes: str = "") -> Image.Image:
+    """Generate prescription image (returns first page for preview)"""
+    pages = generate_images(hospital_name, logo_path, prescription_text, doctor_name, patient_name, notes)
+    return pages[0] if pages else None
+
+
+# -----------------------------
+# Dispenser schedules
+# -----------------------------
+def to_medications(meds: List[Dict]) -> List[Dict]:
+    """Turn parsed lines into the dispenser's medication list, one tube per
+    line in order: [{"tube", "type", "amount", "time_to_take": [{"time", "dosage"}]}]."""
+    medications = []
+    for tube, med in enumerate(meds, start=1):
+        medications.append({
+            "tube": f"tube{tube}",
+            "type": med["name"],
+            "amount": med["amount"],
+            "time_to_take": [
+                {"time": t, "dosage": f"{d} tablet" if d == 1 else f"{d} tablets"}
+                for (t, d) in med["schedules"]
+            ],
+        })
+    return medications
+
+
+# -----------------------------
+# Batch rendering
+# -----------------------------
+def render_prescription(job: Dict) -> Tuple[str, int, Optional[str]]:
+    """Render one batch job and save it; returns (name, pages, error).
+
+    job: name, text, out_dir, format ("png" or "pdf") and optionally
+    hospital_name, logo_path, doctor_name, patient_name, notes.
+    PNG pages go to <name>_page_<n>.png, a PDF to <name>.pdf.
+    """
+    try:
+        pages = generate_images(job.get("hospital_name", ""), job.get("logo_path", ""), job["text"],
+                                job.get("doctor_name", ""), job.get("patient_name", ""), job.get("notes", ""))
+        base = os.path.join(job["out_dir"], job["name"])
+        if job.get("format", "png") == "pdf":
+            rgb_pages = [page.convert("RGB") for page in pages]
+            rgb_pages[0].save(base + ".pdf", "PDF", resolution=150.0, save_all=True, append_images=rgb_pages[1:])
+        else:
+            for i, page in enumerate(pages, 1):
+                page.save(f"{base}_page_{i}.png", format="PNG")
+        return job["name"], len(pages), None
+    except Exception as e:
+        return job["name"], 0, str(e)
+
+
+def render_batch(jobs: List[Dict], workers: Optional[int] = None, on_done=None) -> Dict:
+    """Render many prescriptions across a process pool (render_prescription()
+    per job; workers=1 renders in this process). on_done(name, pages, error)
+    is called as each finishes. Returns the totals, including pages/s."""
+    started = time.perf_counter()
+    pages = 0
+    failed = 0
+
+    def done(result):
+        nonlocal pages, failed
+        name, count, error = result
+        pages += count
+        failed += error is not None
+        if on_done:
+            on_done(name, count, error)
+
+    if workers == 1 or len(jobs) <= 1:
+        for job in jobs:
+            done(render_prescription(job))
+    else:
+        with ProcessPoolExecutor(max_workers=workers) as pool:
+            for result in pool.map(render_prescription, jobs, chunksize=4):
+                done(result)
+
+    elapsed = time.perf_counter() - started
+    return {
+        "prescriptions": len(jobs),
+        "failed": failed,
+        "pages": pages,
+        "elapsed_s": round(elapsed, 3),
+        "pages_per_s": round(pages / elapsed, 1) if elapsed > 0 else None,
+    }
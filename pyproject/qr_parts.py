@@ -0,0 +1,273 @@
+"""
+Compact, multi-part QR payload for prescriptions.
+
+The prescription lines (Name|Amount|time1|dosage1|...) are packed into
+a few bytes per dose, deflated when that helps, split into parts small
+enough for a QR that stays readable at MAX_QR_SIZE, and Base45-encoded
+so the code uses QR alphanumeric mode (5.5 bits a character instead of
+8). Every part starts with a sequence header, so parts can be scanned
+in any order and a Reassembler rebuilds the prescription text once all
+of them are in.
+
+Part (before Base45):
+    magic(0x9D) flags set_id(LE16) index count chunk
+flags: high nibble version, bit 0 deflated. set_id is the CRC-16 of the
+whole message, which also checks the reassembled result.
+
+Message (before deflate):
+    MSG_PACKED varint(meds)
+        per med: nameLen name varint(amount) timeCount(| OMITTED_LAST)
+        per time: minute(LE16) dosage
+    MSG_TEXT   the lines as UTF-8, for anything the packed form can't hold
+
+OMITTED_LAST keeps a trailing time without a dosage as written, the way
+the builder keeps normalized_line (it defaults to dosage1 when parsed).
+"""
+
+import binascii
+import re
+import struct
+import zlib
+from typing import Dict, List, Optional
+
+MAGIC = 0x9D
+VERSION = 1
+FLAG_DEFLATE = 0x01
+HEADER = struct.Struct("<BBHBB")
+
+MSG_PACKED = 0
+MSG_TEXT = 1
+OMITTED_LAST = 0x80
+MAX_TIMES = 0x7F
+
+# A version 6 code at level M holds 154 alphanumeric characters; at
+# 45 modules with its border it still gets 4 px a module in 200 px
+PART_CHARS = 154
+MAX_PARTS = 255
+
+BASE45 = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:"
+BASE45_INDEX = {c: i for i, c in enumerate(BASE45)}
+
+TIME_RE = re.compile(r"^([01]?[0-9]|2[0-3]):([0-5][0-9])$")
+NUMBER_RE = re.compile(r"^[0-9]+$")
+MAX_AMOUNT = (1 << 28) - 1
+
+
+def b45encode(data: bytes) -> str:
+    out = []
+    for i in range(0, len(data) - 1, 2):
+        n = data[i] * 256 + data[i + 1]
+        out += [BASE45[n % 45], BASE45[n // 45 % 45], BASE45[n // 2025]]
+    if len(data) % 2:
+        n = data[-1]
+        out += [BASE45[n % 45], BASE45[n // 45]]
+    return "".join(out)
+
+
+def b45decode(text: str) -> bytes:
+    try:
+        values = [BASE45_INDEX[c] for c in text]
+    except KeyError:
+        raise ValueError("not Base45")
+    out = bytearray()
+    for i in range(0, len(values), 3):
+        group = values[i:i + 3]
+        if len(group) == 3:
+            n = group[0] + group[1] * 45 + group[2] * 2025
+            if n > 0xFFFF:
+                raise ValueError("not Base45")
+            out += bytes([n >> 8, n & 0xFF])
+        elif len(group) == 2:
+            n = group[0] + group[1] * 45
+            if n > 0xFF:
+                raise ValueError("not Base45")
+            out.append(n)
+        else:
+            raise ValueError("not Base45")
+    return bytes(out)
+
+
+def _varint(value: int) -> bytes:
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        out.append(byte | (0x80 if value else 0))
+        if not value:
+            return bytes(out)
+
+
+def _read_varint(data: bytes, pos: int):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+        if shift > 28:
+            raise ValueError("bad varint")
+
+
+def _pack_line(line: str) -> Optional[bytes]:
+    """One line in the packed form, or None if it needs MSG_TEXT."""
+    tokens = [tok.strip() for tok in line.strip().split("|")]
+    while tokens and tokens[-1] == "":
+        tokens.pop()
+    if len(tokens) < 4:
+        return None
+    name = tokens[0].encode("utf-8")
+    if not name or len(name) > 255 or not NUMBER_RE.match(tokens[1]) or int(tokens[1]) > MAX_AMOUNT:
+        return None
+
+    times = []
+    omitted = len(tokens) % 2 == 1      # Only the last time may go without a dosage
+    for i in range(2, len(tokens), 2):
+        match = TIME_RE.match(tokens[i])
+        dosage = tokens[i + 1] if i + 1 < len(tokens) else None
+        if not match or (dosage is not None and not (NUMBER_RE.match(dosage) and int(dosage) <= 255)):
+            return None
+        times.append((int(match.group(1)) * 60 + int(match.group(2)), int(dosage or 0)))
+    if len(times) > MAX_TIMES:
+        return None
+
+    out = bytearray([len(name)]) + name + _varint(int(tokens[1]))
+    out.append(len(times) | (OMITTED_LAST if omitted else 0))
+    for minute, dosage in times:
+        out += struct.pack("<HB", minute, dosage)
+    return bytes(out)
+
+
+def pack(lines: List[str]) -> bytes:
+    """The message for the prescription lines (normalized_line of each med)."""
+    packed = [_pack_line(line) for line in lines]
+    if all(p is not None for p in packed):
+        return bytes([MSG_PACKED]) + _varint(len(lines)) + b"".join(packed)
+    return bytes([MSG_TEXT]) + "\n".join(lines).encode("utf-8")
+
+
+def unpack(message: bytes) -> List[str]:
+    """Prescription lines back from a message; times come back as HH:MM."""
+    if not message:
+        raise ValueError("empty message")
+    if message[0] == MSG_TEXT:
+        return message[1:].decode("utf-8").split("\n")
+    if message[0] != MSG_PACKED:
+        raise ValueError("unknown message type")
+
+    try:
+        count, pos = _read_varint(message, 1)
+        lines = []
+        for _ in range(count):
+            name_len = message[pos]
+            name = message[pos + 1:pos + 1 + name_len].decode("utf-8")
+            amount, pos = _read_varint(message, pos + 1 + name_len)
+            times = message[pos]
+            pos += 1
+            tokens = [name, str(amount)]
+            for i in range(times & MAX_TIMES):
+                minute, dosage = struct.unpack_from("<HB", message, pos)
+                pos += 3
+                tokens.append(f"{minute // 60:02d}:{minute % 60:02d}")
+                if not (times & OMITTED_LAST and i == (times & MAX_TIMES) - 1):
+                    tokens.append(str(dosage))
+            lines.append("|".join(tokens))
+    except (IndexError, struct.error, UnicodeDecodeError):
+        raise ValueError("truncated message")
+    return lines
+
+
+def encode_parts(lines: List[str], part_chars: int = PART_CHARS) -> List[str]:
+    """QR payloads for the prescription lines, each at most part_chars long."""
+    message = pack(lines)
+    flags = VERSION << 4
+    deflated = zlib.compress(message, 9)[2:-4]      # Raw deflate: the CRC below covers it
+    if len(deflated) < len(message):
+        message, flags = deflated, flags | FLAG_DEFLATE
+    set_id = binascii.crc_hqx(message, 0xFFFF)
+
+    chunk = (part_chars // 3) * 2 - HEADER.size
+    count = max(1, -(-len(message) // chunk))
+    if count > MAX_PARTS:
+        raise ValueError(f"Prescription too long for {MAX_PARTS} QR codes")
+    return [b45encode(HEADER.pack(MAGIC, flags, set_id, i, count) + message[i * chunk:(i + 1) * chunk])
+            for i in range(count)]
+
+
+def is_part(scanned: str) -> bool:
+    try:
+        data = b45decode(scanned.strip("\r\n"))
+    except ValueError:
+        return False
+    return len(data) >= HEADER.size and data[0] == MAGIC
+
+
+def part_info(part: str):
+    """(number from 1, count) of a part made by encode_parts()."""
+    _, _, _, index, count = HEADER.unpack_from(b45decode(part[:(HEADER.size + 1) // 2 * 3]))
+    return index + 1, count
+
+
+class Reassembler:
+    """Collects scanned parts of one prescription in any order.
+
+    add() returns the prescription text once every part is in, None
+    until then. A part from a different prescription starts over, and a
+    scan that is not a part (a QR from before parts existed carries the
+    text itself) is returned as it is.
+    """
+
+    def __init__(self):
+        self.reset()
+
+    def reset(self):
+        self.set_id = None
+        self.flags = 0
+        self.count = 0
+        self.parts: Dict[int, bytes] = {}
+
+    def missing(self) -> List[int]:
+        """Part numbers (from 1) still to scan."""
+        return [i + 1 for i in range(self.count) if i not in self.parts]
+
+    def add(self, scanned: str) -> Optional[str]:
+        scanned = scanned.strip("\r\n")        # Base45 itself may start or end with a space
+        if not is_part(scanned):
+            self.reset()
+            return scanned.strip()
+        data = b45decode(scanned)
+        magic, flags, set_id, index, count = HEADER.unpack_from(data)
+        if flags >> 4 != VERSION:
+            raise ValueError(f"QR format version {flags >> 4} is not supported")
+        if count == 0 or index >= count:
+            raise ValueError("bad QR part header")
+        if (set_id, flags, count) != (self.set_id, self.flags, self.count):
+            self.reset()
+            self.set_id, self.flags, self.count = set_id, flags, count
+        self.parts[index] = data[HEADER.size:]
+        if len(self.parts) < count:
+            return None
+
+        message = b"".join(self.parts[i] for i in range(count))
+        self.reset()
+        if binascii.crc_hqx(message, 0xFFFF) != set_id:
+            raise ValueError("QR parts do not add up; scan them again")
+        if flags & FLAG_DEFLATE:
+            message = zlib.decompress(message, -15)
+        return "\n".join(unpack(message))
+
+
+def decode_parts(scanned: List[str]) -> str:
+    """The prescription text from all parts of one prescription."""
+    assembler = Reassembler()
+    text = None
+    for payload in scanned:
+        if payload.strip():
+            text = assembler.add(payload)
+    if text is None:
+        missing = assembler.missing()
+        raise ValueError(f"Missing QR part(s): {', '.join(map(str, missing))} of {assembler.count}"
+                         if missing else "No QR data")
+    return text
@@ -0,0 +1,99 @@
+#include "DispenseLog.h"
+
+static_assert(sizeof(DispenseLogRecord) == 16, "Dispense log records must stay 16 bytes");
+
+static DispenseLogRecord ring[DISPENSE_LOG_RAM_RECORDS];
+static uint8_t ringHead = 0;         // Next free slot
+static uint8_t ringCount = 0;
+static uint16_t nextSequence = 0;
+static unsigned long lastAddAt = 0;
+
+static uint8_t recordCheck(const DispenseLogRecord &record)
+{
+  const uint8_t *bytes = (const uint8_t *)&record;
+  uint8_t check = 0;
+  for (uint8_t i = 0; i < sizeof(record) - 1; i++)
+    check ^= bytes[i];
+  return check;
+}
+
+bool dispenseLogBegin(SdFat &sd)
+{
+  File f = sd.open(DISPENSE_LOG_FILE, FILE_WRITE);
+  if (!f)
+  {
+    Serial.println(F("Dispense log: cannot open"));
+    return false;
+  }
+
+  // A reset during a flush can leave a partial record at the end
+  uint32_t size = f.size();
+  uint32_t whole = size - size % sizeof(DispenseLogRecord);
+  if (whole != size)
+  {
+    Serial.println(F("Dispense log: dropping torn record"));
+    f.truncate(whole);
+  }
+  f.close();
+
+  nextSequence = whole / sizeof(DispenseLogRecord);
+  Serial.print(F("Dispense log: "));
+  Serial.print(whole / sizeof(DispenseLogRecord));
+  Serial.println(F(" records"));
+  return true;
+}
+
+void dispenseLogAdd(DispenseLogRecord &record)
+{
+  record.sequence = nextSequence++;
+  record.version = DISPENSE_LOG_VERSION;
+  record.check = recordCheck(record);
+
+  if (ringCount == DISPENSE_LOG_RAM_RECORDS)
+    ringCount--;                     // Oldest record is overwritten below
+  ring[ringHead] = record;
+  ringHead = (ringHead + 1) % DISPENSE_LOG_RAM_RECORDS;
+  ringCount++;
+  lastAddAt = millis();
+}
+
+bool dispenseLogFlushDue()
+{
+  return ringCount > 0 &&
+         (ringCount == DISPENSE_LOG_RAM_RECORDS || millis() - lastAddAt >= DISPENSE_LOG_IDLE_MS);
+}
+
+bool dispenseLogFlush(SdFat &sd)
+{
+  if (ringCount == 0)
+    return true;
+
+  File f = sd.open(DISPENSE_LOG_FILE, FILE_WRITE);
+  if (!f)
+  {
+    Serial.println(F("Dispense log: flush failed"));
+    lastAddAt = millis();            // Retry after another idle period
+    return false;
+  }
+
+  // The ring is at most two contiguous runs; write each in one call
+  uint8_t tail = (ringHead + DISPENSE_LOG_RAM_RECORDS - ringCount) % DISPENSE_LOG_RAM_RECORDS;
+  uint8_t firstRun = min(ringCount, (uint8_t)(DISPENSE_LOG_RAM_RECORDS - tail));
+  size_t written = f.write((const uint8_t *)&ring[tail], firstRun * sizeof(DispenseLogRecord));
+  if (firstRun < ringCount)
+    written += f.write((const uint8_t *)&ring[0], (ringCount - firstRun) * sizeof(DispenseLogRecord));
+  f.close();
+
+  if (written != ringCount * sizeof(DispenseLogRecord))
+  {
+    Serial.println(F("Dispense log: short write"));
+    lastAddAt = millis();
+    return false;
+  }
+
+  Serial.print(F("Dispense log: flushed "));
+  Serial.print(ringCount);
+  Serial.println(F(" records"));
+  ringCount = 0;
+  return true;
+}
@@ -0,0 +1,173 @@
+#include "DispenseTiming.h"
+#include "Dispenser.h"
+#include "EepromLayout.h"
+#include <EEPROM.h>
+
+#define TIMING_MAGIC 0xD7
+#define TIMING_VERSION 1
+
+struct TubeTiming
+{
+  uint8_t counts[TIMING_BUCKETS];
+  uint8_t missStreak;
+};
+
+struct TimingRecord
+{
+  uint8_t magic;
+  uint8_t version;
+  TubeTiming tubes[TIMING_TUBES];
+};
+
+static_assert(sizeof(TimingRecord) <= EEPROM_TIMING_SIZE, "Timing record overflows its EEPROM region");
+
+// Upper end of each latency bucket in ms; the last bucket runs to DISPENSE_TIMEOUT_MS
+static const uint16_t timingBucketEnd[TIMING_BUCKETS - 1] PROGMEM = {
+    400, 600, 800, 1000, 1500, 2000, 3000, 4500, 7000, 10000, 15000};
+
+static TimingRecord timing;
+
+static unsigned int bucketStart(uint8_t bucket)
+{
+  return bucket == 0 ? 0 : pgm_read_word(&timingBucketEnd[bucket - 1]);
+}
+
+static unsigned int bucketEnd(uint8_t bucket)
+{
+  return bucket == TIMING_BUCKETS - 1 ? DISPENSE_TIMEOUT_MS : pgm_read_word(&timingBucketEnd[bucket]);
+}
+
+static uint8_t bucketFor(unsigned long latency)
+{
+  uint8_t bucket = 0;
+  while (bucket < TIMING_BUCKETS - 1 && latency >= pgm_read_word(&timingBucketEnd[bucket]))
+    bucket++;
+  return bucket;
+}
+
+static unsigned int sampleCount(const TubeTiming &t)
+{
+  unsigned int total = 0;
+  for (uint8_t i = 0; i < TIMING_BUCKETS; i++)
+    total += t.counts[i];
+  return total;
+}
+
+// Bucket holding the given percentile of the tube's samples
+static uint8_t percentileBucket(const TubeTiming &t, unsigned int total, uint8_t percent)
+{
+  unsigned int wanted = ((unsigned long)total * percent + 99) / 100;
+  unsigned int seen = 0;
+  for (uint8_t i = 0; i < TIMING_BUCKETS; i++)
+  {
+    seen += t.counts[i];
+    if (seen >= wanted && seen > 0)
+      return i;
+  }
+  return TIMING_BUCKETS - 1;
+}
+
+void timingBegin()
+{
+  EEPROM.get(EEPROM_TIMING_ADDR, timing);
+  if (timing.magic != TIMING_MAGIC || timing.version != TIMING_VERSION)
+  {
+    Serial.println(F("No dispense timing history, starting fresh"));
+    memset(&timing, 0, sizeof(timing));
+    timing.magic = TIMING_MAGIC;
+    timing.version = TIMING_VERSION;
+    timingSave();
+  }
+}
+
+void timingRecord(uint8_t tube, bool detected, unsigned long latency)
+{
+  if (tube >= TIMING_TUBES)
+    return;
+
+  TubeTiming &t = timing.tubes[tube];
+  if (!detected)
+  {
+    // Censored sample: it says nothing about the latency, only that it was long
+    if (t.missStreak < 255)
+      t.missStreak++;
+    return;
+  }
+
+  t.missStreak = 0;
+  uint8_t bucket = bucketFor(latency);
+  if (t.counts[bucket] == 255)
+  {
+    // Age the whole histogram so it follows the tube as it empties
+    for (uint8_t i = 0; i < TIMING_BUCKETS; i++)
+      t.counts[i] >>= 1;
+  }
+  t.counts[bucket]++;
+}
+
+unsigned int timingStabilizeMs(uint8_t tube)
+{
+  if (tube >= TIMING_TUBES)
+    return STABILIZE_DELAY;
+
+  const TubeTiming &t = timing.tubes[tube];
+  unsigned int total = sampleCount(t);
+  if (total < TIMING_MIN_SAMPLES)
+    return STABILIZE_DELAY;
+
+  unsigned int window = bucketStart(percentileBucket(t, total, 5)) / 4 * 3;
+  return constrain(window, TIMING_STABILIZE_MIN_MS, STABILIZE_DELAY);
+}
+
+unsigned int timingTimeoutMs(uint8_t tube)
+{
+  if (tube >= TIMING_TUBES)
+    return DISPENSE_TIMEOUT_MS;
+
+  const TubeTiming &t = timing.tubes[tube];
+  if (t.missStreak >= TIMING_JAM_STREAK)
+    return TIMING_JAM_PROBE_MS;
+
+  unsigned int total = sampleCount(t);
+  if (total < TIMING_MIN_SAMPLES)
+    return DISPENSE_TIMEOUT_MS;
+
+  unsigned long window = (unsigned long)bucketEnd(percentileBucket(t, total, 95)) * 2;
+  return constrain(window, TIMING_TIMEOUT_MIN_MS, DISPENSE_TIMEOUT_MS);
+}
+
+bool timingJamSuspected(uint8_t tube)
+{
+  if (tube >= TIMING_TUBES)
+    return false;
+
+  // A tube with history missed twice its slow typical pill: that is a jam
+  // already, not a slow pill worth waiting the full timeout for again
+  const TubeTiming &t = timing.tubes[tube];
+  if (t.missStreak > 0 && sampleCount(t) >= TIMING_MIN_SAMPLES)
+    return true;
+  return t.missStreak >= TIMING_JAM_STREAK;
+}
+
+void timingSave()
+{
+  // EEPROM.put only rewrites bytes that changed, usually one count and a streak
+  EEPROM.put(EEPROM_TIMING_ADDR, timing);
+}
+
+void timingPrint()
+{
+  for (uint8_t tube = 0; tube < TIMING_TUBES; tube++)
+  {
+    Serial.print(F("Tube "));
+    Serial.print(tube + 1);
+    Serial.print(F(": samples="));
+    Serial.print(sampleCount(timing.tubes[tube]));
+    Serial.print(F(" stabilize="));
+    Serial.print(timingStabilizeMs(tube));
+    Serial.print(F("ms timeout="));
+    Serial.print(timingTimeoutMs(tube));
+    Serial.print(F("ms misses="));
+    Serial.println(timing.tubes[tube].missStreak);
+  }
+}
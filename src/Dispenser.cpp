@@ -0,0 +1,297 @@
+#include "Dispenser.h"
+#include "DispenseTiming.h"
+
+static TubeMapping *tubeTable = nullptr;
+static uint8_t tubeTableSize = 0;
+static uint8_t beamSensorPin = 0;
+
+static DispenseJob jobs[DISPENSE_MAX_JOBS];
+static uint8_t jobCount = 0;
+static uint8_t activeActuators = 0;
+static uint8_t actuatorLimit = MAX_ACTIVE_ACTUATORS;
+static int8_t beamOwner = -1;            // Job currently feeding, -1 if the beam is free
+static unsigned long beamReleasedAt = 0;
+static bool beamLatched = false;         // A counted pill is still in the beam
+static unsigned long beamClearAt = 0;    // When the beam last went clear, 0 while blocked
+
+void dispenserBegin(TubeMapping *tubes, uint8_t tubeCount, uint8_t beamPin)
+{
+  tubeTable = tubes;
+  tubeTableSize = tubeCount;
+  beamSensorPin = beamPin;
+  for (uint8_t i = 0; i < tubeCount; i++)
+    motorAttach(i, tubes[i].motorPin, &tubes[i].motor);
+  dispenserReset();
+  timingBegin();
+  timingPrint();
+}
+
+void dispenserSetActuatorLimit(uint8_t limit)
+{
+  actuatorLimit = max(limit, (uint8_t)1);
+}
+
+TubeMapping *getTubeMapping(const char *tubeName)
+{
+  for (int i = 0; i < tubeTableSize; i++)
+  {
+    if (strcmp(tubeTable[i].tubeName, tubeName) == 0)
+    {
+      return &tubeTable[i];
+    }
+  }
+  return nullptr;
+}
+
+static uint8_t tubeIndex(const TubeMapping *tube)
+{
+  return tube - tubeTable;
+}
+
+void dispenserReset()
+{
+  jobCount = 0;
+  activeActuators = 0;
+  beamOwner = -1;
+  beamReleasedAt = 0;
+}
+
+bool dispenserQueue(const char *tubeName, uint8_t pills)
+{
+  if (jobCount >= DISPENSE_MAX_JOBS)
+    return false;
+
+  DispenseJob &job = jobs[jobCount++];
+  job.tube = getTubeMapping(tubeName);
+  job.phase = PHASE_WAITING;
+  job.outcome = DISPENSE_PENDING;
+  job.phaseStart = 0;
+  job.latency = 0;
+  job.stabilizeMs = STABILIZE_DELAY;
+  job.timeoutMs = DISPENSE_TIMEOUT_MS;
+  job.pillsWanted = constrain(pills, 1, DISPENSE_MAX_PILLS);
+  job.pillsSeen = 0;
+  job.lastPillAt = 0;
+
+  if (job.tube == nullptr)
+  {
+    Serial.print(F("Unknown tube: "));
+    Serial.println(tubeName);
+    job.phase = PHASE_DONE;
+    job.outcome = DISPENSE_UNKNOWN_TUBE;
+  }
+  return true;
+}
+
+static bool beamBlocked()
+{
+  if (digitalRead(beamSensorPin) != LOW)
+    return false;
+  delayMicroseconds(50);
+  return digitalRead(beamSensorPin) == LOW;
+}
+
+// The feed window goes to the first job in queue order that is ready, so
+// pills still come out in schedule order.
+static bool nextToFeed(uint8_t index)
+{
+  for (uint8_t i = 0; i < index; i++)
+  {
+    if (jobs[i].phase <= PHASE_READY)
+      return false;
+  }
+  return true;
+}
+
+// Counts a pill on each clear -> blocked edge of the beam. The beam has to
+// stay clear for PILL_DEBOUNCE_MS before it is released, and edges closer
+// than PILL_MIN_GAP_MS to the previous pill are bounce from the same one.
+static bool countPill(DispenseJob &job, unsigned long now)
+{
+  if (beamBlocked())
+  {
+    beamClearAt = 0;
+    if (beamLatched || (job.pillsSeen > 0 && now - job.lastPillAt < PILL_MIN_GAP_MS))
+      return false;
+
+    beamLatched = true;
+    job.pillsSeen++;
+    job.lastPillAt = now;
+    return true;
+  }
+
+  if (beamLatched)
+  {
+    if (beamClearAt == 0)
+      beamClearAt = now | 1;
+    else if (now - beamClearAt >= PILL_DEBOUNCE_MS)
+      beamLatched = false;
+  }
+  return false;
+}
+
+static void startPhase(DispenseJob &job, uint8_t phase, unsigned long now)
+{
+  job.phase = phase;
+  job.phaseStart = now;
+}
+
+bool dispenserUpdate()
+{
+  bool busy = false;
+  unsigned long now = millis();
+  motorUpdate();
+
+  for (uint8_t i = 0; i < jobCount; i++)
+  {
+    DispenseJob &job = jobs[i];
+
+    switch (job.phase)
+    {
+    case PHASE_WAITING:
+      if (activeActuators < actuatorLimit)
+      {
+        Serial.print(F("Opening gate of "));
+        Serial.println(job.tube->tubeName);
+        job.tube->servo->sweepTo(SERVO_OPEN_POS, SERVO_SLEW_US, SERVO_ACCEL_US,
+                                 SERVO_GATE_HOLD_MS, SERVO_STANDBY_POS);
+        activeActuators++;
+        startPhase(job, PHASE_OPENING, now);
+      }
+      break;
+
+    case PHASE_OPENING:
+      if (!job.tube->servo->moving())
+      {
+        activeActuators--;
+        startPhase(job, PHASE_READY, now);
+      }
+      break;
+
+    case PHASE_READY:
+      if (beamOwner == -1 && now - beamReleasedAt >= BEAM_GAP_MS &&
+          activeActuators < actuatorLimit && nextToFeed(i))
+      {
+        job.stabilizeMs = timingStabilizeMs(tubeIndex(job.tube));
+        job.timeoutMs = timingTimeoutMs(tubeIndex(job.tube));
+        Serial.print(F("Dispensing "));
+        Serial.print(job.pillsWanted);
+        Serial.print(F(" from "));
+        Serial.print(job.tube->tubeName);
+        Serial.print(F(" (window "));
+        Serial.print(job.stabilizeMs);
+        Serial.print(F("-"));
+        Serial.print(job.timeoutMs);
+        Serial.println(F(" ms)"));
+        motorStart(tubeIndex(job.tube));
+        activeActuators++;
+        beamOwner = i;
+        beamLatched = false;
+        beamClearAt = 0;
+        startPhase(job, PHASE_FEEDING, now);
+      }
+      break;
+
+    case PHASE_FEEDING:
+    {
+      unsigned long elapsed = now - job.phaseStart;
+      if (elapsed >= job.stabilizeMs && countPill(job, now))
+      {
+        Serial.print(F("Pill "));
+        Serial.print(job.pillsSeen);
+        Serial.print(F(" of "));
+        Serial.println(job.pillsWanted);
+        if (job.pillsSeen == 1)
+        {
+          job.latency = elapsed;
+          timingRecord(tubeIndex(job.tube), true, elapsed);
+          // Slow down for the rest of the dose so pills do not come out in pairs
+          if (job.pillsWanted > 1)
+            motorCoast(tubeIndex(job.tube));
+        }
+      }
+
+      bool complete = job.pillsSeen >= job.pillsWanted;
+      // After the first pill the timeout runs from the previous pill
+      unsigned long waited = job.pillsSeen > 0 ? now - job.lastPillAt : elapsed;
+      if (complete || waited >= job.timeoutMs)
+      {
+        if (complete)
+          Serial.println(F("Beam blocked → stopping motor"));
+        motorStop(tubeIndex(job.tube));
+
+        bool jammed = false;
+        if (!complete)
+        {
+          timingRecord(tubeIndex(job.tube), false, waited);
+          jammed = job.pillsSeen == 0 && timingJamSuspected(tubeIndex(job.tube));
+        }
+        job.outcome = complete ? DISPENSE_OK : (jammed ? DISPENSE_JAMMED : DISPENSE_TIMEOUT);
+        if (job.pillsSeen == 0)
+          job.latency = elapsed;
+        beamOwner = -1;
+        beamReleasedAt = now;
+
+        // The motor's actuator slot goes straight to the closing servo
+        Serial.print(F("Closing gate of "));
+        Serial.println(job.tube->tubeName);
+        job.tube->servo->sweepTo(SERVO_CLOSE_POS, SERVO_SLEW_US, SERVO_ACCEL_US,
+                                 SERVO_GATE_HOLD_MS, SERVO_STANDBY_POS);
+        startPhase(job, PHASE_CLOSING, now);
+
+        if (complete)
+          Serial.println(F("Dispensing complete."));
+        else if (jammed)
+          Serial.println(F("Timeout: tube looks jammed."));
+        else if (job.pillsSeen > 0)
+          Serial.println(F("Timeout: dose incomplete."));
+        else
+          Serial.println(F("Timeout: No detection."));
+      }
+      break;
+    }
+
+    case PHASE_CLOSING:
+      if (!job.tube->servo->moving())
+      {
+        activeActuators--;
+        startPhase(job, PHASE_DONE, now);
+      }
+      break;
+    }
+
+    if (job.phase != PHASE_DONE)
+      busy = true;
+  }
+  return busy;
+}
+
+bool dispenserBusy()
+{
+  for (uint8_t i = 0; i < jobCount; i++)
+  {
+    if (jobs[i].phase != PHASE_DONE)
+      return true;
+  }
+  return false;
+}
+
+void runDispenseSequence()
+{
+  // Tight loop: the beam is polled, so a falling pill must not be missed
+  while (dispenserUpdate())
+  {
+    delayMicroseconds(200);
+  }
+  timingSave();
+}
+
+uint8_t dispenserJobCount()
+{
+  return jobCount;
+}
+
+const DispenseJob *dispenserJob(uint8_t index)
+{
+  return index < jobCount ? &jobs[index] : nullptr;
+}
@@ -0,0 +1,259 @@
+#include "DoseState.h"
+#include "EepromLayout.h"
+#include <EEPROM.h>
+
+#define DOSE_MAGIC 0xD5
+#define DOSE_VERSION 1
+#define DOSE_EMPTY 0xFFFF
+#define MINUTES_PER_DAY 1440
+
+struct DoseEntry
+{
+  uint16_t minute;                   // Key, DOSE_EMPTY for a free slot
+  uint16_t day;                      // Day number of the occurrence the state belongs to
+  uint8_t state;
+  uint8_t group;                     // Index into groupedSchedules
+};
+
+struct SavedDose
+{
+  uint16_t minute;
+  uint16_t day;
+  uint8_t state;
+};
+
+struct DoseRecord
+{
+  uint8_t magic;
+  uint8_t version;
+  SavedDose doses[DOSE_SLOTS];
+};
+
+static_assert(sizeof(DoseRecord) <= EEPROM_DOSE_SIZE, "Dose record overflows its EEPROM region");
+static_assert((DOSE_SLOTS & (DOSE_SLOTS - 1)) == 0, "DOSE_SLOTS must be a power of two");
+
+static DoseEntry table[DOSE_SLOTS];
+static int8_t groupSlot[DOSE_SLOTS]; // Table slot of each group, -1 if none
+static SavedDose saved[DOSE_SLOTS];  // States carried across a rebuild
+static uint8_t savedCount = 0;
+static int8_t dueGroup = -1;
+static bool tableBuilt = false;
+
+static uint8_t hashMinute(uint16_t minute)
+{
+  return (minute * 7) & (DOSE_SLOTS - 1);
+}
+
+static DoseEntry *findMinute(uint16_t minute)
+{
+  uint8_t slot = hashMinute(minute);
+  for (uint8_t probe = 0; probe < DOSE_SLOTS; probe++)
+  {
+    DoseEntry &entry = table[slot];
+    if (entry.minute == minute)
+      return &entry;
+    if (entry.minute == DOSE_EMPTY)
+      return nullptr;
+    slot = (slot + 1) & (DOSE_SLOTS - 1);
+  }
+  return nullptr;
+}
+
+static DoseEntry *findGroup(uint8_t group)
+{
+  if (group >= DOSE_SLOTS || groupSlot[group] < 0)
+    return nullptr;
+  return &table[groupSlot[group]];
+}
+
+static void save()
+{
+  DoseRecord record;
+  record.magic = DOSE_MAGIC;
+  record.version = DOSE_VERSION;
+  for (uint8_t i = 0; i < DOSE_SLOTS; i++)
+  {
+    record.doses[i].minute = table[i].minute;
+    record.doses[i].day = table[i].day;
+    record.doses[i].state = table[i].state;
+  }
+  // Only changed bytes are written: usually one state and maybe a day
+  EEPROM.put(EEPROM_DOSE_ADDR, record);
+}
+
+void doseBegin()
+{
+  DoseRecord record;
+  EEPROM.get(EEPROM_DOSE_ADDR, record);
+  savedCount = 0;
+  if (record.magic != DOSE_MAGIC || record.version != DOSE_VERSION)
+  {
+    Serial.println(F("No dose states saved"));
+    return;
+  }
+  for (uint8_t i = 0; i < DOSE_SLOTS; i++)
+  {
+    if (record.doses[i].minute != DOSE_EMPTY)
+      saved[savedCount++] = record.doses[i];
+  }
+}
+
+void doseClear()
+{
+  // Keep the current states so doseCommit() can carry them over; before
+  // the first build the states loaded by doseBegin() are kept instead
+  if (tableBuilt)
+  {
+    savedCount = 0;
+    for (uint8_t i = 0; i < DOSE_SLOTS; i++)
+    {
+      if (table[i].minute != DOSE_EMPTY)
+      {
+        saved[savedCount].minute = table[i].minute;
+        saved[savedCount].day = table[i].day;
+        saved[savedCount].state = table[i].state;
+        savedCount++;
+      }
+    }
+  }
+
+  for (uint8_t i = 0; i < DOSE_SLOTS; i++)
+  {
+    table[i].minute = DOSE_EMPTY;
+    table[i].day = 0;
+    table[i].state = DOSE_NONE;
+    groupSlot[i] = -1;
+  }
+  dueGroup = -1;
+}
+
+void doseAddSlot(uint16_t minute, uint8_t group)
+{
+  if (minute >= MINUTES_PER_DAY || group >= DOSE_SLOTS || findMinute(minute))
+    return;
+
+  uint8_t slot = hashMinute(minute);
+  while (table[slot].minute != DOSE_EMPTY)
+    slot = (slot + 1) & (DOSE_SLOTS - 1);
+
+  table[slot].minute = minute;
+  table[slot].day = 0;
+  table[slot].state = DOSE_PENDING;
+  table[slot].group = group;
+  groupSlot[group] = slot;
+}
+
+void doseCommit()
+{
+  for (uint8_t i = 0; i < savedCount; i++)
+  {
+    DoseEntry *entry = findMinute(saved[i].minute);
+    if (entry)
+    {
+      entry->day = saved[i].day;
+      entry->state = saved[i].state;
+    }
+  }
+  savedCount = 0;
+  tableBuilt = true;
+  save();
+}
+
+uint16_t doseUpdate(uint16_t day, uint16_t minute)
+{
+  uint16_t missed = 0;
+  bool changed = false;
+  int8_t due = -1;
+  uint16_t dueLate = 0;
+
+  for (uint8_t i = 0; i < DOSE_SLOTS; i++)
+  {
+    DoseEntry &entry = table[i];
+    if (entry.minute == DOSE_EMPTY)
+      continue;
+
+    // The occurrence that matters now: today's once its time has come,
+    // yesterday's while its grace window still runs past midnight
+    uint16_t occurrence = day;
+    uint16_t late = 0;
+    bool started = minute >= entry.minute;
+    if (started)
+      late = minute - entry.minute;
+    else if (minute + MINUTES_PER_DAY - entry.minute < DOSE_GRACE_MIN)
+    {
+      occurrence = day - 1;
+      late = minute + MINUTES_PER_DAY - entry.minute;
+      started = true;
+    }
+
+    bool fresh = entry.day == 0;     // Slot new to this schedule, no history
+    if (entry.day != occurrence)
+    {
+      // A new occurrence: the previous one is over, missed if it was never
+      // taken (the device was off when its grace window ran out)
+      if (!fresh && (entry.state == DOSE_PENDING || entry.state == DOSE_NOTIFIED))
+        missed |= 1 << entry.group;
+      entry.day = occurrence;
+      entry.state = DOSE_PENDING;
+      changed = true;
+    }
+
+    if (!started)
+      continue;
+
+    if (late >= DOSE_GRACE_MIN)
+    {
+      if (entry.state == DOSE_PENDING || entry.state == DOSE_NOTIFIED)
+      {
+        // A schedule loaded after a slot's window closed does not count it as missed
+        entry.state = DOSE_MISSED;
+        if (!fresh)
+          missed |= 1 << entry.group;
+        changed = true;
+      }
+    }
+    else if ((entry.state == DOSE_PENDING || entry.state == DOSE_NOTIFIED) && (due < 0 || late > dueLate))
+    {
+      due = entry.group;
+      dueLate = late;
+    }
+  }
+
+  dueGroup = due;
+  if (changed)
+    save();
+  return missed;
+}
+
+int8_t doseDueGroup()
+{
+  return dueGroup;
+}
+
+uint8_t doseState(uint8_t group)
+{
+  DoseEntry *entry = findGroup(group);
+  return entry ? entry->state : DOSE_NONE;
+}
+
+void doseNotified(uint8_t group)
+{
+  DoseEntry *entry = findGroup(group);
+  if (entry && entry->state == DOSE_PENDING)
+  {
+    entry->state = DOSE_NOTIFIED;
+    save();
+  }
+}
+
+void doseDispensed(uint8_t group)
+{
+  DoseEntry *entry = findGroup(group);
+  if (entry && entry->state != DOSE_DISPENSED)
+  {
+    entry->state = DOSE_DISPENSED;
+    if (dueGroup == group)
+      dueGroup = -1;
+    save();
+  }
+}
@@ -0,0 +1,131 @@
+#include "Inventory.h"
+#include "EepromLayout.h"
+#include <EEPROM.h>
+
+struct InventorySlot
+{
+  uint16_t sequence;
+  uint16_t stock[INVENTORY_TUBES];
+  uint8_t version;
+  uint8_t check;
+};
+
+#define INVENTORY_VERSION 1
+
+static_assert(sizeof(InventorySlot) == EEPROM_INVENTORY_SLOT_SIZE, "Inventory slot size changed");
+
+static uint16_t stock[INVENTORY_TUBES];
+static uint8_t dailyUse[INVENTORY_TUBES];
+static uint16_t daysLeft[INVENTORY_TUBES];
+static uint8_t lowMask = 0;
+static bool stockDirty = false;
+static uint8_t currentSlot = EEPROM_INVENTORY_SLOTS - 1;  // Slot of the newest snapshot
+static uint16_t currentSequence = 0;
+
+static uint8_t slotCheck(const InventorySlot &slot)
+{
+  const uint8_t *bytes = (const uint8_t *)&slot;
+  uint8_t check = 0x5A;
+  for (uint8_t i = 0; i < sizeof(slot) - 1; i++)
+    check ^= bytes[i];
+  return check;
+}
+
+static int slotAddress(uint8_t slot)
+{
+  return EEPROM_INVENTORY_ADDR + slot * EEPROM_INVENTORY_SLOT_SIZE;
+}
+
+static void recompute()
+{
+  lowMask = 0;
+  for (uint8_t i = 0; i < INVENTORY_TUBES; i++)
+  {
+    bool known = stock[i] != INVENTORY_UNKNOWN;
+    daysLeft[i] = dailyUse[i] == 0 || !known ? INVENTORY_NO_USE : stock[i] / dailyUse[i];
+    if (daysLeft[i] < INVENTORY_LOW_DAYS)
+      lowMask |= 1 << i;
+  }
+}
+
+void inventoryBegin()
+{
+  // The newest valid slot wins; sequence comparison tolerates wrap-around
+  bool found = false;
+  InventorySlot slot;
+  for (uint8_t i = 0; i < EEPROM_INVENTORY_SLOTS; i++)
+  {
+    EEPROM.get(slotAddress(i), slot);
+    if (slot.version != INVENTORY_VERSION || slot.check != slotCheck(slot))
+      continue;
+    if (!found || (int16_t)(slot.sequence - currentSequence) > 0)
+    {
+      found = true;
+      currentSlot = i;
+      currentSequence = slot.sequence;
+      memcpy(stock, slot.stock, sizeof(stock));
+    }
+  }
+
+  if (!found)
+  {
+    Serial.println(F("No inventory saved, stock unknown until tubes are filled"));
+    for (uint8_t i = 0; i < INVENTORY_TUBES; i++)
+      stock[i] = INVENTORY_UNKNOWN;
+  }
+  recompute();
+}
+
+void inventorySetStock(uint8_t tube, uint16_t pills)
+{
+  if (tube >= INVENTORY_TUBES)
+    return;
+  stock[tube] = min(pills, (uint16_t)(INVENTORY_UNKNOWN - 1));
+  stockDirty = true;
+}
+
+void inventoryConsume(uint8_t tube, uint8_t pills)
+{
+  if (tube >= INVENTORY_TUBES || pills == 0 || stock[tube] == INVENTORY_UNKNOWN)
+    return;
+  stock[tube] = stock[tube] > pills ? stock[tube] - pills : 0;
+  stockDirty = true;
+}
+
+void inventoryClearUse()
+{
+  memset(dailyUse, 0, sizeof(dailyUse));
+}
+
+void inventoryAddUse(uint8_t tube, uint8_t pillsPerDay)
+{
+  if (tube < INVENTORY_TUBES)
+    dailyUse[tube] += pillsPerDay;
+}
+
+void inventoryCommit()
+{
+  recompute();
+  if (!stockDirty)
+    return;
+
+  InventorySlot slot;
+  slot.sequence = ++currentSequence;
+  memcpy(slot.stock, stock, sizeof(stock));
+  slot.version = INVENTORY_VERSION;
+  slot.check = slotCheck(slot);
+
+  currentSlot = (currentSlot + 1) % EEPROM_INVENTORY_SLOTS;
+  EEPROM.put(slotAddress(currentSlot), slot);
+  stockDirty = false;
+}
+
+uint16_t inventoryDaysLeft(uint8_t tube)
+{
+  return tube < INVENTORY_TUBES ? daysLeft[tube] : INVENTORY_NO_USE;
+}
+
+uint8_t inventoryLowMask()
+{
+  return lowMask;
+}
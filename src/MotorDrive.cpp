@@ -0,0 +1,135 @@
+#include "MotorDrive.h"
+
+#define MOTOR_OFF 0
+#define MOTOR_RAMP 1
+#define MOTOR_RUN 2
+#define MOTOR_COAST 3
+#define MOTOR_BRAKE 4
+
+struct MotorChannel
+{
+  const MotorProfile *profile;
+  uint8_t pin;
+  uint8_t state;
+  uint8_t duty;
+  unsigned long stateStart;
+};
+
+static MotorChannel motors[MOTOR_MAX];
+
+static void setDuty(MotorChannel &m, uint8_t duty)
+{
+  if (duty == m.duty)
+    return;
+  m.duty = duty;
+#if MOTOR_PWM
+  analogWrite(m.pin, duty);
+#else
+  digitalWrite(m.pin, duty ? HIGH : LOW);
+#endif
+}
+
+static void setState(MotorChannel &m, uint8_t state)
+{
+  m.state = state;
+  m.stateStart = millis();
+}
+
+void motorAttach(uint8_t motor, uint8_t pin, const MotorProfile *profile)
+{
+  if (motor >= MOTOR_MAX)
+    return;
+
+  MotorChannel &m = motors[motor];
+  m.profile = profile;
+  m.pin = pin;
+  m.state = MOTOR_OFF;
+  m.duty = 0;
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, LOW);
+  if (profile->brakePin >= 0)
+  {
+    pinMode(profile->brakePin, OUTPUT);
+    digitalWrite(profile->brakePin, LOW);
+  }
+}
+
+void motorStart(uint8_t motor)
+{
+  if (motor >= MOTOR_MAX || motors[motor].profile == nullptr)
+    return;
+
+  MotorChannel &m = motors[motor];
+  Serial.print(F("Starting motor on pin "));
+  Serial.println(m.pin);
+  if (m.profile->brakePin >= 0)
+    digitalWrite(m.profile->brakePin, LOW);
+#if MOTOR_PWM
+  setDuty(m, m.profile->startDuty);
+  setState(m, MOTOR_RAMP);
+#else
+  setDuty(m, 255);
+  setState(m, MOTOR_RUN);
+#endif
+}
+
+void motorCoast(uint8_t motor)
+{
+  if (motor >= MOTOR_MAX || motors[motor].state == MOTOR_OFF || motors[motor].state == MOTOR_BRAKE)
+    return;
+
+  MotorChannel &m = motors[motor];
+#if MOTOR_PWM
+  setDuty(m, m.profile->coastDuty);
+#endif
+  setState(m, MOTOR_COAST);
+}
+
+void motorStop(uint8_t motor)
+{
+  if (motor >= MOTOR_MAX || motors[motor].profile == nullptr)
+    return;
+
+  MotorChannel &m = motors[motor];
+  Serial.print(F("Stopping motor on pin "));
+  Serial.println(m.pin);
+  setDuty(m, 0);
+  if (m.profile->brakePin >= 0)
+  {
+    digitalWrite(m.profile->brakePin, HIGH);
+    setState(m, MOTOR_BRAKE);
+  }
+  else
+  {
+    setState(m, MOTOR_OFF);
+  }
+}
+
+void motorUpdate()
+{
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < MOTOR_MAX; i++)
+  {
+    MotorChannel &m = motors[i];
+    unsigned long elapsed = now - m.stateStart;
+
+    if (m.state == MOTOR_RAMP)
+    {
+      const MotorProfile *p = m.profile;
+      if (elapsed >= p->rampMs)
+      {
+        setDuty(m, p->runDuty);
+        m.state = MOTOR_RUN;
+      }
+      else
+      {
+        setDuty(m, p->startDuty + (long)(p->runDuty - p->startDuty) * elapsed / p->rampMs);
+      }
+    }
+    else if (m.state == MOTOR_BRAKE && elapsed >= MOTOR_BRAKE_MS)
+    {
+      digitalWrite(m.profile->brakePin, LOW);
+      m.state = MOTOR_OFF;
+    }
+  }
+}
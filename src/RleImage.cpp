@@ -0,0 +1,77 @@
+#include "RleImage.h"
+#include <avr/pgmspace.h>
+
+uint16_t rleImageWidth(const RleImage *image)
+{
+  return pgm_read_word(&image->width);
+}
+
+uint16_t rleImageHeight(const RleImage *image)
+{
+  return pgm_read_word(&image->height);
+}
+
+bool drawRleImage(Adafruit_SPITFT &tft, int16_t x, int16_t y, const RleImage *image)
+{
+  RleImage img;
+  memcpy_P(&img, image, sizeof(img));
+
+  if (img.paletteSize == 0 || img.paletteSize > RLE_MAX_PALETTE)
+    return false;
+
+  // Visible part of the image, in image coordinates
+  int16_t clipLeft = x < 0 ? -x : 0;
+  int16_t clipTop = y < 0 ? -y : 0;
+  int16_t clipRight = min((int16_t)img.width, (int16_t)(tft.width() - x));
+  int16_t clipBottom = min((int16_t)img.height, (int16_t)(tft.height() - y));
+  if (clipLeft >= clipRight || clipTop >= clipBottom)
+    return false;
+
+  bool clipped = clipLeft > 0 || clipTop > 0 || clipRight < (int16_t)img.width || clipBottom < (int16_t)img.height;
+
+  uint16_t palette[RLE_MAX_PALETTE];
+  memcpy_P(palette, img.palette, img.paletteSize * sizeof(uint16_t));
+
+  int16_t row = 0;
+  int16_t col = 0;
+
+  tft.startWrite();
+  if (!clipped)
+    tft.setAddrWindow(x, y, img.width, img.height);
+
+  for (uint16_t i = 0; i < img.dataSize && row < clipBottom; i++)
+  {
+    uint8_t run = pgm_read_byte(img.data + i);
+    uint8_t index = run >> 4;
+    int16_t length = (run & 0x0F) + 1;
+
+    if (index >= img.paletteSize || col + length > (int16_t)img.width)
+      break;
+
+    if (!clipped)
+    {
+      tft.writeColor(palette[index], length);
+    }
+    else if (row >= clipTop)
+    {
+      // Partially visible images get one address window per row
+      if (col == 0)
+        tft.setAddrWindow(x + clipLeft, y + row, clipRight - clipLeft, 1);
+
+      int16_t from = max(col, clipLeft);
+      int16_t to = min((int16_t)(col + length), clipRight);
+      if (to > from)
+        tft.writeColor(palette[index], to - from);
+    }
+
+    col += length;
+    if (col == (int16_t)img.width)
+    {
+      col = 0;
+      row++;
+    }
+  }
+  tft.endWrite();
+
+  return row == clipBottom;
+}
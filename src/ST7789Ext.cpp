@@ -0,0 +1,64 @@
+#include "ST7789Ext.h"
+
+ST7789Ext::ST7789Ext(int8_t cs, int8_t dc, int8_t rst)
+    : Adafruit_ST7789(cs, dc, rst),
+      nativeHeight(ST7789_MEMORY_ROWS),
+      rowOffset(0)
+{
+}
+
+void ST7789Ext::init(uint16_t width, uint16_t height, uint8_t spiMode)
+{
+  Adafruit_ST7789::init(width, height, spiMode);
+
+  // Same centring the Adafruit driver applies to short glasses (240x280 etc.)
+  nativeHeight = height;
+  rowOffset = (ST7789_MEMORY_ROWS - height) / 2;
+}
+
+bool ST7789Ext::panelRowsForScreenSpan(int16_t pos, int16_t len, uint16_t &firstRow, uint16_t &lastRow) const
+{
+  int16_t start = max(pos, (int16_t)0);
+  int16_t end = min((int16_t)(pos + len), (int16_t)nativeHeight) - 1;
+  if (end < start)
+    return false;
+
+  // Rotations 1 and 2 set MADCTL.MY, which runs the gate lines backwards
+  // relative to the screen axis they map to.
+  uint8_t rotation = getRotation();
+  if (rotation == 1 || rotation == 2)
+  {
+    firstRow = nativeHeight - 1 - end;
+    lastRow = nativeHeight - 1 - start;
+  }
+  else
+  {
+    firstRow = start;
+    lastRow = end;
+  }
+  return true;
+}
+
+void ST7789Ext::writeRowPair(uint8_t command, uint16_t first, uint16_t second)
+{
+  uint8_t data[4] = {(uint8_t)(first >> 8), (uint8_t)first,
+                     (uint8_t)(second >> 8), (uint8_t)second};
+  sendCommand(command, data, 4);
+}
+
+void ST7789Ext::setPartialArea(uint16_t firstRow, uint16_t lastRow)
+{
+  if (lastRow >= nativeHeight)
+    lastRow = nativeHeight - 1;
+  writeRowPair(ST7789_PTLAR, rowOffset + firstRow, rowOffset + lastRow);
+}
+
+void ST7789Ext::enablePartialMode(bool enable)
+{
+  sendCommand(enable ? ST7789_PTLON : ST7789_NORON);
+}
+
+void ST7789Ext::enableIdleMode(bool enable)
+{
+  sendCommand(enable ? ST7789_IDMON : ST7789_IDMOFF);
+}
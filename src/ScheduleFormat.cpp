@@ -0,0 +1,422 @@
+#include "ScheduleFormat.h"
+#include "Dispenser.h"
+#include "UploadLink.h"
+
+// Lets the Stream-based readers below parse a delta held in a link frame
+class BufferStream : public Stream
+{
+public:
+  BufferStream(const uint8_t *data, uint8_t len) : data(data), len(len), pos(0) {}
+  int available() { return len - pos; }
+  int read() { return pos < len ? data[pos++] : -1; }
+  int peek() { return pos < len ? data[pos] : -1; }
+  size_t write(uint8_t) { return 0; }
+
+private:
+  const uint8_t *data;
+  uint8_t len;
+  uint8_t pos;
+};
+
+// Feeds everything printed to it through the link CRC
+class CrcPrint : public Print
+{
+public:
+  uint16_t crc = 0xFFFF;
+  size_t write(uint8_t b)
+  {
+    crc = linkCrc16(crc, &b, 1);
+    return 1;
+  }
+};
+
+// Pill count from a dosage such as "2 tablets"; anything without a leading
+// number (or a fraction like "1/2") is one pill.
+uint8_t parseDosagePills(const char *dosage)
+{
+  while (*dosage == ' ')
+    dosage++;
+
+  int pills = 0;
+  while (isdigit(*dosage) && pills <= DISPENSE_MAX_PILLS)
+  {
+    pills = pills * 10 + (*dosage - '0');
+    dosage++;
+  }
+  if (*dosage == '/' || *dosage == '.' || pills < 1)
+    return 1;
+  return min(pills, DISPENSE_MAX_PILLS);
+}
+
+bool scheduleIsBinary(const uint8_t *head, uint8_t len)
+{
+  return len >= 4 && memcmp(head, SCHEDULE_MAGIC, 3) == 0 && head[3] == SCHEDULE_VERSION;
+}
+
+// File streams return -1 at the end instead of blocking, so a
+// truncated file fails fast rather than through Stream timeouts.
+static bool readByte(Stream &in, uint8_t &b)
+{
+  int c = in.read();
+  if (c < 0)
+    return false;
+  b = c;
+  return true;
+}
+
+static bool readWord(Stream &in, uint16_t &w)
+{
+  uint8_t lo, hi;
+  if (!readByte(in, lo) || !readByte(in, hi))
+    return false;
+  w = lo | ((uint16_t)hi << 8);
+  return true;
+}
+
+// Reads len bytes, keeping what fits in dest (size includes the terminator)
+static bool readText(Stream &in, uint8_t len, char *dest, uint8_t size)
+{
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < len; i++)
+  {
+    uint8_t b;
+    if (!readByte(in, b))
+      return false;
+    if (kept < size - 1)
+      dest[kept++] = b;
+  }
+  dest[kept] = '\0';
+  return true;
+}
+
+static bool readCoded(Stream &in, uint8_t &code, char *dest, uint8_t size)
+{
+  if (!readByte(in, code))
+    return false;
+  if (code & SCHEDULE_TEXT_FLAG)
+    return readText(in, code & ~SCHEDULE_TEXT_FLAG, dest, size);
+  return true;
+}
+
+static void formatMinute(char *time, uint16_t minute)
+{
+  uint8_t hours = minute / 60;
+  uint8_t mins = minute % 60;
+  time[0] = '0' + hours / 10;
+  time[1] = '0' + hours % 10;
+  time[2] = ':';
+  time[3] = '0' + mins / 10;
+  time[4] = '0' + mins % 10;
+  time[5] = '\0';
+}
+
+// "HH:MM", also taking the "H:MM" a hand-edited data.json may hold
+static uint16_t timeToMinute(const char *time)
+{
+  uint16_t hours = 0, mins = 0;
+  while (isdigit(*time))
+    hours = hours * 10 + (*time++ - '0');
+  if (*time == ':')
+    time++;
+  while (isdigit(*time))
+    mins = mins * 10 + (*time++ - '0');
+  return hours * 60 + mins;
+}
+
+int scheduleDecode(Stream &in, MedicationTime *out, int maxCount)
+{
+  uint8_t head[5];
+  for (uint8_t i = 0; i < sizeof(head); i++)
+  {
+    if (!readByte(in, head[i]))
+      return -1;
+  }
+  if (!scheduleIsBinary(head, 4))
+    return -1;
+
+  int count = 0;
+  for (uint8_t med = 0; med < head[4]; med++)
+  {
+    char tube[8];
+    char name[24];
+    uint8_t tubeCode, nameLen, timeCount;
+    uint16_t amount;
+
+    if (!readCoded(in, tubeCode, tube, sizeof(tube)) || !readWord(in, amount) ||
+        !readByte(in, nameLen) || !readText(in, nameLen, name, sizeof(name)) ||
+        !readByte(in, timeCount))
+      return -1;
+    if (!(tubeCode & SCHEDULE_TEXT_FLAG))
+      snprintf(tube, sizeof(tube), "tube%u", (unsigned)tubeCode);
+
+    for (uint8_t t = 0; t < timeCount; t++)
+    {
+      uint16_t minute;
+      uint8_t dosageCode;
+      char dosage[16];
+
+      if (!readWord(in, minute) || !readCoded(in, dosageCode, dosage, sizeof(dosage)) || minute >= 1440)
+        return -1;
+      if (count >= maxCount)
+        continue;                    // Same as the JSON loader: extra times are dropped
+
+      MedicationTime &entry = out[count++];
+      strcpy(entry.tube, tube);
+      strcpy(entry.medication, name);
+      entry.amount = amount;
+      formatMinute(entry.time, minute);
+      if (dosageCode & SCHEDULE_TEXT_FLAG)
+      {
+        strcpy(entry.dosage, dosage);
+        entry.pills = parseDosagePills(dosage);
+      }
+      else
+      {
+        snprintf(entry.dosage, sizeof(entry.dosage), dosageCode == 1 ? "%u tablet" : "%u tablets", (unsigned)dosageCode);
+        entry.pills = constrain(dosageCode, 1, DISPENSE_MAX_PILLS);
+      }
+    }
+  }
+  return count;
+}
+
+// Codes a numbered tube ("tube3") or dosage ("2 tablets"), 0 if it needs text
+static uint8_t tubeCode(const char *tube)
+{
+  if (strncmp(tube, "tube", 4) != 0 || tube[4] < '1' || tube[4] > '9')
+    return 0;
+  if (tube[5] == '\0')
+    return tube[4] - '0';
+  if (isdigit(tube[5]) && tube[6] == '\0')
+    return (tube[4] - '0') * 10 + (tube[5] - '0');
+  return 0;
+}
+
+static uint8_t dosageCode(const char *dosage)
+{
+  if (dosage[0] < '1' || dosage[0] > '9')
+    return 0;
+  const char *unit = dosage[0] == '1' ? " tablet" : " tablets";
+  return strcmp(dosage + 1, unit) == 0 ? dosage[0] - '0' : 0;
+}
+
+static void writeText(Print &out, const char *text, uint8_t flag)
+{
+  uint8_t len = strlen(text);
+  out.write(flag | len);
+  out.write((const uint8_t *)text, len);
+}
+
+static void writeWord(Print &out, uint16_t w)
+{
+  out.write(w & 0xFF);
+  out.write(w >> 8);
+}
+
+static bool sameMedication(const MedicationTime &a, const MedicationTime &b)
+{
+  return strcmp(a.tube, b.tube) == 0 && strcmp(a.medication, b.medication) == 0 && a.amount == b.amount;
+}
+
+void scheduleEncode(Print &out, const MedicationTime *table, int count)
+{
+  // Consecutive entries of one medication share a medication record
+  uint8_t meds = 0;
+  for (int i = 0; i < count; i++)
+  {
+    if (i == 0 || !sameMedication(table[i], table[i - 1]))
+      meds++;
+  }
+
+  out.write((const uint8_t *)SCHEDULE_MAGIC, 3);
+  out.write(SCHEDULE_VERSION);
+  out.write(meds);
+
+  for (int i = 0; i < count;)
+  {
+    int end = i + 1;
+    while (end < count && sameMedication(table[end], table[i]))
+      end++;
+
+    uint8_t code = tubeCode(table[i].tube);
+    if (code)
+      out.write(code);
+    else
+      writeText(out, table[i].tube, SCHEDULE_TEXT_FLAG);
+    writeWord(out, table[i].amount);
+    writeText(out, table[i].medication, 0);
+    out.write(end - i);
+
+    for (; i < end; i++)
+    {
+      writeWord(out, timeToMinute(table[i].time));
+      code = dosageCode(table[i].dosage);
+      if (code)
+        out.write(code);
+      else
+        writeText(out, table[i].dosage, SCHEDULE_TEXT_FLAG);
+    }
+  }
+}
+
+uint16_t scheduleFingerprint(const MedicationTime *table, int count)
+{
+  CrcPrint crc;
+  scheduleEncode(crc, table, count);
+  return crc.crc;
+}
+
+bool scheduleReadDelta(const uint8_t *data, uint8_t len, ScheduleDelta &delta)
+{
+  BufferStream in(data, len);
+  uint8_t code, nameLen;
+
+  memset(&delta, 0, sizeof(delta));
+  if (!readByte(in, delta.op))
+    return false;
+  if (delta.op == SCHEDULE_OP_BASE)
+    return readWord(in, delta.minute);
+
+  if (!readCoded(in, code, delta.tube, sizeof(delta.tube)))
+    return false;
+  if (!(code & SCHEDULE_TEXT_FLAG))
+    snprintf(delta.tube, sizeof(delta.tube), "tube%u", (unsigned)code);
+
+  switch (delta.op)
+  {
+  case SCHEDULE_OP_ADD_TIME:
+  case SCHEDULE_OP_MODIFY_MED:
+    if (!readWord(in, delta.amount) || !readByte(in, nameLen) ||
+        !readText(in, nameLen, delta.name, sizeof(delta.name)))
+      return false;
+    if (delta.op == SCHEDULE_OP_MODIFY_MED)
+      return true;
+    if (!readWord(in, delta.minute))
+      return false;
+    break;
+  case SCHEDULE_OP_REMOVE_TIME:
+    return readWord(in, delta.minute) && delta.minute < 1440;
+  case SCHEDULE_OP_MODIFY_TIME:
+    if (!readWord(in, delta.minute) || !readWord(in, delta.newMinute) || delta.newMinute >= 1440)
+      return false;
+    break;
+  case SCHEDULE_OP_REMOVE_MED:
+    return true;
+  default:
+    return false;
+  }
+
+  // ADD_TIME and MODIFY_TIME end with a dosage
+  if (!readCoded(in, code, delta.dosage, sizeof(delta.dosage)) || delta.minute >= 1440)
+    return false;
+  if (!(code & SCHEDULE_TEXT_FLAG))
+    snprintf(delta.dosage, sizeof(delta.dosage), code == 1 ? "%u tablet" : "%u tablets", (unsigned)code);
+  return true;
+}
+
+static void setTime(MedicationTime &entry, uint16_t minute, const char *dosage)
+{
+  formatMinute(entry.time, minute);
+  strcpy(entry.dosage, dosage);
+  entry.pills = parseDosagePills(dosage);
+}
+
+static void removeEntry(MedicationTime *table, int &count, int index)
+{
+  memmove(&table[index], &table[index + 1], (count - index - 1) * sizeof(MedicationTime));
+  count--;
+}
+
+uint8_t scheduleApplyDelta(const ScheduleDelta &delta, MedicationTime *table, int &count, int maxCount)
+{
+  int last = -1;                     // Last entry of the tube's medication
+  int matched = 0;
+  for (int i = 0; i < count; i++)
+  {
+    if (strcmp(table[i].tube, delta.tube) == 0)
+      last = i;
+  }
+
+  switch (delta.op)
+  {
+  case SCHEDULE_OP_BASE:
+    return SCHEDULE_DELTA_OK;
+
+  case SCHEDULE_OP_ADD_TIME:
+  {
+    // A time the tube already has is a retransmitted add: just update it
+    for (int i = 0; i < count; i++)
+    {
+      if (strcmp(table[i].tube, delta.tube) == 0 && timeToMinute(table[i].time) == delta.minute)
+      {
+        setTime(table[i], delta.minute, delta.dosage);
+        return SCHEDULE_DELTA_OK;
+      }
+    }
+    if (count >= maxCount)
+      return SCHEDULE_DELTA_FULL;
+
+    int at = last >= 0 ? last + 1 : count;
+    memmove(&table[at + 1], &table[at], (count - at) * sizeof(MedicationTime));
+    count++;
+    MedicationTime &entry = table[at];
+    if (last >= 0)
+    {
+      // Existing medication: the new entry inherits it
+      strcpy(entry.tube, table[last].tube);
+      strcpy(entry.medication, table[last].medication);
+      entry.amount = table[last].amount;
+    }
+    else
+    {
+      strcpy(entry.tube, delta.tube);
+      strcpy(entry.medication, delta.name);
+      entry.amount = delta.amount;
+    }
+    setTime(entry, delta.minute, delta.dosage);
+    return last >= 0 ? SCHEDULE_DELTA_OK : SCHEDULE_DELTA_REFILL;
+  }
+
+  case SCHEDULE_OP_REMOVE_TIME:
+  case SCHEDULE_OP_REMOVE_MED:
+    for (int i = count - 1; i >= 0; i--)
+    {
+      if (strcmp(table[i].tube, delta.tube) != 0)
+        continue;
+      if (delta.op == SCHEDULE_OP_REMOVE_TIME && timeToMinute(table[i].time) != delta.minute)
+        continue;
+      removeEntry(table, count, i);
+      matched++;
+    }
+    return matched ? SCHEDULE_DELTA_OK : SCHEDULE_DELTA_NOT_FOUND;
+
+  case SCHEDULE_OP_MODIFY_TIME:
+    for (int i = 0; i < count; i++)
+    {
+      if (strcmp(table[i].tube, delta.tube) == 0 && timeToMinute(table[i].time) == delta.minute)
+      {
+        setTime(table[i], delta.newMinute, delta.dosage);
+        matched++;
+      }
+    }
+    return matched ? SCHEDULE_DELTA_OK : SCHEDULE_DELTA_NOT_FOUND;
+
+  case SCHEDULE_OP_MODIFY_MED:
+  {
+    bool changed = false;
+    for (int i = 0; i < count; i++)
+    {
+      if (strcmp(table[i].tube, delta.tube) != 0)
+        continue;
+      changed |= strcmp(table[i].medication, delta.name) != 0 || table[i].amount != delta.amount;
+      strcpy(table[i].medication, delta.name);
+      table[i].amount = delta.amount;
+      matched++;
+    }
+    if (!matched)
+      return SCHEDULE_DELTA_NOT_FOUND;
+    return changed ? SCHEDULE_DELTA_REFILL : SCHEDULE_DELTA_OK;
+  }
+  }
+  return SCHEDULE_DELTA_MALFORMED;
+}
@@ -0,0 +1,60 @@
+#include "UiLayout.h"
+#include <avr/pgmspace.h>
+
+void drawLayout(Adafruit_SPITFT &gfx, const UiElement *layout, int16_t originX, int16_t originY)
+{
+  UiElement e;
+
+  for (;; layout++)
+  {
+    memcpy_P(&e, layout, sizeof(e));
+    int16_t x = originX + e.x;
+    int16_t y = originY + e.y;
+
+    switch (e.op)
+    {
+    case UI_TEXT:
+      gfx.setTextSize(e.size);
+      gfx.setTextColor(e.color);
+      gfx.setCursor(x, y);
+      gfx.print((const __FlashStringHelper *)e.ref);
+      break;
+    case UI_FILL_RECT:
+      gfx.fillRect(x, y, e.w, e.h, e.color);
+      break;
+    case UI_DRAW_RECT:
+      gfx.drawRect(x, y, e.w, e.h, e.color);
+      break;
+    case UI_FILL_ROUND:
+      gfx.fillRoundRect(x, y, e.w, e.h, e.size, e.color);
+      break;
+    case UI_DRAW_ROUND:
+      gfx.drawRoundRect(x, y, e.w, e.h, e.size, e.color);
+      break;
+    case UI_IMAGE:
+      drawRleImage(gfx, x, y, (const RleImage *)e.ref);
+      break;
+    default:
+      return;
+    }
+  }
+}
+
+UiRect readRect(const UiRect *rect)
+{
+  UiRect r;
+  memcpy_P(&r, rect, sizeof(r));
+  return r;
+}
+
+UiAnchor useAnchor(Adafruit_SPITFT &gfx, const UiAnchor *anchor, int16_t originX, int16_t originY)
+{
+  UiAnchor a;
+  memcpy_P(&a, anchor, sizeof(a));
+  a.x += originX;
+  a.y += originY;
+  gfx.setTextSize(a.size);
+  gfx.setTextColor(a.color);
+  gfx.setCursor(a.x, a.y);
+  return a;
+}
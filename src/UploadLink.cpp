@@ -0,0 +1,153 @@
+#include "UploadLink.h"
+
+enum LinkParseState : uint8_t
+{
+  LINK_WAIT_SOF,
+  LINK_TYPE,
+  LINK_SEQ_LO,
+  LINK_SEQ_HI,
+  LINK_LEN,
+  LINK_PAYLOAD,
+  LINK_CRC_LO,
+  LINK_CRC_HI
+};
+
+static LinkParseState parseState = LINK_WAIT_SOF;
+static uint8_t payloadPos = 0;
+static uint16_t frameCrc = 0;
+
+static uint16_t crcUpdate(uint16_t crc, uint8_t b)
+{
+  crc ^= (uint16_t)b << 8;
+  for (uint8_t i = 0; i < 8; i++)
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  return crc;
+}
+
+uint16_t linkCrc16(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+  while (len--)
+    crc = crcUpdate(crc, *data++);
+  return crc;
+}
+
+void linkReset()
+{
+  parseState = LINK_WAIT_SOF;
+}
+
+bool linkFeed(uint8_t c, LinkFrame &frame)
+{
+  switch (parseState)
+  {
+  case LINK_WAIT_SOF:
+    if (c == LINK_SOF)
+    {
+      frameCrc = 0xFFFF;
+      parseState = LINK_TYPE;
+    }
+    return false;
+
+  case LINK_TYPE:
+    frame.type = c;
+    frameCrc = crcUpdate(frameCrc, c);
+    parseState = LINK_SEQ_LO;
+    return false;
+
+  case LINK_SEQ_LO:
+    frame.seq = c;
+    frameCrc = crcUpdate(frameCrc, c);
+    parseState = LINK_SEQ_HI;
+    return false;
+
+  case LINK_SEQ_HI:
+    frame.seq |= (uint16_t)c << 8;
+    frameCrc = crcUpdate(frameCrc, c);
+    parseState = LINK_LEN;
+    return false;
+
+  case LINK_LEN:
+    if (c > LINK_MAX_PAYLOAD)
+    {
+      // Can't be a real frame; the SOF was a stray byte
+      parseState = LINK_WAIT_SOF;
+      return false;
+    }
+    frame.len = c;
+    frameCrc = crcUpdate(frameCrc, c);
+    payloadPos = 0;
+    parseState = c ? LINK_PAYLOAD : LINK_CRC_LO;
+    return false;
+
+  case LINK_PAYLOAD:
+    frame.payload[payloadPos++] = c;
+    frameCrc = crcUpdate(frameCrc, c);
+    if (payloadPos >= frame.len)
+      parseState = LINK_CRC_LO;
+    return false;
+
+  case LINK_CRC_LO:
+    frameCrc ^= c;
+    parseState = LINK_CRC_HI;
+    return false;
+
+  case LINK_CRC_HI:
+    frameCrc ^= (uint16_t)c << 8;
+    parseState = LINK_WAIT_SOF;
+    return frameCrc == 0;
+  }
+  return false;
+}
+
+void linkMapClear(LinkResumeMap &map, uint32_t fileSize, uint16_t fileCrc, uint8_t chunkSize)
+{
+  memset(&map, 0, sizeof(map));
+  map.fileSize = fileSize;
+  map.fileCrc = fileCrc;
+  map.chunkSize = chunkSize;
+  map.version = LINK_MAP_VERSION;
+}
+
+bool linkMapMatches(const LinkResumeMap &map, uint32_t fileSize, uint16_t fileCrc, uint8_t chunkSize)
+{
+  return map.version == LINK_MAP_VERSION && map.fileSize == fileSize &&
+         map.fileCrc == fileCrc && map.chunkSize == chunkSize;
+}
+
+uint16_t linkMapChunkCount(const LinkResumeMap &map)
+{
+  if (map.chunkSize == 0)
+    return 0;
+  return (map.fileSize + map.chunkSize - 1) / map.chunkSize;
+}
+
+bool linkMapHas(const LinkResumeMap &map, uint16_t chunk)
+{
+  return map.chunks[chunk >> 3] & (1 << (chunk & 7));
+}
+
+void linkMapMark(LinkResumeMap &map, uint16_t chunk)
+{
+  map.chunks[chunk >> 3] |= 1 << (chunk & 7);
+}
+
+uint16_t linkMapFirstMissing(const LinkResumeMap &map, uint16_t from)
+{
+  uint16_t count = linkMapChunkCount(map);
+  while (from < count && linkMapHas(map, from))
+    from++;
+  return from;
+}
+
+void linkSend(Stream &port, uint8_t type, uint16_t seq, const uint8_t *payload, uint8_t len)
+{
+  uint8_t header[5] = {LINK_SOF, type, (uint8_t)(seq & 0xFF), (uint8_t)(seq >> 8), len};
+  uint16_t crc = linkCrc16(0xFFFF, header + 1, 4);
+  crc = linkCrc16(crc, payload, len);
+  uint8_t trailer[2] = {(uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8)};
+
+  port.write(header, sizeof(header));
+  if (len)
+    port.write(payload, len);
+  port.write(trailer, sizeof(trailer));
+}
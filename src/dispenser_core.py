@@ -0,0 +1,258 @@
+"""Schedule handling and transport shared by the GUI and the batch CLI.
+
+Nothing in here touches a UI: the GUI (test.py) and tools/dispenser_cli.py
+both load and validate medication lists, encode them with
+schedule_format and hand them to upload(), which picks the transport
+from the address:
+
+    SIM:<anything>     a dispenser_sim.SimulatedDispenser, one per address
+    SERIAL:<path>      a tty (USB serial adapter, or a pty from
+                       tools/link_loopback.py or tools/firmware_emu)
+    anything else      a BLE address, through bleak
+
+upload() is a coroutine, so any number of them can run on one event
+loop. Progress and retry notices arrive through callbacks.
+"""
+
+import asyncio
+import copy
+import json
+import time
+
+import dispenser_link
+import dispenser_sim
+import schedule_format
+
+try:
+    from bleak import BleakScanner, BleakClient
+    BLEAK_AVAILABLE = True
+except ImportError:
+    BLEAK_AVAILABLE = False
+
+SERVICE_UUID = "12345678-1234-1234-1234-123456789abc"
+CHARACTERISTIC_UUID = "87654321-4321-4321-4321-cba987654321"
+
+BLE_CHUNK_SIZE = 20     # BLE write size until the MTU is known; frames are split across writes
+CONNECT_TIMEOUT = 10.0
+SCAN_TIMEOUT = 10.0
+RECONNECT_ATTEMPTS = 3  # A dropped link resumes from the device's chunk bitmap
+RECONNECT_DELAY = 1.0
+
+REQUIRED_FIELDS = ("tube", "type", "amount", "time_to_take")
+
+
+def validate_medications(data):
+    """Raises ValueError unless data is a medication list in the app's JSON shape."""
+    if not isinstance(data, list):
+        raise ValueError("JSON must contain a list of medications")
+
+    for med in data:
+        for field in REQUIRED_FIELDS:
+            if field not in med:
+                raise ValueError(f"Missing required field: {field}")
+
+        if not isinstance(med['time_to_take'], list):
+            raise ValueError("time_to_take must be a list")
+
+        for schedule in med['time_to_take']:
+            if 'time' not in schedule or 'dosage' not in schedule:
+                raise ValueError("Each schedule must have 'time' and 'dosage'")
+    return data
+
+
+def load_medications(path):
+    with open(path, 'r', encoding='utf-8') as f:
+        return validate_medications(json.load(f))
+
+
+def summarize(medications):
+    """(medications, tubes, schedules) counts, as shown in the GUI."""
+    return (len(medications),
+            len(set(med['tube'] for med in medications)),
+            sum(len(med['time_to_take']) for med in medications))
+
+
+def is_simulated(address):
+    return address.startswith("SIM:") or address == "00:00:00:00:00"
+
+
+# Simulated dispensers by address; they keep their schedule and any
+# partial upload for as long as the process runs. Put a configured one
+# here before uploading to it to change its link.
+simulated = {}
+
+
+def simulated_device(address):
+    device = simulated.get(address)
+    if device is None:
+        device = simulated[address] = dispenser_sim.SimulatedDispenser()
+    return device
+
+
+class UploadResult:
+    """What one upload() did. fingerprint is the device's schedule
+    fingerprint after it, None for text uploads."""
+
+    def __init__(self, address, size):
+        self.address = address
+        self.size = size
+        self.edits = False           # Sent as edits rather than the whole file
+        self.fingerprint = None
+        self.resumed_bytes = 0
+        self.attempts = 0
+        self.elapsed = 0.0
+        self.stats = {}
+
+    def as_dict(self):
+        return {
+            "address": self.address,
+            "bytes": self.size,
+            "edits": self.edits,
+            "fingerprint": self.fingerprint,
+            "resumed_bytes": self.resumed_bytes,
+            "attempts": self.attempts,
+            "elapsed_s": round(self.elapsed, 3),
+            "link": self.stats,
+        }
+
+
+async def _send_edits(uploader, address, medications, schedules, progress):
+    """Sends the schedule as edits if possible; False means do a full upload."""
+    known = schedules.get(address) if schedules is not None else None
+    if medications is None or known is None or known[1] is None:
+        return False
+    ops = schedule_format.diff(known[0], medications)
+    if ops is None:
+        return False
+
+    try:
+        await uploader.send_edits([schedule_format.op_base(known[1])] + ops, progress=progress)
+        return True
+    except dispenser_link.LinkError as e:
+        if e.status in (dispenser_link.STATUS_STALE, dispenser_link.STATUS_REJECTED):
+            schedules.pop(address, None)
+            return False
+        raise
+
+
+async def upload(address, data, medications=None, schedules=None,
+                 progress=None, edit_progress=None, on_retry=None):
+    """Sends data (an encoded schedule, or text) to the dispenser at address.
+
+    medications is the list data was encoded from. With it and a
+    schedules dict (address -> (medications, fingerprint) the device last
+    confirmed), only the edits since then go out when the device still
+    holds that schedule; schedules is updated on success.
+
+    progress(sent, total) follows the file, edit_progress(done, total)
+    the edits, and on_retry(attempt, attempts, error) is called before
+    reconnecting to a BLE or simulated device. Raises dispenser_link.LinkError when the device
+    rejects the upload, Exception when the link fails.
+    """
+    data = data if isinstance(data, bytes) else data.encode('utf-8')
+    result = UploadResult(address, len(data))
+    started = time.monotonic()
+
+    async def run_upload(uploader):
+        result.attempts += 1
+        result.edits = await _send_edits(uploader, address, medications, schedules, edit_progress)
+        if not result.edits:
+            await uploader.send(data, progress=progress)
+        if medications is not None and schedules is not None:
+            schedules[address] = (copy.deepcopy(medications), uploader.fingerprint)
+        result.fingerprint = uploader.fingerprint
+        result.resumed_bytes = uploader.resumed_bytes
+        result.stats = uploader.stats()
+        result.elapsed = time.monotonic() - started
+        return result
+
+    if address.startswith("SERIAL:"):
+        link = dispenser_link.SerialLink(address[len("SERIAL:"):])
+        try:
+            uploader = dispenser_link.Uploader(link.write, write_size=dispenser_link.SERIAL_WRITE_SIZE)
+            link.attach(uploader)
+            return await run_upload(uploader)
+        finally:
+            link.close()
+
+    if is_simulated(address):
+        session = _simulated_session
+    elif BLEAK_AVAILABLE:
+        session = _ble_session
+    else:
+        raise Exception("BLE library not available. Please install bleak: pip install bleak")
+
+    last_error = None
+    for attempt in range(1, RECONNECT_ATTEMPTS + 1):
+        try:
+            return await session(address, run_upload)
+        except dispenser_link.LinkError as e:
+            if e.status is not None:
+                raise
+            last_error = e
+        except Exception as e:
+            last_error = e
+
+        if attempt < RECONNECT_ATTEMPTS:
+            if on_retry:
+                on_retry(attempt, RECONNECT_ATTEMPTS, last_error)
+            await asyncio.sleep(RECONNECT_DELAY)
+
+    raise Exception(f"BLE transmission failed: {str(last_error)}")
+
+
+async def _simulated_session(address, run_upload):
+    device = simulated_device(address)
+    uploader = None
+    link = device.connect(lambda data: uploader.on_receive(data))
+    try:
+        uploader = dispenser_link.Uploader(link.write, write_size=BLE_CHUNK_SIZE)
+        return await run_upload(uploader)
+    finally:
+        link.close()
+
+
+async def _ble_session(address, run_upload):
+    async with BleakClient(address, timeout=CONNECT_TIMEOUT) as client:
+        if not client.is_connected:
+            raise Exception("Failed to connect to BLE device")
+
+        # Writes fill the negotiated ATT MTU (3 bytes are ATT header) and
+        # skip the per-write round trip when the module allows it;
+        # the uploader's window then paces them from its ACKs
+        write_size = BLE_CHUNK_SIZE
+        mtu = getattr(client, "mtu_size", None)
+        if mtu:
+            write_size = max(BLE_CHUNK_SIZE, min(mtu - 3, 244))
+        characteristic = client.services.get_characteristic(CHARACTERISTIC_UUID)
+        with_response = characteristic is not None and \
+            "write-without-response" not in characteristic.properties
+
+        async def write(chunk):
+            await client.write_gatt_char(CHARACTERISTIC_UUID, chunk, response=with_response)
+
+        uploader = dispenser_link.Uploader(write, write_size=write_size)
+        await client.start_notify(CHARACTERISTIC_UUID, lambda _, data: uploader.on_receive(data))
+        try:
+            return await run_upload(uploader)
+        finally:
+            if client.is_connected:
+                await client.stop_notify(CHARACTERISTIC_UUID)
+
+
+async def scan(timeout=SCAN_TIMEOUT):
+    """Discovers BLE devices; returns {display name: address}, which may be empty.
+    Raises asyncio.TimeoutError when the scan does not finish in time."""
+    if not BLEAK_AVAILABLE:
+        raise Exception("BLE library not available. Please install bleak: pip install bleak")
+
+    discovered_devices = await asyncio.wait_for(BleakScanner().discover(), timeout=timeout)
+
+    devices = {}
+    for device in discovered_devices:
+        device_name = device.name if device.name else "Unknown Device"
+        if device.address:
+            # Add RSSI info if available
+            rssi_info = f" (RSSI: {device.rssi})" if hasattr(device, 'rssi') and device.rssi else ""
+            devices[f"{device_name}{rssi_info}"] = device.address
+    return devices
@@ -0,0 +1,399 @@
+"""Framed upload protocol spoken with the dispenser over the BLE UART.
+
+Mirrors include/UploadLink.h. Every frame is
+
+    SOF(0xA5) type seq(LE16) len payload[len] crc(LE16)
+
+with CRC-16/CCITT-FALSE over type..payload. The file goes out as DATA
+frames of up to MAX_PAYLOAD bytes with at most WINDOW of them
+unacknowledged; the device answers each chunk with the first chunk it is
+still missing and a gap with a NAK, and the sender goes back to the first
+unacknowledged chunk on a NAK or a timeout (go-back-N). Nothing here
+sleeps between chunks, so throughput is whatever the link delivers.
+
+Uploads survive a dropped link. The device keeps the partial file and a
+chunk bitmap on its SD card and answers BEGIN for the same file (size,
+CRC and chunk size) with that bitmap, so sending the same data again
+only transmits the chunks that never arrived.
+
+The sender adapts to the link instead of assuming one: the window grows
+by one frame per window delivered and halves on a loss (AIMD), but never
+past the bandwidth-delay product (delivery rate times the lowest ACK
+round trip, plus one frame of slack), since every frame beyond it only
+waits in the module buffer in front of the 64-byte Serial1 ring and
+stretches the round trip. The retransmit timeout follows the measured ACK
+round trip (SRTT + 4 RTTVAR, as in TCP). The BLE write size comes from
+the negotiated MTU.
+
+Small changes can skip the file altogether: send_edits() streams a batch
+of schedule edits (schedule_format.diff()) as DELTA frames, one at a
+time, starting with OP_BASE so the device refuses edits made against a
+schedule it no longer holds. Every DONE carries the fingerprint of the
+device's schedule; keep it to quote in the next batch.
+"""
+
+import asyncio
+import binascii
+import math
+import os
+import struct
+import time
+
+SOF = 0xA5
+MAX_PAYLOAD = 64
+WINDOW = 2             # Initial window, in frames; a burst of 8 overflows the module buffer
+MAX_WINDOW = 16        # The device has no window limit; window_cap() is the real one
+MAX_CHUNKS = 256        # LINK_MAX_CHUNKS: the bitmap the device keeps
+
+BEGIN = 0x01
+DATA = 0x02
+END = 0x03
+ABORT = 0x04
+DELTA = 0x05
+ACK = 0x81
+NAK = 0x82
+DONE = 0x83
+
+STATUS_TEXT = {
+    0: "ok",
+    1: "file size or CRC mismatch",
+    2: "SD card error",
+    3: "schedule rejected by the dispenser",
+    4: "dispenser holds a different schedule",
+    5: "edit could not be applied",
+}
+
+STATUS_STALE = 4
+STATUS_REJECTED = 5
+
+SERIAL_WRITE_SIZE = 64  # No MTU on a wire; keeps each write well inside the tty buffer
+
+ACK_TIMEOUT = 1.0       # Seconds without an ACK before the window is resent, until RTT is measured
+MIN_ACK_TIMEOUT = 0.15
+MAX_ACK_TIMEOUT = 3.0
+MAX_RETRIES = 8         # Consecutive timeouts before giving up
+DONE_TIMEOUT = 15.0     # The device loads and validates the schedule before DONE
+
+
+class LinkError(Exception):
+    """status is the device's DONE status, or None when the link itself failed."""
+
+    def __init__(self, message, status=None):
+        super().__init__(message)
+        self.status = status
+
+
+def status_error(body):
+    status = body[0] if body else -1
+    return LinkError(STATUS_TEXT.get(status, f"status {status}"), status)
+
+
+def crc16(data, crc=0xFFFF):
+    return binascii.crc_hqx(bytes(data), crc)
+
+
+def build_frame(frame_type, seq, payload=b""):
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError("payload too long")
+    body = struct.pack("<BHB", frame_type, seq & 0xFFFF, len(payload)) + bytes(payload)
+    return bytes([SOF]) + body + struct.pack("<H", crc16(body))
+
+
+class FrameParser:
+    """Turns a byte stream into (type, seq, payload) tuples, dropping bad frames."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.crc_errors = 0
+
+    def feed(self, data):
+        self.buffer.extend(data)
+        frames = []
+        while True:
+            start = self.buffer.find(SOF)
+            if start < 0:
+                self.buffer.clear()
+                break
+            del self.buffer[:start]
+            if len(self.buffer) < 5:
+                break
+            length = self.buffer[4]
+            if length > MAX_PAYLOAD:
+                del self.buffer[0]
+                continue
+            total = 5 + length + 2
+            if len(self.buffer) < total:
+                break
+            body = bytes(self.buffer[1:5 + length])
+            (crc,) = struct.unpack_from("<H", self.buffer, 5 + length)
+            if crc != crc16(body):
+                self.crc_errors += 1
+                del self.buffer[0]
+                continue
+            frame_type, seq, _ = struct.unpack_from("<BHB", body)
+            frames.append((frame_type, seq, body[4:]))
+            del self.buffer[:total]
+        return frames
+
+
+class Uploader:
+    """Sends one file over a byte link.
+
+    write: async callable taking bytes, delivering them to the device.
+    Received bytes from the device must be passed to on_receive().
+    """
+
+    def __init__(self, write, write_size=20, window=WINDOW, payload_size=MAX_PAYLOAD, max_window=MAX_WINDOW,
+                 bdp_cap=True):
+        self.write = write
+        self.write_size = write_size
+        self.window = float(window)
+        self.max_window = max_window
+        self.bdp_cap = bdp_cap       # False keeps the window at max_window (benchmarks)
+        self.payload_size = payload_size
+        self.srtt = None             # Smoothed ACK round trip, seconds
+        self.rttvar = None
+        self.min_rtt = None          # Lowest ACK round trip: the link without a queue
+        self.delivery_rate = 0.0     # Highest measured delivery rate, frames per second
+        self.delivered = 0           # Frames acknowledged so far
+        self.bytes_sent = 0
+        self.elapsed = 0.0
+        self.parser = FrameParser()
+        self.replies = asyncio.Queue()
+        self.frames_sent = 0
+        self.retransmits = 0
+        self.resumed_bytes = 0       # Bytes the device already had from an earlier attempt
+        self.fingerprint = None      # Device schedule fingerprint from the last DONE
+
+    def on_receive(self, data):
+        for frame in self.parser.feed(data):
+            self.replies.put_nowait(frame)
+
+    async def _send(self, frame):
+        for i in range(0, len(frame), self.write_size):
+            await self.write(frame[i:i + self.write_size])
+        self.frames_sent += 1
+        self.bytes_sent += len(frame)
+
+    def ack_timeout(self):
+        if self.srtt is None:
+            return ACK_TIMEOUT
+        return min(max(self.srtt + 4 * self.rttvar, MIN_ACK_TIMEOUT), MAX_ACK_TIMEOUT)
+
+    def _rtt_sample(self, rtt):
+        if self.srtt is None:
+            self.srtt = rtt
+            self.rttvar = rtt / 2
+        else:
+            self.rttvar = 0.75 * self.rttvar + 0.25 * abs(self.srtt - rtt)
+            self.srtt = 0.875 * self.srtt + 0.125 * rtt
+        self.min_rtt = rtt if self.min_rtt is None else min(self.min_rtt, rtt)
+
+    def window_cap(self):
+        """Frames in flight that keep the link busy without queueing."""
+        if not self.bdp_cap or self.min_rtt is None or not self.delivery_rate:
+            return self.max_window
+        bdp = self.delivery_rate * self.min_rtt
+        return min(max(math.ceil(bdp) + 1, 2), self.max_window)
+
+    def _on_loss(self):
+        self.window = max(self.window / 2, 1.0)
+
+    def stats(self):
+        """Summary of the last transfer, for logs and benchmarks."""
+        return {
+            "elapsed_s": round(self.elapsed, 3),
+            "wire_bytes": self.bytes_sent,
+            "frames": self.frames_sent,
+            "retransmits": self.retransmits,
+            "srtt_ms": round(self.srtt * 1000, 1) if self.srtt is not None else None,
+            "window": round(self.window, 1),
+            "write_size": self.write_size,
+        }
+
+    async def _reply(self, timeout):
+        try:
+            return await asyncio.wait_for(self.replies.get(), timeout)
+        except asyncio.TimeoutError:
+            return None
+
+    async def _begin(self, data):
+        """Returns the set of chunk indices the device already holds."""
+        payload = struct.pack("<IHB", len(data), crc16(data), self.payload_size)
+        for _ in range(MAX_RETRIES):
+            await self._send(build_frame(BEGIN, 0, payload))
+            reply = await self._reply(ACK_TIMEOUT)
+            if reply is None:
+                continue
+            frame_type, seq, body = reply
+            if frame_type == DONE:
+                raise status_error(body)
+            if frame_type == ACK and len(body) >= 4:
+                bitmap = body[4:]
+                return {i for i in range(len(bitmap) * 8) if bitmap[i >> 3] & (1 << (i & 7))}
+        raise LinkError("no answer from the dispenser")
+
+    async def _send_chunks(self, chunks, pending, total, progress):
+        base = 0
+        next_index = 0
+        timeouts = 0
+        sent_at = {}                 # Chunk -> (first send time, frames delivered then); retransmits give no sample (Karn)
+        while base < len(pending):
+            while next_index < len(pending) and next_index < base + int(self.window):
+                seq = pending[next_index]
+                if seq in sent_at:
+                    sent_at[seq] = None
+                else:
+                    sent_at[seq] = (time.monotonic(), self.delivered)
+                await self._send(build_frame(DATA, seq, chunks[seq]))
+                next_index += 1
+
+            reply = await self._reply(self.ack_timeout())
+            if reply is None:
+                timeouts += 1
+                if timeouts >= MAX_RETRIES:
+                    raise LinkError(f"link stalled at chunk {pending[base]}/{len(chunks)}")
+                self._on_loss()
+                if self.srtt is not None:
+                    self.srtt = min(self.srtt * 2, MAX_ACK_TIMEOUT)   # Back off
+                self.retransmits += next_index - base
+                next_index = base
+                continue
+
+            frame_type, seq, body = reply
+            if frame_type == DONE:
+                raise status_error(body)
+            if frame_type not in (ACK, NAK):
+                continue
+            # seq is the first chunk the device is missing
+            advanced = 0
+            while base < len(pending) and pending[base] < seq:
+                started = sent_at.get(pending[base])
+                base += 1
+                advanced += 1
+            if advanced:
+                self.delivered += advanced
+                if started is not None:
+                    elapsed = time.monotonic() - started[0]
+                    self._rtt_sample(elapsed)
+                    self.delivery_rate = max(self.delivery_rate, (self.delivered - started[1]) / elapsed)
+                timeouts = 0
+                self.window = min(self.window + advanced / self.window, self.window_cap())
+                if progress:
+                    progress(min(seq * self.payload_size, total), total)
+            if frame_type == NAK:
+                self._on_loss()
+                self.retransmits += max(next_index - base, 0)
+                next_index = base
+            next_index = max(next_index, base)
+
+    async def send(self, data, progress=None):
+        data = bytes(data)
+        chunks = [data[i:i + self.payload_size] for i in range(0, len(data), self.payload_size)]
+        if len(chunks) > MAX_CHUNKS:
+            raise LinkError(f"file too large ({len(data)} bytes, at most {MAX_CHUNKS * self.payload_size})")
+
+        started = time.monotonic()
+        have = await self._begin(data)
+        pending = [i for i in range(len(chunks)) if i not in have]
+        self.resumed_bytes = len(data) - sum(len(chunks[i]) for i in pending)
+
+        while True:
+            await self._send_chunks(chunks, pending, len(data), progress)
+
+            missing = await self._finish(len(chunks))
+            self.elapsed = time.monotonic() - started
+            if missing is None:
+                return
+            # The tail went missing; the device skips chunks it already has
+            pending = list(range(missing, len(chunks)))
+
+    async def _finish(self, seq):
+        """Sends END; None once DONE reports success, else the chunk the device NAKed."""
+        await self._send(build_frame(END, seq))
+        deadline = asyncio.get_running_loop().time() + DONE_TIMEOUT
+        while True:
+            remaining = deadline - asyncio.get_running_loop().time()
+            reply = await self._reply(max(remaining, 0))
+            if reply is None:
+                raise LinkError("dispenser did not confirm the upload")
+            frame_type, reply_seq, body = reply
+            if frame_type == DONE:
+                if len(body) >= 3:
+                    (self.fingerprint,) = struct.unpack_from("<H", body, 1)
+                if body and body[0] == 0:
+                    return None
+                raise status_error(body)
+            if frame_type == NAK and reply_seq < seq:
+                return reply_seq
+
+    async def send_edits(self, ops, progress=None):
+        """Applies a batch of edit operations; ops[0] must be an OP_BASE."""
+        for seq, op in enumerate(ops):
+            for _ in range(MAX_RETRIES):
+                await self._send(build_frame(DELTA, seq, op))
+                reply = await self._reply(ACK_TIMEOUT)
+                if reply is None:
+                    self.retransmits += 1
+                    continue
+                frame_type, reply_seq, body = reply
+                if frame_type == DONE:
+                    if len(body) >= 3:
+                        (self.fingerprint,) = struct.unpack_from("<H", body, 1)
+                    raise status_error(body)
+                if frame_type == ACK and reply_seq == seq + 1:
+                    break
+                if frame_type == NAK:
+                    raise LinkError(f"dispenser expected edit {reply_seq}, not {seq}")
+            else:
+                raise LinkError(f"no answer to edit {seq}")
+            if progress:
+                progress(seq + 1, len(ops))
+
+        if await self._finish(len(ops)) is not None:
+            raise LinkError("dispenser did not confirm the edits")
+
+
+class SerialLink:
+    """A tty as the byte link: a USB serial adapter on the BLE module's UART,
+    or the pty of the firmware stand-in in tools/link_loopback.py.
+    POSIX only; the GUI's BLE path does not need it.
+    """
+
+    def __init__(self, path, baud=115200):
+        import termios
+        import tty
+
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        tty.setraw(self.fd)
+        attrs = termios.tcgetattr(self.fd)
+        speed = getattr(termios, f"B{baud}", None)
+        if speed is not None:
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        self.loop = None
+
+    def attach(self, uploader):
+        self.loop = asyncio.get_running_loop()
+        self.loop.add_reader(self.fd, self._readable, uploader)
+
+    def _readable(self, uploader):
+        try:
+            data = os.read(self.fd, 4096)
+        except BlockingIOError:
+            return
+        if data:
+            uploader.on_receive(data)
+
+    async def write(self, data):
+        view = memoryview(data)
+        while view:
+            try:
+                view = view[os.write(self.fd, view):]
+            except BlockingIOError:
+                await asyncio.sleep(0.001)
+
+    def close(self):
+        if self.loop is not None:
+            self.loop.remove_reader(self.fd)
+        os.close(self.fd)
@@ -0,0 +1,156 @@
+"""In-process stand-in for a dispenser, behind the SIM: addresses.
+
+Speaks the device side of the framed upload protocol (dispenser_link,
+include/UploadLink.h) so simulated uploads go through the same Uploader,
+window and retries as real ones, without a radio or a pty. Each
+SimulatedDispenser keeps its partial upload between connections, like
+the chunk bitmap on the real SD card, so a dropped link resumes.
+
+The link is modelled coarsely: writes take len/rate seconds, replies
+arrive after latency, and each write is lost with probability loss.
+drops makes the first few connections fail part way through. Schedule
+edits (DELTA) are answered "edit could not be applied", which sends the
+uploader back to a full upload. For a byte-accurate model of the UART
+path use tools/link_loopback.py; for the real firmware, tools/firmware_emu.
+"""
+
+import asyncio
+import json
+import random
+import struct
+
+import dispenser_link as link
+import schedule_format
+
+STATUS_OK = 0
+STATUS_BAD_FILE = 1
+STATUS_SCHEDULE_REJECTED = 3
+
+
+class SimulatedDispenser:
+    def __init__(self, rate=2600.0, latency=0.02, loss=0.0, load_time=0.05, drops=0, seed=None):
+        self.rate = rate                 # Bytes per second the link carries
+        self.latency = latency           # Seconds before a reply arrives
+        self.loss = loss                 # Chance a write never arrives
+        self.load_time = load_time       # Loading and regrouping before DONE
+        self.drops = drops               # Connections to cut part way through
+        self.random = random.Random(seed)
+        self.session = None
+        self.medications = []            # Schedule the device holds
+        self.fingerprint = link.crc16(schedule_format.encode([]))
+        self.uploads = 0
+
+    def connect(self, on_receive):
+        """A link to this device; replies go to on_receive(bytes)."""
+        return SimulatedLink(self, on_receive)
+
+    def _status(self, status):
+        return bytes([status]) + struct.pack("<H", self.fingerprint)
+
+    def _resume(self, s):
+        bitmap = bytearray(link.MAX_CHUNKS // 8)
+        for i, have in enumerate(s["have"]):
+            if have:
+                bitmap[i >> 3] |= 1 << (i & 7)
+        return struct.pack("<I", min(s["expected"] * s["chunk"], s["size"])) + bytes(bitmap)
+
+    def _load(self, data):
+        # Like the firmware, anything without the binary magic is taken as JSON
+        try:
+            if bytes(data[:3]) == schedule_format.MAGIC:
+                medications = schedule_format.decode(bytes(data))
+            else:
+                medications = json.loads(bytes(data).decode("utf-8"))
+                schedule_format.encode(medications)
+        except (ValueError, TypeError, KeyError, AttributeError, IndexError, struct.error):
+            return STATUS_SCHEDULE_REJECTED
+        self.medications = medications
+        self.fingerprint = link.crc16(schedule_format.encode(medications))
+        self.uploads += 1
+        return STATUS_OK
+
+    def handle(self, frame_type, seq, payload):
+        """Answers one frame with a list of (type, seq, payload, delay) replies."""
+        s = self.session
+        if frame_type == link.BEGIN:
+            if len(payload) < 6:
+                return []
+            size, crc = struct.unpack_from("<IH", payload)
+            chunk = payload[6] if len(payload) >= 7 else link.MAX_PAYLOAD
+            count = (size + chunk - 1) // chunk if chunk else 0
+            if chunk == 0 or chunk > link.MAX_PAYLOAD or count > link.MAX_CHUNKS:
+                return [(link.DONE, 0, self._status(STATUS_BAD_FILE), 0)]
+            if s is None or s["key"] != (size, crc, chunk):
+                s = self.session = {"key": (size, crc, chunk), "size": size, "crc": crc, "chunk": chunk,
+                                    "count": count, "data": bytearray(size), "have": [False] * count,
+                                    "expected": 0, "nak": False}
+            return [(link.ACK, s["expected"], self._resume(s), 0)]
+        if frame_type == link.DELTA:
+            return [(link.DONE, seq, self._status(link.STATUS_REJECTED), 0)]
+        if s is None:
+            if frame_type == link.END:
+                return [(link.DONE, seq, self._status(STATUS_BAD_FILE), 0)]
+            return []
+        if frame_type == link.DATA and seq < s["count"]:
+            if not s["have"][seq]:
+                s["data"][seq * s["chunk"]:seq * s["chunk"] + len(payload)] = payload
+                s["have"][seq] = True
+            first = s["expected"]
+            while first < s["count"] and s["have"][first]:
+                first += 1
+            if first != s["expected"]:
+                s["expected"] = first
+                s["nak"] = False
+            if seq > s["expected"] and not s["nak"]:
+                s["nak"] = True
+                return [(link.NAK, s["expected"], b"", 0)]
+            return [(link.ACK, s["expected"], b"", 0)]
+        if frame_type == link.END:
+            if s["expected"] < s["count"]:
+                return [(link.NAK, s["expected"], b"", 0)]
+            self.session = None
+            if link.crc16(s["data"]) != s["crc"]:
+                return [(link.DONE, s["count"], self._status(STATUS_BAD_FILE), 0)]
+            status = self._load(s["data"])
+            return [(link.DONE, s["count"], self._status(status), self.load_time)]
+        if frame_type == link.ABORT:
+            self.session = None
+        return []
+
+
+class SimulatedLink:
+    """One connection to a SimulatedDispenser; write() is the Uploader's write."""
+
+    def __init__(self, device, on_receive):
+        self.device = device
+        self.on_receive = on_receive
+        self.parser = link.FrameParser()
+        self.connected = True
+        self.cut_after = None
+        if device.drops > 0:
+            device.drops -= 1
+            self.cut_after = device.random.randint(1, 6)   # Writes until the link goes
+
+    async def write(self, data):
+        if not self.connected:
+            raise ConnectionError("simulated link is closed")
+        if self.cut_after is not None:
+            self.cut_after -= 1
+            if self.cut_after <= 0:
+                self.close()
+                raise ConnectionError("simulated link dropped")
+        await asyncio.sleep(len(data) / self.device.rate)
+        if self.device.random.random() < self.device.loss:
+            return
+        loop = asyncio.get_running_loop()
+        for frame in self.parser.feed(data):
+            for frame_type, seq, payload, delay in self.device.handle(*frame):
+                reply = link.build_frame(frame_type, seq, payload)
+                loop.call_later(self.device.latency + delay, self._deliver, reply)
+
+    def _deliver(self, data):
+        if self.connected:
+            self.on_receive(data)
+
+    def close(self):
+        self.connected = False
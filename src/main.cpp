@@ -7,24 +7,82 @@
 #include <RTClib.h>
 #include <ArduinoJson.h>
 #include <StreamUtils.h>
+#include "ST7789Ext.h"
+#include "UiLayout.h"
+#include "Assets.h"
+#include "Dispenser.h"
+#include "DispenseLog.h"
+#include "Inventory.h"
+#include "DoseState.h"
+#include "UploadLink.h"
+#include "ScheduleFormat.h"
+#include "StageTrace.h"
 
 #define SD_CS 11
 #define TFT_CS 10
 #define TFT_RST 9
 #define TFT_DC 8
+#if MOTOR_PWM
+#define MOTOR_1 5                 // Timer 3 OC3A
+#define MOTOR_2 2                 // Timer 3 OC3B
+#define MOTOR_3 3                 // Timer 3 OC3C
+#define MOTOR_4 12                // Timer 1 OC1B
+#else
 #define MOTOR_1 22
 #define MOTOR_2 24
 #define MOTOR_3 26
 #define MOTOR_4 28
+#endif
 #define DROP_BTN 30
 #define Sensor_PIN 32
+#if defined(SERVO_HW_PWM)
+#define SERVO_1 46                // Timer 5 OC5A
+#define SERVO_2 45                // Timer 5 OC5B
+#define SERVO_3 44                // Timer 5 OC5C
+#define SERVO_4 6                 // Timer 4 OC4A
+#else
+#define SERVO_1 A0
+#define SERVO_2 A1
+#define SERVO_3 A2
+#define SERVO_4 A3
+#endif
 
 #define MAX_SCHEDULES 12
 #define MAX_GROUPED 12
 #define MAX_MEDS_PER_TIME 3
 #define TEMP_BUFFER_SIZE 64
 
-Adafruit_ST7789 tft = Adafruit_ST7789(TFT_CS, TFT_DC, TFT_RST);
+#define HEADER_HEIGHT 35          // Blue clock strip, also what night mode keeps lit
+#define CARD_RADIUS 8
+#define CARD_LINE_STEP 13         // Text lines inside a schedule card
+#define SETUP_LIST_STEP 12        // Medication rows on the tube setup screen
+#define NOTIFICATION_LINE_STEP 12
+#define CARDS_PER_PAGE 2          // 75 px cards below the title; the panel is 240 px tall in rotation 1
+#define DROP_DEBOUNCE_MS 50       // DROP must read LOW this long to count as a press
+#define DROP_LONG_PRESS_MS 800    // Hold DROP this long on the schedule view to flip pages
+#define MENU_PAGE_TIMEOUT 30000   // Return to the first page after 30 s without paging
+
+#define BATTERY_SENSE_PIN -1      // Analog pin on the battery divider, -1 when mains powered
+#define BATTERY_DIVIDER 2         // Battery voltage = pin voltage * BATTERY_DIVIDER
+#define BATTERY_MV_EMPTY 3300
+#define BATTERY_MV_FULL 4200
+
+#define NIGHT_START_HOUR 22       // Panel drops to partial + idle mode from this hour...
+#define NIGHT_END_HOUR 6          // ...until this hour, unless an alert or setup needs the screen
+#define NIGHT_STRIP_WIDTH 80      // Screen columns kept lit at night (clock and date)
+
+#define RENDER_MAX_FPS 10         // Upper bound on TFT frames per second
+#define NOTIFICATION_TIMEOUT 300000
+#define SCHEDULE_EDIT_IDLE_MS 3000  // Edits are dropped this long after the last one if no END comes
+#define COUNTDOWN_REFRESH 10000   // Countdown line is redrawn every 10 s
+
+// Invalidation events queued by loop() and coalesced into one frame
+#define RENDER_FULL 0x01          // Screen layout changed: clear and redraw everything
+#define RENDER_HEADER 0x02        // Clock, date or status changed
+#define RENDER_CARDS 0x04         // Schedule page or next-dose highlight changed
+#define RENDER_COUNTDOWN 0x08     // Notification countdown ticked
+
+ST7789Ext tft = ST7789Ext(TFT_CS, TFT_DC, TFT_RST);
 RTC_DS3231 rtc;
 SdFat SD;
 File file;
@@ -37,51 +95,84 @@ unsigned long lastByteTime = 0;
 File streamingFile;
 bool streamingActive = false;
 
+bool linkSession = false;              // A framed upload owns Serial1 (see UploadLink.h)
+LinkResumeMap linkMap;                 // Chunks of data.tmp already on the card
+uint16_t linkExpected = 0;             // First chunk still missing
+bool linkNakSent = false;              // One NAK per gap, cleared when the gap fills
+uint8_t linkSinceSave = 0;             // Chunks written since linkMap was last saved
+
+bool scheduleEdited = false;           // Delta edits applied to schedules[] but not regrouped or saved
+unsigned long lastEditAt = 0;
+uint16_t lastDeltaSeq = 0xFFFF;        // Last edit applied in this batch, 0xFFFF before the first
+uint8_t refillMask = 0;                // Tubes whose medication or amount an edit changed
+
 char notificationMessage[200] = "";
 unsigned long notificationStartTime = 0;
+bool notificationDismissed = false;      // Auto-dismissed, dose still waiting for DROP
+unsigned long notificationDismissedAt = 0;
 volatile bool sdBusy = false;
 DateTime rtctime;
 
 int currentMenuPage = 0;
 unsigned long lastMenuUpdate = 0;
 bool showNotification = false;
-bool motorStates[4] = {false, false, false, false};
 
-bool tftNeedsUpdate = true;            // Flag to trigger TFT update
+bool dropHeld = false;                 // DROP is down
+bool dropHandled = false;              // This press already acted
+unsigned long dropPressedAt = 0;
+
+uint8_t renderQueue = RENDER_FULL;     // Pending RENDER_* events for the next frame
+unsigned long lastFrameTime = 0;       // When the last frame was pushed to the TFT
 uint8_t lastDisplayedMinute = 255;     // Track last displayed minute (255 = uninitialized)
 bool lastNotificationState = false;    // Track notification state changes
 bool lastFilestat = false;             // Track filestat changes
 int lastGroupedCount = 0;              // Track schedule changes
 unsigned long lastCountdownUpdate = 0; // Track countdown display updates
-int lastCountdownValue = -1;           // Track last displayed countdown
 
-void requestTFTUpdate()
+uint8_t scheduleOrder[MAX_GROUPED];     // Grouped schedule indices ordered from the next dose onwards
+int nextScheduleIndex = -1;             // Group highlighted as NEXT, -1 if none
+int notifyGroup = -1;                   // Group the notification (and DROP) is for
+int8_t cardSlotGroup[CARDS_PER_PAGE];   // Group drawn in each card slot (-1 = empty, -2 = unknown)
+bool cardSlotNext[CARDS_PER_PAGE];      // Whether the slot was drawn with the NEXT highlight
+
+bool nightModeActive = false;           // Panel is in partial + idle mode
+
+void invalidateDisplay(uint8_t events)
 {
-  tftNeedsUpdate = true;
+  renderQueue |= events;
 }
 
-struct TubeMapping
+void requestTFTUpdate()
 {
-  char tubeName[8];
-  int servoIndex;
-  int motorPin;
-  Servo *servo;
-};
+  invalidateDisplay(RENDER_FULL);
+}
 
 TubeMapping tubeMappings[4] = {
-    {"tube1", 0, MOTOR_1, &servo1},
-    {"tube2", 1, MOTOR_2, &servo2},
-    {"tube3", 2, MOTOR_3, &servo3},
-    {"tube4", 3, MOTOR_4, &servo4}};
+    {"tube1", 0, MOTOR_1, &servo1, MOTOR_PROFILE_DEFAULT},
+    {"tube2", 1, MOTOR_2, &servo2, MOTOR_PROFILE_DEFAULT},
+    {"tube3", 2, MOTOR_3, &servo3, MOTOR_PROFILE_DEFAULT},
+    {"tube4", 3, MOTOR_4, &servo4, MOTOR_PROFILE_DEFAULT}};
 
-struct MedicationTime
+int timeToMinutes(const char *timeStr)
 {
-  char time[6];
-  char dosage[16];
-  char medication[24];
-  char tube[8];
-  int amount;
-};
+  int hours, minutes;
+  if (sscanf_P(timeStr, PSTR("%d:%d"), &hours, &minutes) != 2)
+  {
+    return -1;
+  }
+  return hours * 60 + minutes;
+}
+
+// Index of a tube in tubeMappings, -1 for an unknown name
+int tubeIndexOf(const char *tubeName)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    if (strcmp(tubeMappings[i].tubeName, tubeName) == 0)
+      return i;
+  }
+  return -1;
+}
 
 MedicationTime schedules[MAX_SCHEDULES];
 int scheduleCount = 0;
@@ -93,6 +184,7 @@ struct GroupedMedication
   char dosages[MAX_MEDS_PER_TIME][16];
   char tubes[MAX_MEDS_PER_TIME][8];
   int amounts[MAX_MEDS_PER_TIME];
+  uint8_t pills[MAX_MEDS_PER_TIME];
   int count;
 };
 
@@ -102,10 +194,10 @@ int groupedCount = 0;
 bool setupMode = false;
 int currentTubeSetup = 0;
 int totalTubesNeeded = 0;
-char setupInstructions[200];
 bool waitingForDropButton = false;
 
 static bool triggerSetupAfterBT = false;
+static uint8_t setupTubeMask = 0xFF;   // Tubes the next setup walks through, bit per tubeMappings index
 
 char setupTubes[10][8];
 int setupTubeCount = 0;
@@ -122,152 +214,60 @@ void sendDummyClocks(uint8_t count)
   }
 }
 
-void openServo(Servo &servo, int standbyPos = 91, int openPos = 55)
-{
-  Serial.println(F("Opening servo"));
-  servo.write(openPos);
-  delay(600);
-  servo.write(standbyPos);
-}
-
-void closeServo(Servo &servo, int standbyPos = 91, int closePos = 125)
-{
-  Serial.println(F("Closing servo"));
-  servo.write(closePos);
-  delay(600);
-  servo.write(standbyPos);
-}
-
-void triggerMotor(int motorPin, bool turnOn)
-{
-  if (turnOn)
-  {
-    Serial.print(F("Starting motor on pin "));
-    Serial.println(motorPin);
-    digitalWrite(motorPin, HIGH);
-  }
-  else
-  {
-    Serial.print(F("Stopping motor on pin "));
-    Serial.println(motorPin);
-    digitalWrite(motorPin, LOW);
-  }
-}
-
-TubeMapping *getTubeMapping(const char *tubeName)
-{
-  for (int i = 0; i < 4; i++)
-  {
-    if (strcmp(tubeMappings[i].tubeName, tubeName) == 0)
-    {
-      return &tubeMappings[i];
-    }
-  }
-  return nullptr;
-}
-
-void dispenseFromTube(const char *tubeName)
-{
-  TubeMapping *mapping = getTubeMapping(tubeName);
-  if (mapping == nullptr)
-  {
-    Serial.print(F("Unknown tube: "));
-    Serial.println(tubeName);
-    return;
-  }
-
-  Serial.print(F("Dispensing from "));
-  Serial.println(tubeName);
-
-  openServo(*mapping->servo);
-  delayMicroseconds(200);
-
-  triggerMotor(mapping->motorPin, true);
-  motorStates[mapping->servoIndex] = true;
-
-  unsigned long startTime = millis();
-  bool dispensingComplete = false;
-
-  const unsigned long STABILIZE_DELAY = 500;
-  while (millis() - startTime < STABILIZE_DELAY)
-  {
-    delay(1);
-  }
-
-  const unsigned long TIMEOUT_MS = 30000;
-  while (millis() - startTime < TIMEOUT_MS)
-  {
-    int sensorState = digitalRead(Sensor_PIN);
-
-    delayMicroseconds(50);
-    if (sensorState == LOW && digitalRead(Sensor_PIN) == LOW)
-    {
-      Serial.println(F("Beam blocked → stopping motor"));
-      dispensingComplete = true;
-      break;
-    }
-
-    delayMicroseconds(200);
-  }
-
-  triggerMotor(mapping->motorPin, false);
-  motorStates[mapping->servoIndex] = false;
-  delayMicroseconds(100);
-  closeServo(*mapping->servo);
-
-  if (dispensingComplete)
-  {
-    Serial.println(F("Dispensing complete."));
-    dispensingComplete = false;
-  }
-  else
-  {
-    Serial.println(F("Timeout: No detection."));
-  }
-}
-
 void handleDispensing()
 {
   Serial.println(F("DROP button pressed - starting dispensing sequence"));
 
-  char currentTime[6];
-  sprintf(currentTime, "%02d:%02d", rtctime.hour(), rtctime.minute());
-
   GroupedMedication *currentGroup = nullptr;
-  for (int i = 0; i < groupedCount; i++)
-  {
-    if (strcmp(groupedSchedules[i].time, currentTime) == 0)
-    {
-      currentGroup = &groupedSchedules[i];
-      break;
-    }
-  }
+  if (notifyGroup >= 0 && notifyGroup < groupedCount && doseState(notifyGroup) == DOSE_NOTIFIED)
+    currentGroup = &groupedSchedules[notifyGroup];
 
   if (currentGroup == nullptr)
   {
-    Serial.println(F("No medications scheduled for current time"));
+    Serial.println(F("No dose waiting to be dispensed"));
     return;
   }
 
+  dispenserReset();
   for (int i = 0; i < currentGroup->count; i++)
   {
-    Serial.print(F("Dispensing medication "));
+    Serial.print(F("Queueing medication "));
     Serial.print(i + 1);
     Serial.print(F(" of "));
     Serial.print(currentGroup->count);
     Serial.print(F(": "));
     Serial.println(currentGroup->medications[i]);
 
-    dispenseFromTube(currentGroup->tubes[i]);
-
-    if (i < currentGroup->count - 1)
-    {
-      Serial.println(F("Waiting before next tube..."));
-      delay(2000);
-    }
+    dispenserQueue(currentGroup->tubes[i], currentGroup->pills[i]);
   }
 
-  Serial.println(F("Dispensing sequence complete"));
+  unsigned long sequenceStart = millis();
+  runDispenseSequence();
+
+  Serial.print(F("Dispensing sequence complete in "));
+  Serial.print(millis() - sequenceStart);
+  Serial.println(F(" ms"));
+
+  uint32_t finishedAt = rtc.now().unixtime();
+  uint16_t slotMinute = timeToMinutes(currentGroup->time);
+  for (uint8_t i = 0; i < dispenserJobCount(); i++)
+  {
+    const DispenseJob *job = dispenserJob(i);
+    DispenseLogRecord record;
+    record.timestamp = finishedAt;
+    record.slotMinute = slotMinute;
+    record.latency = min(job->latency, 0xFFFFUL);
+    record.tube = job->tube ? job->tube->servoIndex + 1 : 0;
+    record.pillsWanted = job->pillsWanted;
+    record.pillsSeen = job->pillsSeen;
+    record.outcome = job->outcome;
+    dispenseLogAdd(record);
+
+    if (job->tube)
+      inventoryConsume(job->tube->servoIndex, job->pillsSeen);
+  }
+  inventoryCommit();
+  doseDispensed(notifyGroup);
   showNotification = false;
   requestTFTUpdate();
 }
@@ -298,6 +298,124 @@ inline void selectSD()
   delayMicroseconds(50); // Increased settle time
 }
 
+// Static screen layouts, read from flash by drawLayout()
+const char strMedDispenser[] PROGMEM = "MedDispenser";
+const char strInitializing[] PROGMEM = "Initializing...";
+const char strLoading[] PROGMEM = "Loading...";
+const char strSdCardError[] PROGMEM = "SD CARD ERROR!";
+const char strNoScheduleData[] PROGMEM = "NO SCHEDULE DATA";
+const char strPleaseLoad[] PROGMEM = "Please load medication";
+const char strScheduleViaApp[] PROGMEM = "schedule via app";
+const char strMedicationSchedule[] PROGMEM = "MEDICATION SCHEDULE";
+const char strMedicationAlert[] PROGMEM = "!! MEDICATION ALERT !!";
+const char strPressDropToDispense[] PROGMEM = "Press DROP button to dispense";
+const char strTubeSetup[] PROGMEM = "TUBE SETUP";
+const char strPutTheseMedications[] PROGMEM = "Put these medications:";
+const char strPlaceMedication[] PROGMEM = "Place medication in tube";
+const char strThenPressDrop[] PROGMEM = "then press DROP button";
+const char strSetup[] PROGMEM = "SETUP";
+const char strComplete[] PROGMEM = "COMPLETE!";
+const char strSystemReadyFor[] PROGMEM = "System ready for";
+const char strAutomaticDispensing[] PROGMEM = "automatic dispensing";
+const char strPressDropWhenDone[] PROGMEM = "Press DROP button when done";
+
+const UiElement introLayout[] PROGMEM = {
+    UI_IMAGE_AT(113, 25, imgLogo),
+    UI_TEXT_AT(50, 100, 3, ST77XX_WHITE, strMedDispenser),
+    UI_TEXT_AT(80, 140, 1, ST77XX_WHITE, strInitializing),
+    UI_LAYOUT_END};
+
+const UiElement loadingLayout[] PROGMEM = {
+    UI_TEXT_AT(50, 120, 2, ST77XX_WHITE, strLoading),
+    UI_LAYOUT_END};
+
+const UiElement sdErrorLayout[] PROGMEM = {
+    UI_TEXT_AT(50, 100, 2, ST77XX_WHITE, strSdCardError),
+    UI_LAYOUT_END};
+
+const UiElement noScheduleLayout[] PROGMEM = {
+    UI_TEXT_AT(50, 90, 2, ST77XX_RED, strNoScheduleData),
+    UI_TEXT_AT(50, 120, 1, ST77XX_WHITE, strPleaseLoad),
+    UI_TEXT_AT(50, 135, 1, ST77XX_WHITE, strScheduleViaApp),
+    UI_LAYOUT_END};
+
+const UiElement scheduleTitleLayout[] PROGMEM = {
+    UI_TEXT_AT(10, 45, 1, ST77XX_CYAN, strMedicationSchedule),
+    UI_LAYOUT_END};
+
+// Origin is the top-left corner of the alert box
+const UiElement notificationLayout[] PROGMEM = {
+    UI_TEXT_AT(5, 10, 1, ST77XX_YELLOW, strMedicationAlert),
+    UI_LAYOUT_END};
+
+// Origin is the bottom-left corner of the alert box
+const UiElement notificationFooterLayout[] PROGMEM = {
+    UI_TEXT_AT(5, -25, 1, ST77XX_WHITE, strPressDropToDispense),
+    UI_LAYOUT_END};
+
+const UiElement tubeSetupLayout[] PROGMEM = {
+    UI_TEXT_AT(50, 50, 2, ST77XX_YELLOW, strTubeSetup),
+    UI_LAYOUT_END};
+
+const UiElement tubeSetupListLayout[] PROGMEM = {
+    UI_TEXT_AT(20, 90, 1, ST77XX_CYAN, strPutTheseMedications),
+    UI_LAYOUT_END};
+
+const UiElement tubeSetupHintLayout[] PROGMEM = {
+    UI_TEXT_AT(20, 200, 1, ST77XX_YELLOW, strPlaceMedication),
+    UI_TEXT_AT(20, 212, 1, ST77XX_YELLOW, strThenPressDrop),
+    UI_LAYOUT_END};
+
+const UiElement tubeSetupWaitLayout[] PROGMEM = {
+    UI_TEXT_AT(20, 200, 1, ST77XX_YELLOW, strPressDropWhenDone),
+    UI_LAYOUT_END};
+
+const UiElement setupCompleteLayout[] PROGMEM = {
+    UI_TEXT_AT(50, 100, 2, ST77XX_GREEN, strSetup),
+    UI_TEXT_AT(50, 130, 2, ST77XX_GREEN, strComplete),
+    UI_TEXT_AT(20, 170, 1, ST77XX_WHITE, strSystemReadyFor),
+    UI_TEXT_AT(20, 185, 1, ST77XX_WHITE, strAutomaticDispensing),
+    UI_LAYOUT_END};
+
+// Schedule card slots on the main menu, one per CARDS_PER_PAGE
+const UiRect cardSlotRects[CARDS_PER_PAGE] PROGMEM = {
+    {10, 65, 260, 75},
+    {10, 150, 260, 75}};
+
+const UiRect notificationRect PROGMEM = {10, 80, 260, 80};
+const UiRect setupProgressRect PROGMEM = {20, 226, 240, 10};
+
+// Text drawn at run time, see useAnchor(). The panel is 280x240 in rotation 1.
+const UiElement headerLayout[] PROGMEM = {
+    UI_RECT(UI_FILL_RECT, 0, 0, 280, HEADER_HEIGHT, ST77XX_BLUE),
+    UI_LAYOUT_END};
+
+const UiAnchor headerClock PROGMEM = {10, 8, 2, ST77XX_WHITE};
+const UiAnchor headerDate PROGMEM = {10, 22, 1, ST77XX_WHITE};
+const UiAnchor headerStatus PROGMEM = {160, 8, 1, ST77XX_WHITE};
+const UiAnchor headerLowStock PROGMEM = {160, 22, 1, ST77XX_YELLOW};
+const UiRect batteryIconRect PROGMEM = {252, 7, 24, 14};
+
+// Relative to a card slot; cards are the size of cardSlotRects
+const UiAnchor cardTime PROGMEM = {8, 8, 2, ST77XX_BLACK};
+const UiAnchor cardMedCount PROGMEM = {210, 8, 1, ST77XX_RED};
+const UiAnchor cardLines PROGMEM = {8, 32, 1, ST77XX_BLACK};  // Three lines, CARD_LINE_STEP apart
+const UiAnchor cardNext PROGMEM = {225, 60, 1, ST77XX_RED};
+
+// Message relative to the alert box's top-left corner, countdown to its bottom-left
+const UiAnchor notificationText PROGMEM = {5, 25, 1, ST77XX_WHITE};  // NOTIFICATION_LINE_STEP apart
+const UiRect notificationCountdownRect PROGMEM = {5, -15, 150, 10};
+const UiAnchor notificationCountdown PROGMEM = {5, -15, 1, ST77XX_WHITE};
+
+const UiRect pageIndicatorRect PROGMEM = {210, 40, 70, 20};
+const UiAnchor pageIndicator PROGMEM = {210, 45, 1, ST77XX_CYAN};
+const UiAnchor scheduleTotals PROGMEM = {10, 230, 1, ST77XX_CYAN};
+
+const UiAnchor setupProgressText PROGMEM = {20, 75, 1, ST77XX_WHITE};
+const UiAnchor setupMedList PROGMEM = {20, 105, 1, ST77XX_WHITE};  // SETUP_LIST_STEP apart
+const UiAnchor setupIntoTube PROGMEM = {20, 172, 1, ST77XX_GREEN};
+const UiAnchor setupTotal PROGMEM = {20, 184, 1, ST77XX_GREEN};
+
 void drawLoadingBar(int progress, int x, int y, int width, int height)
 {
   tft.drawRect(x, y, width, height, ST77XX_WHITE);
@@ -335,6 +453,17 @@ void releaseSD()
   digitalWrite(SD_CS, HIGH);
 }
 
+void flushDispenseLog()
+{
+  if (sdBusy)
+    return;
+  sdBusy = true;
+  selectSD();
+  dispenseLogFlush(SD);
+  deselectAll();
+  sdBusy = false;
+}
+
 int findMatchingBrace(const String &str, int start)
 {
   int braceCount = 0;
@@ -357,14 +486,7 @@ void animatedIntro()
   tft.fillScreen(ST77XX_BLACK);
   tft.setRotation(1);
 
-  tft.setTextSize(3);
-  tft.setTextColor(ST77XX_WHITE);
-  tft.setCursor(50, 100);
-  tft.println(F("MedDispenser"));
-
-  tft.setTextSize(1);
-  tft.setCursor(80, 140);
-  tft.println(F("Initializing..."));
+  drawLayout(tft, introLayout);
 
   delay(2000);
 }
@@ -401,12 +523,15 @@ void groupMedicationsByTime()
       strcpy(groupedSchedules[groupIndex].dosages[medIndex], schedules[i].dosage);
       strcpy(groupedSchedules[groupIndex].tubes[medIndex], schedules[i].tube);
       groupedSchedules[groupIndex].amounts[medIndex] = schedules[i].amount;
+      groupedSchedules[groupIndex].pills[medIndex] = schedules[i].pills;
       groupedSchedules[groupIndex].count++;
     }
   }
 }
 
-bool startStreamingSave()
+// resume keeps data.tmp as it is, for a framed upload picking up where
+// a dropped link left it. A fresh save also drops the stale resume map.
+bool startStreamingSave(bool resume = false)
 {
   const char *tmpName = "data.tmp";
 
@@ -419,13 +544,20 @@ bool startStreamingSave()
 
   selectSD();
 
-  if (SD.exists(tmpName))
+  if (!resume)
   {
-    SD.remove(tmpName);
-    delay(100);
+    if (SD.exists(tmpName))
+    {
+      SD.remove(tmpName);
+      delay(100);
+    }
+    if (SD.exists(LINK_MAP_FILE))
+    {
+      SD.remove(LINK_MAP_FILE);
+    }
   }
 
-  streamingFile = SD.open(tmpName, O_WRITE | O_CREAT | O_TRUNC);
+  streamingFile = SD.open(tmpName, resume ? (O_RDWR | O_CREAT) : (O_RDWR | O_CREAT | O_TRUNC));
   if (!streamingFile)
   {
     Serial.println(F("startStreamingSave: ERROR opening temp for write!"));
@@ -441,6 +573,7 @@ bool startStreamingSave()
 
 bool writeStreamingChunk(const String &chunk)
 {
+  StageScope stage(STAGE_SAVE);
   if (!streamingActive || !streamingFile)
   {
     return false;
@@ -457,6 +590,100 @@ bool writeStreamingChunk(const String &chunk)
   return true;
 }
 
+// Binary twin of writeStreamingChunk() for framed uploads, which may
+// arrive out of order. No flush per chunk: saveLinkMap() and
+// finishStreamingSave() sync, and a slow flush here would overrun the
+// 64-byte Serial1 receive buffer mid-window.
+bool writeStreamingAt(uint32_t offset, const uint8_t *data, uint8_t len)
+{
+  StageScope stage(STAGE_SAVE);
+  if (!streamingActive || !streamingFile)
+  {
+    return false;
+  }
+
+  if (!streamingFile.seekSet(offset) || streamingFile.write(data, len) != len)
+  {
+    Serial.println(F("writeStreamingAt: ERROR incomplete write!"));
+    return false;
+  }
+  return true;
+}
+
+// FAT files can't be seeked past their end, so a fresh framed upload
+// fills data.tmp to its final size before chunks land at their offsets.
+bool sizeStreamingFile(uint32_t size)
+{
+  StageScope stage(STAGE_SAVE);
+  uint8_t zeros[32];
+  memset(zeros, 0, sizeof(zeros));
+
+  streamingFile.seekSet(0);
+  while (size > 0)
+  {
+    uint8_t n = size < sizeof(zeros) ? size : sizeof(zeros);
+    if (streamingFile.write(zeros, n) != n)
+    {
+      Serial.println(F("sizeStreamingFile: ERROR write failed!"));
+      return false;
+    }
+    size -= n;
+  }
+  return streamingFile.sync();
+}
+
+uint16_t streamingFileCrc(uint32_t size)
+{
+  uint8_t buffer[32];
+  uint16_t crc = 0xFFFF;
+
+  streamingFile.seekSet(0);
+  while (size > 0)
+  {
+    int n = streamingFile.read(buffer, size < sizeof(buffer) ? size : sizeof(buffer));
+    if (n <= 0)
+      break;
+    crc = linkCrc16(crc, buffer, n);
+    size -= n;
+  }
+  return crc;
+}
+
+// Data first, then the map, so the map never claims a chunk that is
+// not on the card yet. Caller holds the SD card (streaming save open).
+bool saveLinkMap()
+{
+  StageScope stage(STAGE_SAVE);
+  streamingFile.sync();
+  File f = SD.open(LINK_MAP_FILE, O_RDWR | O_CREAT);
+  if (!f)
+  {
+    Serial.println(F("saveLinkMap: cannot open map"));
+    return false;
+  }
+  bool ok = f.write((const uint8_t *)&linkMap, sizeof(linkMap)) == sizeof(linkMap);
+  f.close();
+  linkSinceSave = 0;
+  return ok;
+}
+
+bool loadLinkMap(LinkResumeMap &map)
+{
+  if (sdBusy)
+    return false;
+
+  selectSD();
+  File f = SD.open(LINK_MAP_FILE, FILE_READ);
+  bool ok = false;
+  if (f)
+  {
+    ok = f.read(&map, sizeof(map)) == (int)sizeof(map);
+    f.close();
+  }
+  deselectAll();
+  return ok;
+}
+
 void endStreamingSave()
 {
   if (streamingFile)
@@ -473,23 +700,31 @@ void endStreamingSave()
 
 bool finishStreamingSave()
 {
+  StageScope stage(STAGE_SAVE);
   if (!streamingActive)
     return false;
 
   const char *tmpName = "data.tmp";
-  const char *finalName = "data.json";
 
+  // The app sends either the binary schedule or JSON; the other format's
+  // file goes so loadScheduleData() never picks up a stale schedule
+  uint8_t head[4];
+  streamingFile.seekSet(0);
+  bool binary = streamingFile.read(head, sizeof(head)) == sizeof(head) && scheduleIsBinary(head, sizeof(head));
+  const char *finalName = binary ? SCHEDULE_BIN_FILE : SCHEDULE_JSON_FILE;
+  const char *staleName = binary ? SCHEDULE_JSON_FILE : SCHEDULE_BIN_FILE;
+
+  // SdFat writes the directory entry before close() returns, so the
+  // card is ready for the remove and rename straight away
   streamingFile.sync();
   streamingFile.close();
   streamingActive = false;
-  delay(50);
 
   if (SD.exists(finalName))
   {
     bool removed = false;
     for (int attempt = 0; attempt < 6; ++attempt)
     {
-      delay(40);
       removed = SD.remove(finalName);
       Serial.print(F("finishStreamingSave: remove final attempt "));
       Serial.print(attempt);
@@ -497,6 +732,7 @@ bool finishStreamingSave()
       Serial.println(removed ? F("ok") : F("fail"));
       if (removed)
         break;
+      delay(40);                       // Only after a failed remove
     }
   }
 
@@ -518,7 +754,6 @@ bool finishStreamingSave()
     if (SD.exists(finalName))
     {
       SD.remove(finalName);
-      delay(10);
     }
 
     File f2 = SD.open(finalName, O_WRITE | O_CREAT | O_TRUNC);
@@ -548,22 +783,16 @@ bool finishStreamingSave()
     }
   }
 
+  if (SD.exists(staleName))
+  {
+    SD.remove(staleName);
+  }
+
   sdBusy = false;
   Serial.println(F("Streaming save completed successfully"));
-  delay(500);
   return true;
 }
 
-int timeToMinutes(const char *timeStr)
-{
-  int hours, minutes;
-  if (sscanf(timeStr, "%d:%d", &hours, &minutes) != 2)
-  {
-    return -1;
-  }
-  return hours * 60 + minutes;
-}
-
 int findNextMedication()
 {
   int currentMinutes = rtctime.hour() * 60 + rtctime.minute();
@@ -589,77 +818,127 @@ int findNextMedication()
   return closestIndex;
 }
 
-bool checkMedicationTime()
+void buildScheduleOrder()
 {
-  char currentTime[6];
-  sprintf(currentTime, "%02d:%02d", rtctime.hour(), rtctime.minute());
+  nextScheduleIndex = findNextMedication();
+
+  int currentMinutes = rtctime.hour() * 60 + rtctime.minute();
+  int offsets[MAX_GROUPED];
 
+  // Insertion sort by minutes until the dose; stable, so ties keep file order
+  // and the first entry always matches findNextMedication().
   for (int i = 0; i < groupedCount; i++)
   {
-    if (strcmp(groupedSchedules[i].time, currentTime) == 0)
+    int scheduleMinutes = timeToMinutes(groupedSchedules[i].time);
+    int difference = 24 * 60;
+    if (scheduleMinutes != -1)
     {
-      if (groupedSchedules[i].count == 1)
-      {
-        snprintf(notificationMessage, sizeof(notificationMessage),
-                 "TIME TO TAKE: %s - %s",
-                 groupedSchedules[i].medications[0],
-                 groupedSchedules[i].dosages[0]);
-      }
-      else
-      {
-        snprintf(notificationMessage, sizeof(notificationMessage),
-                 "TIME TO TAKE %d MEDS: %s (%s)",
-                 groupedSchedules[i].count,
-                 groupedSchedules[i].medications[0],
-                 groupedSchedules[i].dosages[0]);
+      difference = scheduleMinutes - currentMinutes;
+      if (difference < 0)
+        difference += 24 * 60;
+    }
 
-        if (groupedSchedules[i].count > 1 && strlen(notificationMessage) < 150)
-        {
-          char temp[50];
-          snprintf(temp, sizeof(temp), " + %s (%s)",
-                   groupedSchedules[i].medications[1],
-                   groupedSchedules[i].dosages[1]);
-          strncat(notificationMessage, temp, sizeof(notificationMessage) - strlen(notificationMessage) - 1);
-        }
-      }
-      return true;
+    int j = i;
+    while (j > 0 && offsets[j - 1] > difference)
+    {
+      offsets[j] = offsets[j - 1];
+      scheduleOrder[j] = scheduleOrder[j - 1];
+      j--;
     }
+    offsets[j] = difference;
+    scheduleOrder[j] = i;
   }
-  return false;
 }
 
-bool loadScheduleData()
+// Notification text for a grouped slot
+void buildNotification(int i)
 {
-  if (sdBusy)
+  if (groupedSchedules[i].count == 1)
   {
-    Serial.println(F("loadScheduleData: SD busy, abort"));
-    return false;
+    snprintf_P(notificationMessage, sizeof(notificationMessage),
+               PSTR("TIME TO TAKE: %s - %s"),
+               groupedSchedules[i].medications[0],
+               groupedSchedules[i].dosages[0]);
   }
-  sdBusy = true;
+  else
+  {
+    snprintf_P(notificationMessage, sizeof(notificationMessage),
+               PSTR("TIME TO TAKE %d MEDS: %s (%s)"),
+               groupedSchedules[i].count,
+               groupedSchedules[i].medications[0],
+               groupedSchedules[i].dosages[0]);
 
-  selectSD();
+    if (groupedSchedules[i].count > 1 && strlen(notificationMessage) < 150)
+    {
+      char temp[50];
+      snprintf_P(temp, sizeof(temp), PSTR(" + %s (%s)"),
+                 groupedSchedules[i].medications[1],
+                 groupedSchedules[i].dosages[1]);
+      strncat(notificationMessage, temp, sizeof(notificationMessage) - strlen(notificationMessage) - 1);
+    }
+  }
+}
 
-  File f = SD.open("data.json", FILE_READ);
-  if (!f)
+// Rebuilds the dose table for the current schedule; states of slots that
+// kept their time survive. Event 1 re-evaluates it on the next loop.
+void updateDoseTable()
+{
+  doseClear();
+  for (int i = 0; i < groupedCount; i++)
   {
-    Serial.println(F("Cannot find data.json"));
-    deselectAll();
-    sdBusy = false;
-    return false;
+    int minute = timeToMinutes(groupedSchedules[i].time);
+    if (minute >= 0)
+      doseAddSlot(minute, i);
   }
+  doseCommit();
+  notifyGroup = -1;
+  lastDisplayedMinute = 255;
+}
 
-  size_t fileSize = f.size();
-  Serial.print(F("loadScheduleData: fileSize = "));
-  Serial.println(fileSize);
-  if (fileSize == 0)
+// Writes a log record per medication of a group whose grace window ran out
+void logMissedDoses(uint16_t missed)
+{
+  uint32_t now = rtctime.unixtime();
+  for (int i = 0; i < groupedCount; i++)
   {
-    Serial.println(F("loadScheduleData: file empty"));
-    f.close();
-    deselectAll();
-    sdBusy = false;
-    return false;
+    if (!(missed & (1 << i)))
+      continue;
+
+    Serial.print(F("Missed dose at "));
+    Serial.println(groupedSchedules[i].time);
+    for (int j = 0; j < groupedSchedules[i].count; j++)
+    {
+      DispenseLogRecord record;
+      record.timestamp = now;
+      record.slotMinute = timeToMinutes(groupedSchedules[i].time);
+      record.latency = 0;
+      record.tube = tubeIndexOf(groupedSchedules[i].tubes[j]) + 1;
+      record.pillsWanted = groupedSchedules[i].pills[j];
+      record.pillsSeen = 0;
+      record.outcome = DISPENSE_MISSED;
+      dispenseLogAdd(record);
+    }
+  }
+}
+
+// Daily pills per tube from the grouped schedule; every group is one daily slot
+void updateInventoryUse()
+{
+  inventoryClearUse();
+  for (int i = 0; i < groupedCount; i++)
+  {
+    for (int j = 0; j < groupedSchedules[i].count; j++)
+    {
+      int tube = tubeIndexOf(groupedSchedules[i].tubes[j]);
+      if (tube >= 0)
+        inventoryAddUse(tube, groupedSchedules[i].pills[j]);
+    }
   }
+  inventoryCommit();
+}
 
+bool loadScheduleJson(File &f)
+{
   StaticJsonDocument<128> filter;
   filter[0]["tube"] = true;
   filter[0]["type"] = true;
@@ -667,26 +946,20 @@ bool loadScheduleData()
   filter[0]["time_to_take"][0]["time"] = true;
   filter[0]["time_to_take"][0]["dosage"] = true;
 
-  scheduleCount = 0;
-
   StaticJsonDocument<1024> doc;
   ReadBufferingStream in(f, 32);
   DeserializationError err = deserializeJson(doc, in, DeserializationOption::Filter(filter));
 
-  f.close();
-
   if (err)
   {
     Serial.print(F("JSON parse error: "));
     Serial.println(err.c_str());
-    sdBusy = false;
     return false;
   }
 
   if (!doc.is<JsonArray>())
   {
     Serial.println(F("JSON root is not an array"));
-    sdBusy = false;
     return false;
   }
 
@@ -721,103 +994,214 @@ bool loadScheduleData()
 
       strncpy(schedules[scheduleCount].dosage, dosageC, sizeof(schedules[scheduleCount].dosage) - 1);
       schedules[scheduleCount].dosage[sizeof(schedules[scheduleCount].dosage) - 1] = '\0';
+      schedules[scheduleCount].pills = parseDosagePills(dosageC);
 
       scheduleCount++;
     }
   }
-
-  sdBusy = false;
-  groupMedicationsByTime();
-  Serial.print(F("Loaded "));
-  Serial.print(scheduleCount);
-  Serial.println(F(" medication schedules"));
-
-  releaseSD();
-
-  return scheduleCount > 0;
+  return true;
 }
 
-void drawHeader()
+bool loadScheduleBinary(File &f)
 {
-  tft.fillRect(0, 0, 320, 35, ST77XX_BLUE);
+  ReadBufferingStream in(f, 32);
+  int count = scheduleDecode(in, schedules, MAX_SCHEDULES);
+  if (count < 0)
+  {
+    Serial.println(F("Binary schedule is malformed"));
+    return false;
+  }
+  scheduleCount = count;
+  return true;
+}
 
-  tft.setTextSize(2);
-  tft.setTextColor(ST77XX_WHITE);
-  tft.setCursor(10, 8);
-  if (rtctime.hour() < 10)
-    tft.print("0");
-  tft.print(rtctime.hour());
-  tft.print(":");
+bool loadScheduleData()
+{
+  if (sdBusy)
+  {
+    Serial.println(F("loadScheduleData: SD busy, abort"));
+    return false;
+  }
+  sdBusy = true;
+
+  selectSD();
+
+  // data.bin from the app wins; data.json is the legacy and hand-edited format
+  bool binary = SD.exists(SCHEDULE_BIN_FILE);
+  File f = SD.open(binary ? SCHEDULE_BIN_FILE : SCHEDULE_JSON_FILE, FILE_READ);
+  if (!f)
+  {
+    Serial.println(F("Cannot find a schedule file"));
+    deselectAll();
+    sdBusy = false;
+    return false;
+  }
+
+  size_t fileSize = f.size();
+  Serial.print(F("loadScheduleData: fileSize = "));
+  Serial.println(fileSize);
+  if (fileSize == 0)
+  {
+    Serial.println(F("loadScheduleData: file empty"));
+    f.close();
+    deselectAll();
+    sdBusy = false;
+    return false;
+  }
+
+  scheduleCount = 0;
+
+  stageBegin(STAGE_LOAD);
+  unsigned long parseStart = micros();
+  bool parsed = binary ? loadScheduleBinary(f) : loadScheduleJson(f);
+  unsigned long parseUs = micros() - parseStart;
+
+  f.close();
+  stageEnd(STAGE_LOAD);
+
+  if (!parsed)
+  {
+    sdBusy = false;
+    return false;
+  }
+
+  sdBusy = false;
+  stageBegin(STAGE_REGROUP);
+  groupMedicationsByTime();
+  buildScheduleOrder();
+  updateInventoryUse();
+  updateDoseTable();
+  stageEnd(STAGE_REGROUP);
+  Serial.print(F("Loaded "));
+  Serial.print(scheduleCount);
+  Serial.print(binary ? F(" binary") : F(" JSON"));
+  Serial.print(F(" medication schedules, parse "));
+  Serial.print(parseUs);
+  Serial.println(F(" us"));
+
+  releaseSD();
+
+  return scheduleCount > 0;
+}
+
+// Battery icon for the header: 0-3 bars, or the mains plug when no sense
+// divider is fitted.
+const RleImage *batteryIcon()
+{
+  if (BATTERY_SENSE_PIN < 0)
+    return &imgBatteryExt;
+
+  long millivolts = (long)analogRead(BATTERY_SENSE_PIN) * 5000L * BATTERY_DIVIDER / 1023L;
+  long percent = (millivolts - BATTERY_MV_EMPTY) * 100L / (BATTERY_MV_FULL - BATTERY_MV_EMPTY);
+
+  if (percent < 10)
+    return &imgBattery0;
+  if (percent < 40)
+    return &imgBattery1;
+  if (percent < 75)
+    return &imgBattery2;
+  return &imgBattery3;
+}
+
+// Shortest-lasting low tube under the status line, "+N" for further low tubes
+void drawLowStock()
+{
+  uint8_t low = inventoryLowMask();
+  if (low == 0)
+    return;
+
+  int worst = -1;
+  int others = -1;
+  for (int i = 0; i < INVENTORY_TUBES; i++)
+  {
+    if (!(low & (1 << i)))
+      continue;
+    others++;
+    if (worst < 0 || inventoryDaysLeft(i) < inventoryDaysLeft(worst))
+      worst = i;
+  }
+
+  char text[24];                       // "LOW T" int " " uint16 "d"
+  snprintf_P(text, sizeof(text), PSTR("LOW T%d %ud"), worst + 1, inventoryDaysLeft(worst));
+  useAnchor(tft, &headerLowStock);
+  tft.print(text);
+  if (others > 0)
+  {
+    tft.print('+');
+    tft.print(others);
+  }
+}
+
+void drawHeader()
+{
+  drawLayout(tft, headerLayout);
+
+  useAnchor(tft, &headerClock);
+  if (rtctime.hour() < 10)
+    tft.print('0');
+  tft.print(rtctime.hour());
+  tft.print(':');
   if (rtctime.minute() < 10)
-    tft.print("0");
+    tft.print('0');
   tft.print(rtctime.minute());
 
-  tft.setTextSize(1);
-  tft.setCursor(10, 22);
+  useAnchor(tft, &headerDate);
   tft.print(rtctime.day());
-  tft.print("/");
+  tft.print('/');
   tft.print(rtctime.month());
-  tft.print("/");
+  tft.print('/');
   tft.print(rtctime.year());
 
-  tft.setTextSize(1);
-  tft.setCursor(200, 8);
+  useAnchor(tft, &headerStatus);
   tft.print(F("STATUS: "));
   tft.setTextColor(filestat ? ST77XX_GREEN : ST77XX_RED);
   tft.print(filestat ? F("READY") : F("ERROR"));
 
-  tft.fillRect(290, 8, 20, 12, ST77XX_GREEN);
-  tft.drawRect(289, 7, 22, 14, ST77XX_WHITE);
-  tft.fillRect(311, 10, 3, 8, ST77XX_WHITE);
+  drawLowStock();
+
+  UiRect battery = readRect(&batteryIconRect);
+  drawRleImage(tft, battery.x, battery.y, batteryIcon());
 }
 
 void drawGroupedMedicationCard(int x, int y, int width, int height, GroupedMedication group, bool isNext = false)
 {
   uint16_t cardColor = isNext ? ST77XX_YELLOW : ST77XX_WHITE;
-  uint16_t textColor = isNext ? ST77XX_BLACK : ST77XX_BLACK;
 
-  tft.fillRoundRect(x, y, width, height, 8, cardColor);
-  tft.drawRoundRect(x, y, width, height, 8, isNext ? ST77XX_RED : ST77XX_BLUE);
+  tft.fillRoundRect(x, y, width, height, CARD_RADIUS, cardColor);
+  tft.drawRoundRect(x, y, width, height, CARD_RADIUS, isNext ? ST77XX_RED : ST77XX_BLUE);
 
-  tft.setTextSize(2);
-  tft.setTextColor(textColor);
-  tft.setCursor(x + 8, y + 8);
+  useAnchor(tft, &cardTime, x, y);
   tft.print(group.time);
 
   if (group.count > 1)
   {
-    tft.setTextSize(1);
-    tft.setTextColor(ST77XX_RED);
-    tft.setCursor(x + width - 50, y + 8);
+    useAnchor(tft, &cardMedCount, x, y);
     tft.print(group.count);
     tft.print(F(" MEDS"));
   }
 
-  tft.setTextSize(1);
-  tft.setTextColor(textColor);
-  tft.setCursor(x + 8, y + 32);
+  UiAnchor line = useAnchor(tft, &cardLines, x, y);
   tft.print(group.medications[0]);
   tft.print(F(" - "));
   tft.print(group.dosages[0]);
 
   if (group.count > 1)
   {
-    tft.setCursor(x + 8, y + 45);
+    tft.setCursor(line.x, line.y + CARD_LINE_STEP);
     tft.print(group.medications[1]);
     tft.print(F(" - "));
     tft.print(group.dosages[1]);
   }
 
+  tft.setCursor(line.x, line.y + 2 * CARD_LINE_STEP);
   if (group.count > 2)
   {
-    tft.setCursor(x + 8, y + 58);
     tft.print(F("+ "));
     tft.print(group.count - 2);
     tft.print(F(" more medications"));
   }
-  else if (group.count <= 2)
+  else
   {
-    tft.setCursor(x + 8, y + 58);
     tft.print(group.tubes[0]);
     if (group.count == 2)
     {
@@ -828,94 +1212,82 @@ void drawGroupedMedicationCard(int x, int y, int width, int height, GroupedMedic
 
   if (isNext)
   {
-    tft.setTextSize(1);
-    tft.setTextColor(ST77XX_RED);
-    tft.setCursor(x + width - 35, y + height - 15);
+    useAnchor(tft, &cardNext, x, y);
     tft.print(F("NEXT"));
   }
 }
 
+UiRect notificationBox()
+{
+  UiRect box = readRect(&notificationRect);
+  if (strlen(notificationMessage) > 50)
+    box.h += 20;
+  return box;
+}
+
+void drawNotificationCountdown()
+{
+  UiRect box = notificationBox();
+  long currentCountdown = (long)(NOTIFICATION_TIMEOUT - (millis() - notificationStartTime)) / 1000;
+  if (currentCountdown < 0)
+    currentCountdown = 0;
+
+  UiRect area = readRect(&notificationCountdownRect);
+  tft.fillRect(box.x + area.x, box.y + box.h + area.y, area.w, area.h, ST77XX_RED);
+  useAnchor(tft, &notificationCountdown, box.x, box.y + box.h);
+  tft.print(F("Auto-dismiss in "));
+  tft.print(currentCountdown);
+  tft.print(F("s"));
+}
+
 void drawNotification()
 {
   if (!showNotification)
     return;
 
-  int notifHeight = 80;
-  if (strlen(notificationMessage) > 50)
-  {
-    notifHeight = 100;
-  }
+  UiRect box = notificationBox();
 
-  int currentCountdown = 300 - (millis() - notificationStartTime) / 1000;
+  tft.fillRect(box.x, box.y, box.w, box.h, ST77XX_RED);
+  tft.drawRect(box.x - 1, box.y - 1, box.w + 2, box.h + 2, ST77XX_WHITE);
+  drawLayout(tft, notificationLayout, box.x, box.y);
 
-  bool needFullRedraw = (lastCountdownValue == -1) ||
-                        (millis() - lastCountdownUpdate > 10000); // Update every 10 seconds
+  UiAnchor text = useAnchor(tft, &notificationText, box.x, box.y);
+  int lineY = text.y;
+  int charsPerLine = 35;
 
-  if (needFullRedraw)
-  {
-    tft.fillRect(10, 80, 300, notifHeight, ST77XX_RED);
-    tft.drawRect(9, 79, 302, notifHeight + 2, ST77XX_WHITE);
+  int msgLen = strlen(notificationMessage);
+  int pos = 0;
 
-    tft.setTextSize(1);
-    tft.setTextColor(ST77XX_YELLOW);
-    tft.setCursor(15, 90);
-    tft.print(F("!! MEDICATION ALERT !!"));
-
-    tft.setTextSize(1);
-    tft.setTextColor(ST77XX_WHITE);
-    int lineY = 105;
-    int charsPerLine = 35;
-
-    int msgLen = strlen(notificationMessage);
-    int pos = 0;
+  while (pos < msgLen && lineY < box.y + box.h - 20)
+  {
+    int lineEnd = pos + charsPerLine;
+    if (lineEnd > msgLen)
+      lineEnd = msgLen;
 
-    while (pos < msgLen && lineY < 80 + notifHeight - 20)
+    if (lineEnd < msgLen)
     {
-      int lineEnd = pos + charsPerLine;
-      if (lineEnd > msgLen)
-        lineEnd = msgLen;
-
-      if (lineEnd < msgLen)
+      while (lineEnd > pos && notificationMessage[lineEnd] != ' ')
       {
-        while (lineEnd > pos && notificationMessage[lineEnd] != ' ')
-        {
-          lineEnd--;
-        }
-        if (lineEnd == pos)
-          lineEnd = pos + charsPerLine;
+        lineEnd--;
       }
-
-      tft.setCursor(15, lineY);
-      for (int i = pos; i < lineEnd; i++)
-      {
-        tft.print(notificationMessage[i]);
-      }
-
-      pos = lineEnd;
-      if (pos < msgLen && notificationMessage[pos] == ' ')
-        pos++;
-      lineY += 12;
+      if (lineEnd == pos)
+        lineEnd = pos + charsPerLine;
     }
 
-    tft.setTextSize(1);
-    tft.setCursor(15, 80 + notifHeight - 25);
-    tft.print(F("Press DROP button to dispense"));
-
-    tft.fillRect(15, 80 + notifHeight - 15, 150, 10, ST77XX_RED);
-    tft.setCursor(15, 80 + notifHeight - 15);
-    tft.print(F("Auto-dismiss in "));
-    tft.print(currentCountdown);
-    tft.print(F("s"));
+    tft.setCursor(text.x, lineY);
+    for (int i = pos; i < lineEnd; i++)
+    {
+      tft.print(notificationMessage[i]);
+    }
 
-    lastCountdownUpdate = millis();
-    lastCountdownValue = currentCountdown;
+    pos = lineEnd;
+    if (pos < msgLen && notificationMessage[pos] == ' ')
+      pos++;
+    lineY += NOTIFICATION_LINE_STEP;
   }
 
-  if (millis() - notificationStartTime > 300000)
-  {
-    showNotification = false;
-    lastCountdownValue = -1; // Reset for next notification
-  }
+  drawLayout(tft, notificationFooterLayout, box.x, box.y + box.h);
+  drawNotificationCountdown();
 }
 
 void startTubeSetupMode()
@@ -928,6 +1300,11 @@ void startTubeSetupMode()
 
   for (int i = 0; i < scheduleCount; i++)
   {
+    // After an edit only the tubes whose contents changed need refilling
+    int tube = tubeIndexOf(schedules[i].tube);
+    if (setupTubeMask != 0xFF && (tube < 0 || !(setupTubeMask & (1 << tube))))
+      continue;
+
     bool tubeExists = false;
 
     for (int j = 0; j < setupTubeCount; j++)
@@ -947,6 +1324,13 @@ void startTubeSetupMode()
   }
 
   totalTubesNeeded = setupTubeCount;
+  setupTubeMask = 0xFF;
+
+  if (setupTubeCount == 0)
+  {
+    setupMode = false;
+    return;
+  }
 
   Serial.println(F("Starting tube setup mode"));
   Serial.print(F("Total unique tubes to configure: "));
@@ -964,15 +1348,9 @@ void showTubeSetupScreen()
 {
   tft.fillScreen(ST77XX_BLACK);
   drawHeader();
+  drawLayout(tft, tubeSetupLayout);
 
-  tft.setTextSize(2);
-  tft.setTextColor(ST77XX_YELLOW);
-  tft.setCursor(50, 50);
-  tft.print(F("TUBE SETUP"));
-
-  tft.setTextSize(1);
-  tft.setTextColor(ST77XX_WHITE);
-  tft.setCursor(20, 80);
+  useAnchor(tft, &setupProgressText);
   tft.print(F("Tube "));
   tft.print(currentTubeSetup + 1);
   tft.print(F(" of "));
@@ -982,22 +1360,18 @@ void showTubeSetupScreen()
   {
     const char *currentTubeName = setupTubes[currentTubeSetup];
 
-    tft.setTextSize(1);
-    tft.setTextColor(ST77XX_CYAN);
-    tft.setCursor(20, 100);
-    tft.print(F("Put these medications:"));
+    drawLayout(tft, tubeSetupListLayout);
 
     int medCount = 0;
-    int displayY = 120;
+    UiAnchor list = useAnchor(tft, &setupMedList);
+    int displayY = list.y;
     int totalAmount = 0;
 
     for (int i = 0; i < scheduleCount; i++)
     {
       if (strcmp(schedules[i].tube, currentTubeName) == 0)
       {
-        tft.setTextSize(1);
-        tft.setTextColor(ST77XX_WHITE);
-        tft.setCursor(20, displayY);
+        tft.setCursor(list.x, displayY);
         tft.print(schedules[i].medication);
         tft.print(F(" ("));
         tft.print(schedules[i].amount);
@@ -1005,55 +1379,42 @@ void showTubeSetupScreen()
 
         totalAmount += schedules[i].amount;
         medCount++;
-        displayY += 15;
+        displayY += SETUP_LIST_STEP;
 
         if (medCount >= 4)
         {
-          tft.setCursor(20, displayY);
+          tft.setCursor(list.x, displayY);
           tft.print(F("+ more..."));
           break;
         }
       }
     }
 
-    tft.setTextSize(1);
-    tft.setTextColor(ST77XX_GREEN);
-    tft.setCursor(20, 190);
+    useAnchor(tft, &setupIntoTube);
     tft.print(F("Into TUBE: "));
     tft.print(currentTubeName);
 
-    tft.setCursor(20, 205);
+    useAnchor(tft, &setupTotal);
     tft.print(F("Total: "));
     tft.print(totalAmount);
     tft.print(F("g"));
   }
 
-  tft.setTextSize(1);
-  tft.setTextColor(ST77XX_YELLOW);
-  tft.setCursor(20, 220);
   if (waitingForDropButton)
   {
     bool blink = (millis() / 500) % 2;
     if (blink)
-    {
-      tft.print(F("Press DROP button when done"));
-    }
+      drawLayout(tft, tubeSetupWaitLayout);
   }
   else
   {
-    tft.print(F("Place medication in tube"));
-    tft.setCursor(20, 235);
-    tft.print(F("then press DROP button"));
+    drawLayout(tft, tubeSetupHintLayout);
   }
 
-  int barWidth = 280;
-  int barHeight = 10;
-  int barX = 20;
-  int barY = 250;
-
-  tft.drawRect(barX, barY, barWidth, barHeight, ST77XX_WHITE);
-  int progress = (currentTubeSetup * barWidth) / totalTubesNeeded;
-  tft.fillRect(barX + 1, barY + 1, progress, barHeight - 2, ST77XX_GREEN);
+  UiRect bar = readRect(&setupProgressRect);
+  tft.drawRect(bar.x, bar.y, bar.w, bar.h, ST77XX_WHITE);
+  int progress = (currentTubeSetup * bar.w) / totalTubesNeeded;
+  tft.fillRect(bar.x + 1, bar.y + 1, progress, bar.h - 2, ST77XX_GREEN);
 }
 
 void handleTubeSetupButton()
@@ -1062,6 +1423,29 @@ void handleTubeSetupButton()
   Serial.print(currentTubeSetup + 1);
   Serial.println(F(" setup completed"));
 
+  // The tube now holds what the schedule says was loaded into it
+  int tube = tubeIndexOf(setupTubes[currentTubeSetup]);
+  if (tube >= 0)
+  {
+    // amount is the medication's total, repeated on each of its time rows
+    int loaded = 0;
+    for (int i = 0; i < scheduleCount; i++)
+    {
+      if (strcmp(schedules[i].tube, setupTubes[currentTubeSetup]) != 0)
+        continue;
+      bool counted = false;
+      for (int j = 0; j < i && !counted; j++)
+      {
+        counted = strcmp(schedules[j].tube, schedules[i].tube) == 0 &&
+                  strcmp(schedules[j].medication, schedules[i].medication) == 0;
+      }
+      if (!counted)
+        loaded += schedules[i].amount;
+    }
+    inventorySetStock(tube, loaded);
+    inventoryCommit();
+  }
+
   currentTubeSetup++;
   waitingForDropButton = false;
 
@@ -1073,19 +1457,7 @@ void handleTubeSetupButton()
 
     tft.fillScreen(ST77XX_BLACK);
     drawHeader();
-    tft.setTextSize(2);
-    tft.setTextColor(ST77XX_GREEN);
-    tft.setCursor(50, 100);
-    tft.print(F("SETUP"));
-    tft.setCursor(50, 130);
-    tft.print(F("COMPLETE!"));
-
-    tft.setTextSize(1);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.setCursor(20, 170);
-    tft.print(F("System ready for"));
-    tft.setCursor(20, 185);
-    tft.print(F("automatic dispensing"));
+    drawLayout(tft, setupCompleteLayout);
 
     delay(3000);
   }
@@ -1096,28 +1468,137 @@ void handleTubeSetupButton()
   requestTFTUpdate();
 }
 
-void showMainMenu()
+bool isNightTime()
 {
-  tft.fillScreen(ST77XX_BLACK);
-  drawHeader();
+  uint8_t hour = rtctime.hour();
+  if (NIGHT_START_HOUR > NIGHT_END_HOUR)
+    return hour >= NIGHT_START_HOUR || hour < NIGHT_END_HOUR;
+  return hour >= NIGHT_START_HOUR && hour < NIGHT_END_HOUR;
+}
 
-  if (!setupMode && triggerSetupAfterBT && filestat && groupedCount > 0)
+// At night only the clock strip of the header stays lit. The rest of the
+// glass is switched off by the controller, idle mode drops it to 8 colours
+// at a lower frame rate, and showMainMenu() only pushes the header.
+void setNightMode(bool enable)
+{
+  if (enable == nightModeActive)
+    return;
+
+  if (enable)
   {
-    startTubeSetupMode();
-    triggerSetupAfterBT = false;
+    uint16_t firstRow, lastRow;
+    int16_t stripLen = tft.scrollAxisIsScreenY() ? HEADER_HEIGHT : NIGHT_STRIP_WIDTH;
+    if (!tft.panelRowsForScreenSpan(0, stripLen, firstRow, lastRow))
+      return;
+    tft.setPartialArea(firstRow, lastRow);
+    tft.enablePartialMode(true);
+    tft.enableIdleMode(true);
+  }
+  else
+  {
+    tft.enableIdleMode(false);
+    tft.enablePartialMode(false);
   }
 
-  if (setupMode)
+  nightModeActive = enable;
+  Serial.println(enable ? F("Display night mode on") : F("Display night mode off"));
+}
+
+int menuPageCount()
+{
+  return (groupedCount + CARDS_PER_PAGE - 1) / CARDS_PER_PAGE;
+}
+
+void invalidateCardSlots()
+{
+  for (int i = 0; i < CARDS_PER_PAGE; i++)
   {
-    showTubeSetupScreen();
+    cardSlotGroup[i] = -2;
+    cardSlotNext[i] = false;
+  }
+}
+
+void drawPageIndicator()
+{
+  int pages = menuPageCount();
+
+  UiRect area = readRect(&pageIndicatorRect);
+  tft.fillRect(area.x, area.y, area.w, area.h, ST77XX_BLACK);
+  if (pages <= 1)
     return;
+
+  useAnchor(tft, &pageIndicator);
+  tft.print(F("PAGE "));
+  tft.print(currentMenuPage + 1);
+  tft.print(F("/"));
+  tft.print(pages);
+}
+
+// Draws only the cards of the current page. A slot that still shows the
+// same group, as on a minute refresh, is left untouched; a page flip shows
+// new groups in every slot, so it redraws them all but not the rest of the
+// screen.
+void drawSchedulePage()
+{
+  int first = currentMenuPage * CARDS_PER_PAGE;
+
+  for (int slot = 0; slot < CARDS_PER_PAGE; slot++)
+  {
+    UiRect card = readRect(&cardSlotRects[slot]);
+    int orderIndex = first + slot;
+    int8_t group = orderIndex < groupedCount ? scheduleOrder[orderIndex] : -1;
+    bool isNext = group != -1 && group == nextScheduleIndex;
+
+    if (cardSlotGroup[slot] == group && cardSlotNext[slot] == isNext)
+      continue;
+
+    if (cardSlotGroup[slot] != -1)
+      tft.fillRect(card.x, card.y, card.w, card.h, ST77XX_BLACK);
+
+    if (group != -1)
+      drawGroupedMedicationCard(card.x, card.y, card.w, card.h, groupedSchedules[group], isNext);
+
+    cardSlotGroup[slot] = group;
+    cardSlotNext[slot] = isNext;
   }
 
-  if (checkMedicationTime() && !showNotification)
+  drawPageIndicator();
+}
+
+void showNextMenuPage()
+{
+  int pages = menuPageCount();
+  if (pages <= 1)
+    return;
+
+  currentMenuPage = (currentMenuPage + 1) % pages;
+  lastMenuUpdate = millis();
+
+  Serial.print(F("Schedule page "));
+  Serial.print(currentMenuPage + 1);
+  Serial.print(F(" of "));
+  Serial.println(pages);
+
+  invalidateDisplay(RENDER_CARDS);
+}
+
+void showMainMenu()
+{
+  if (nightModeActive)
   {
-    showNotification = true;
-    notificationStartTime = millis();
-    lastCountdownValue = -1; // Reset countdown tracking for fresh draw
+    drawHeader(); // Only the clock strip is on the glass in partial mode
+    invalidateCardSlots();
+    return;
+  }
+
+  tft.fillScreen(ST77XX_BLACK);
+  invalidateCardSlots();
+  drawHeader();
+
+  if (setupMode)
+  {
+    showTubeSetupScreen();
+    return;
   }
 
   if (showNotification)
@@ -1126,59 +1607,54 @@ void showMainMenu()
     return;
   }
 
-  int contentY = 40;
-
   if (!filestat || groupedCount == 0)
   {
-    tft.setTextSize(2);
-    tft.setTextColor(ST77XX_RED);
-    tft.setCursor(50, contentY + 50);
-    tft.print(F("NO SCHEDULE DATA"));
-
-    tft.setTextSize(1);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.setCursor(50, contentY + 80);
-    tft.print(F("Please load medication"));
-    tft.setCursor(50, contentY + 95);
-    tft.print(F("schedule via app"));
+    drawLayout(tft, noScheduleLayout);
     return;
   }
 
-  int nextMedIndex = findNextMedication();
+  drawLayout(tft, scheduleTitleLayout);
 
-  tft.setTextSize(1);
-  tft.setTextColor(ST77XX_CYAN);
-  tft.setCursor(10, contentY + 5);
-  tft.print(F("MEDICATION SCHEDULE"));
+  for (int i = 0; i < CARDS_PER_PAGE; i++)
+    cardSlotGroup[i] = -1; // Screen was just cleared
+  drawSchedulePage();
 
-  int cardY = contentY + 25;
-  int cardsShown = 0;
+  useAnchor(tft, &scheduleTotals);
+  tft.print(F("Total schedules: "));
+  tft.print(groupedCount);
+  tft.print(F(" ("));
+  tft.print(scheduleCount);
+  tft.print(F(" doses)"));
+}
 
-  if (nextMedIndex != -1)
+// Draws whatever the queued events invalidated. Only reads state: every
+// mode switch, notification and page change is decided in loop() first.
+void renderFrame(uint8_t events)
+{
+  if ((events & RENDER_FULL) || (nightModeActive && (events & RENDER_HEADER)))
   {
-    drawGroupedMedicationCard(10, cardY, 300, 75, groupedSchedules[nextMedIndex], true);
-    cardY += 85;
-    cardsShown++;
+    showMainMenu();
+    return;
   }
 
-  for (int i = 0; i < groupedCount && cardsShown < 3; i++)
+  if (nightModeActive)
+    return;
+
+  if (events & RENDER_HEADER)
+    drawHeader();
+
+  if (setupMode)
+    return;
+
+  if (showNotification)
   {
-    if (i != nextMedIndex)
-    {
-      drawGroupedMedicationCard(10, cardY, 300, 75, groupedSchedules[i], false);
-      cardY += 85;
-      cardsShown++;
-    }
+    if (events & RENDER_COUNTDOWN)
+      drawNotificationCountdown();
+    return;
   }
 
-  tft.setTextSize(1);
-  tft.setTextColor(ST77XX_CYAN);
-  tft.setCursor(10, 260);
-  tft.print(F("Total schedules: "));
-  tft.print(groupedCount);
-  tft.print(F(" ("));
-  tft.print(scheduleCount);
-  tft.print(F(" doses)"));
+  if ((events & RENDER_CARDS) && filestat && groupedCount > 0)
+    drawSchedulePage();
 }
 
 bool checkJsonFile()
@@ -1251,6 +1727,432 @@ bool initSD()
   return false;
 }
 
+// Loads a freshly received data.json and arms tube setup. Shared by the
+// text and framed upload paths.
+bool applyReceivedSchedule(bool saved)
+{
+  if (!saved)
+  {
+    filestat = false;
+    Serial.println(F("Failed to save JSON to SD."));
+    requestTFTUpdate();
+    return false;
+  }
+
+  // finishStreamingSave() has closed and renamed the file; a load that
+  // still fails gets retried below rather than waited out up front
+  bool loaded = false;
+  for (int attempt = 1; attempt <= 3; attempt++)
+  {
+    loaded = loadScheduleData();
+    if (loaded)
+    {
+      Serial.print(F("Schedule loaded successfully after BT transfer (try "));
+      Serial.print(attempt);
+      Serial.println(F(")."));
+      currentTubeSetup = 0;
+      setupMode = false;
+      triggerSetupAfterBT = true;
+      setupTubeMask = 0xFF;
+      break;
+    }
+    else
+    {
+      Serial.print(F("Schedule load failed after BT transfer (try "));
+      Serial.print(attempt);
+      Serial.println(F("). Retrying..."));
+      delay(500);
+    }
+  }
+  filestat = loaded;
+  requestTFTUpdate();
+  return loaded;
+}
+
+// Link went quiet: keep data.tmp and the map for a later BEGIN
+void suspendLinkSession()
+{
+  if (streamingActive)
+  {
+    saveLinkMap();
+    endStreamingSave();
+  }
+  linkSession = false;
+  receiving = false;
+}
+
+// Sender gave up or the file failed its check: nothing worth resuming
+void discardLinkUpload()
+{
+  if (streamingActive)
+  {
+    endStreamingSave();
+  }
+  selectSD();
+  SD.remove("data.tmp");
+  SD.remove(LINK_MAP_FILE);
+  deselectAll();
+  linkSession = false;
+  receiving = false;
+}
+
+void sendLinkResume()
+{
+  LinkResume resume;
+  resume.offset = (uint32_t)linkExpected * linkMap.chunkSize;
+  if (resume.offset > linkMap.fileSize)
+    resume.offset = linkMap.fileSize;
+  memcpy(resume.chunks, linkMap.chunks, sizeof(resume.chunks));
+  linkSend(Serial1, LINK_FRAME_ACK, linkExpected, (const uint8_t *)&resume, sizeof(resume));
+}
+
+void sendLinkStatus(uint8_t status)
+{
+  uint16_t fingerprint = scheduleFingerprint(schedules, scheduleCount);
+  uint8_t payload[3] = {status, (uint8_t)(fingerprint & 0xFF), (uint8_t)(fingerprint >> 8)};
+  linkSend(Serial1, LINK_FRAME_DONE, linkExpected, payload, sizeof(payload));
+}
+
+bool saveScheduleBinary()
+{
+  StageScope stage(STAGE_SAVE);
+  if (sdBusy)
+    return false;
+  sdBusy = true;
+  selectSD();
+
+  File f = SD.open(SCHEDULE_NEW_FILE, O_WRITE | O_CREAT | O_TRUNC);
+  bool saved = false;
+  if (f)
+  {
+    scheduleEncode(f, schedules, scheduleCount);
+    saved = f.sync();
+    f.close();
+  }
+  if (saved)
+  {
+    if (SD.exists(SCHEDULE_BIN_FILE))
+      SD.remove(SCHEDULE_BIN_FILE);
+    saved = SD.rename(SCHEDULE_NEW_FILE, SCHEDULE_BIN_FILE);
+    if (saved && SD.exists(SCHEDULE_JSON_FILE))
+      SD.remove(SCHEDULE_JSON_FILE);
+  }
+
+  deselectAll();
+  sdBusy = false;
+  Serial.println(saved ? F("Edited schedule saved") : F("Edited schedule: save failed"));
+  return saved;
+}
+
+// Regroups once per edit batch instead of once per edit, then persists.
+// Only tubes whose medication or amount changed go through setup again.
+bool commitScheduleEdits()
+{
+  stageEnd(STAGE_RECEIVE);
+  stageBegin(STAGE_REGROUP);
+  groupMedicationsByTime();
+  buildScheduleOrder();
+  updateInventoryUse();
+  updateDoseTable();
+  stageEnd(STAGE_REGROUP);
+
+  scheduleEdited = false;
+  lastDeltaSeq = 0xFFFF;
+  filestat = scheduleCount > 0;
+  if (refillMask)
+  {
+    currentTubeSetup = 0;
+    setupTubeMask = refillMask;
+    triggerSetupAfterBT = true;
+    refillMask = 0;
+  }
+  requestTFTUpdate();
+  return saveScheduleBinary();
+}
+
+// A batch is all or nothing: only END saves it. Edits already applied
+// are undone by reloading the saved schedule, which is what the batch's
+// BASE quoted, whether the batch was rejected or never saw its END.
+// Reloading keeps no second copy of schedules[] in SRAM.
+void undoScheduleEdits()
+{
+  if (scheduleEdited)
+  {
+    scheduleEdited = false;
+    refillMask = 0;
+    if (!loadScheduleData())
+    {
+      // No saved schedule (the batch started from an empty one) or an
+      // unreadable card: an empty table beats a half-edited one
+      scheduleCount = 0;
+      groupMedicationsByTime();
+      buildScheduleOrder();
+      updateDoseTable();
+    }
+    filestat = scheduleCount > 0;
+    requestTFTUpdate();
+    Serial.println(F("Schedule edits undone"));
+  }
+  lastDeltaSeq = 0xFFFF;
+  stageEnd(STAGE_RECEIVE);
+}
+
+void rejectScheduleEdits(uint8_t status)
+{
+  undoScheduleEdits();
+  sendLinkStatus(status);
+}
+
+void handleDeltaFrame(const LinkFrame &frame)
+{
+  if (receiving)
+    return;                            // An upload owns the schedule right now
+
+  if (frame.seq == lastDeltaSeq)
+  {
+    linkSend(Serial1, LINK_FRAME_ACK, lastDeltaSeq + 1);   // Our ACK was lost
+    return;
+  }
+  if (frame.seq == 0 && scheduleEdited)
+  {
+    undoScheduleEdits();               // Previous batch never saw its END
+  }
+  else if (frame.seq != (uint16_t)(lastDeltaSeq + 1))
+  {
+    linkSend(Serial1, LINK_FRAME_NAK, lastDeltaSeq + 1);
+    return;
+  }
+
+  if (frame.seq == 0)
+  {
+    stageBegin(STAGE_RECEIVE);
+  }
+
+  ScheduleDelta delta;
+  if (!scheduleReadDelta(frame.payload, frame.len, delta) ||
+      (frame.seq == 0) != (delta.op == SCHEDULE_OP_BASE))
+  {
+    rejectScheduleEdits(LINK_STATUS_REJECTED);
+    return;
+  }
+  if (delta.op == SCHEDULE_OP_BASE && delta.minute != scheduleFingerprint(schedules, scheduleCount))
+  {
+    Serial.println(F("Schedule edit: app has a different schedule"));
+    rejectScheduleEdits(LINK_STATUS_STALE);
+    return;
+  }
+
+  uint8_t result = scheduleApplyDelta(delta, schedules, scheduleCount, MAX_SCHEDULES);
+  if (result != SCHEDULE_DELTA_OK && result != SCHEDULE_DELTA_REFILL)
+  {
+    Serial.print(F("Schedule edit rejected: "));
+    Serial.println(result);
+    rejectScheduleEdits(LINK_STATUS_REJECTED);
+    return;
+  }
+  if (result == SCHEDULE_DELTA_REFILL)
+  {
+    int tube = tubeIndexOf(delta.tube);
+    if (tube >= 0)
+      refillMask |= 1 << tube;
+  }
+
+  lastDeltaSeq = frame.seq;
+  scheduleEdited = true;
+  lastEditAt = millis();
+  linkSend(Serial1, LINK_FRAME_ACK, frame.seq + 1);
+}
+
+void handleLinkFrame(const LinkFrame &frame)
+{
+  if (frame.type == LINK_FRAME_BEGIN)
+  {
+    if (frame.len < 6)
+      return;
+
+    uint32_t fileSize;
+    uint16_t fileCrc;
+    memcpy(&fileSize, frame.payload, 4);
+    memcpy(&fileCrc, frame.payload + 4, 2);
+    uint8_t chunkSize = frame.len >= 7 ? frame.payload[6] : LINK_MAX_PAYLOAD;
+
+    if (chunkSize == 0 || chunkSize > LINK_MAX_PAYLOAD || fileSize > (uint32_t)LINK_MAX_CHUNKS * chunkSize)
+    {
+      sendLinkStatus(LINK_STATUS_BAD_FILE);
+      return;
+    }
+
+    if (scheduleEdited)
+    {
+      undoScheduleEdits();
+    }
+
+    if (linkSession)
+    {
+      // Our answer to the first BEGIN was lost; say the same thing again
+      if (linkMapMatches(linkMap, fileSize, fileCrc, chunkSize))
+      {
+        sendLinkResume();
+        return;
+      }
+      discardLinkUpload();
+    }
+    else if (receiving)
+    {
+      return;                          // Text upload in progress
+    }
+
+    stageBegin(STAGE_RECEIVE);
+    LinkResumeMap stored;
+    bool resume = loadLinkMap(stored) && linkMapMatches(stored, fileSize, fileCrc, chunkSize);
+
+    if (!startStreamingSave(resume))
+    {
+      sendLinkStatus(LINK_STATUS_SD_ERROR);
+      return;
+    }
+
+    if (resume)
+    {
+      linkMap = stored;
+    }
+    else
+    {
+      linkMapClear(linkMap, fileSize, fileCrc, chunkSize);
+      if (!sizeStreamingFile(fileSize) || !saveLinkMap())
+      {
+        sendLinkStatus(LINK_STATUS_SD_ERROR);
+        discardLinkUpload();
+        return;
+      }
+    }
+
+    linkExpected = linkMapFirstMissing(linkMap);
+    linkNakSent = false;
+    linkSinceSave = 0;
+    linkSession = true;
+    receiving = true;
+    receiveStartTime = millis();
+    Serial.print(resume ? F("Framed upload resumed at chunk ") : F("Framed upload started, chunks: "));
+    Serial.println(resume ? linkExpected : linkMapChunkCount(linkMap));
+    sendLinkResume();
+    return;
+  }
+
+  if (frame.type == LINK_FRAME_DELTA)
+  {
+    handleDeltaFrame(frame);
+    return;
+  }
+
+  if (!linkSession)
+  {
+    // END of an edit batch, or a repeated END after either kind of update
+    if (frame.type == LINK_FRAME_END && !receiving)
+    {
+      uint8_t status = LINK_STATUS_OK;
+      if (scheduleEdited && !commitScheduleEdits())
+        status = LINK_STATUS_SD_ERROR;
+      lastDeltaSeq = 0xFFFF;
+      sendLinkStatus(status);
+    }
+    return;
+  }
+
+  switch (frame.type)
+  {
+  case LINK_FRAME_DATA:
+  {
+    uint16_t chunkCount = linkMapChunkCount(linkMap);
+    if (frame.seq >= chunkCount)
+      return;
+
+    uint32_t offset = (uint32_t)frame.seq * linkMap.chunkSize;
+    uint32_t left = linkMap.fileSize - offset;
+    if (frame.len != (left < linkMap.chunkSize ? left : linkMap.chunkSize))
+    {
+      sendLinkStatus(LINK_STATUS_BAD_FILE);
+      discardLinkUpload();
+      return;
+    }
+
+    if (!linkMapHas(linkMap, frame.seq))
+    {
+      if (!writeStreamingAt(offset, frame.payload, frame.len))
+      {
+        sendLinkStatus(LINK_STATUS_SD_ERROR);
+        suspendLinkSession();
+        return;
+      }
+      linkMapMark(linkMap, frame.seq);
+      if (++linkSinceSave >= LINK_MAP_SAVE_EVERY)
+      {
+        saveLinkMap();
+      }
+    }
+
+    uint16_t firstMissing = linkMapFirstMissing(linkMap, linkExpected);
+    if (firstMissing != linkExpected)
+    {
+      linkExpected = firstMissing;
+      linkNakSent = false;
+    }
+
+    // A chunk beyond the first hole means something went missing; ask
+    // for the hole once per gap rather than on every later frame
+    if (frame.seq > linkExpected && !linkNakSent)
+    {
+      linkSend(Serial1, LINK_FRAME_NAK, linkExpected);
+      linkNakSent = true;
+    }
+    else
+    {
+      linkSend(Serial1, LINK_FRAME_ACK, linkExpected);
+    }
+    break;
+  }
+
+  case LINK_FRAME_END:
+  {
+    if (linkExpected < linkMapChunkCount(linkMap))
+    {
+      // Sender thinks it is done but the tail went missing
+      linkSend(Serial1, LINK_FRAME_NAK, linkExpected);
+      return;
+    }
+    stageEnd(STAGE_RECEIVE);
+
+    uint8_t status = LINK_STATUS_OK;
+    if (streamingFileCrc(linkMap.fileSize) != linkMap.fileCrc)
+    {
+      Serial.println(F("Framed upload: file CRC mismatch"));
+      status = LINK_STATUS_BAD_FILE;
+      discardLinkUpload();
+    }
+    else
+    {
+      SD.remove(LINK_MAP_FILE);
+      bool saved = finishStreamingSave();
+      linkSession = false;
+      if (!saved)
+        status = LINK_STATUS_SD_ERROR;
+      else if (!applyReceivedSchedule(saved))
+        status = LINK_STATUS_BAD_SCHEDULE;
+      receiving = false;
+    }
+    Serial.print(F("Framed upload done, status "));
+    Serial.println(status);
+    sendLinkStatus(status);
+    break;
+  }
+
+  case LINK_FRAME_ABORT:
+    Serial.println(F("Framed upload aborted by sender"));
+    discardLinkUpload();
+    break;
+  }
+}
+
 void setup()
 {
   Serial.begin(9600);
@@ -1286,10 +2188,7 @@ void setup()
   tft.init(240, 280);
   tft.setRotation(1);
   tft.fillScreen(ST77XX_BLACK);
-  tft.setTextColor(ST77XX_WHITE);
-  tft.setTextSize(2);
-  tft.setCursor(50, 120);
-  tft.println(F("Loading..."));
+  drawLayout(tft, loadingLayout);
   deselectAll();
   delay(100);
   Serial.println(F("TFT first init done."));
@@ -1308,10 +2207,7 @@ void setup()
     Serial.println(F("Cannot initialize SD card!"));
     selectTFT();
     tft.fillScreen(ST77XX_RED);
-    tft.setTextColor(ST77XX_WHITE);
-    tft.setTextSize(2);
-    tft.setCursor(50, 100);
-    tft.println(F("SD CARD ERROR!"));
+    drawLayout(tft, sdErrorLayout);
     deselectAll();
     while (1);
   }
@@ -1348,9 +2244,13 @@ void setup()
   animatedIntro();
   deselectAll();
 
-  // 4) Load schedule data from SD
+  // 4) Load schedule data from SD (needs the saved stock and dose states)
+  inventoryBegin();
+  doseBegin();
   selectSD();
   filestat = loadScheduleData();
+  selectSD();
+  dispenseLogBegin(SD);
   deselectAll();
 
   // 5) RTC init (I2C, not SPI - no conflict)
@@ -1364,21 +2264,18 @@ void setup()
   deselectAll();
 
   // Servos and motors setup
-  servo1.attach(A0);
-  servo2.attach(A1);
-  servo3.attach(A2);
-  servo4.attach(A3);
+  servo1.attach(SERVO_1);
+  servo2.attach(SERVO_2);
+  servo3.attach(SERVO_3);
+  servo4.attach(SERVO_4);
 
   servo1.write(91);
   servo2.write(91);
   servo3.write(90);
   servo4.write(90);
 
-  pinMode(MOTOR_1, OUTPUT);
-  pinMode(MOTOR_2, OUTPUT);
-  pinMode(MOTOR_3, OUTPUT);
-  pinMode(MOTOR_4, OUTPUT);
   pinMode(Sensor_PIN, INPUT);
+  dispenserBegin(tubeMappings, 4, Sensor_PIN);
   delay(200);
 
   Serial.println(F("Setup complete!"));
@@ -1388,38 +2285,63 @@ void loop()
 {
   rtctime = rtc.now();
 
-  // Event 1: Minute changed - update header time
+  // Event 1: Minute changed - update header time and next-dose ordering
   if (rtctime.minute() != lastDisplayedMinute)
   {
     lastDisplayedMinute = rtctime.minute();
-    requestTFTUpdate();
+    logMissedDoses(doseUpdate(rtctime.unixtime() / 86400UL, rtctime.hour() * 60 + rtctime.minute()));
+    buildScheduleOrder();
+    invalidateDisplay(RENDER_HEADER | RENDER_CARDS);
     Serial.print(F("Time changed to "));
     Serial.print(rtctime.hour());
     Serial.print(F(":"));
     Serial.println(rtctime.minute());
   }
 
-  // Event 2: Check for medication time (notification trigger)
-  if (checkMedicationTime() && !showNotification)
+  // Event 2: A dose is due or still inside its grace window - announce it,
+  // and announce it again a while after an auto-dismiss. A dose restored
+  // from EEPROM as notified was never dismissed since boot: announce it now
+  int dueGroup = doseDueGroup();
+  if (dueGroup >= 0 && !showNotification &&
+      (doseState(dueGroup) == DOSE_PENDING || !notificationDismissed ||
+       millis() - notificationDismissedAt >= DOSE_RENOTIFY_MS))
   {
+    notificationDismissed = false;
+    notifyGroup = dueGroup;
+    buildNotification(dueGroup);
+    doseNotified(dueGroup);
     showNotification = true;
     notificationStartTime = millis();
-    lastCountdownValue = -1; // Reset countdown tracking for fresh draw
+    lastCountdownUpdate = notificationStartTime;
     requestTFTUpdate();
     Serial.println(F("Medication time - notification triggered"));
   }
 
+  if (showNotification && doseState(notifyGroup) != DOSE_NOTIFIED)
+  {
+    showNotification = false;
+    Serial.println(F("Dose window closed - notification removed"));
+  }
+
+  if (showNotification && millis() - notificationStartTime > NOTIFICATION_TIMEOUT)
+  {
+    showNotification = false;
+    notificationDismissed = true;
+    notificationDismissedAt = millis();
+    Serial.println(F("Notification auto-dismissed"));
+  }
+
   // Event 3: Notification state changed
   if (showNotification != lastNotificationState)
   {
     lastNotificationState = showNotification;
-    lastCountdownValue = -1; // Reset on state change
     requestTFTUpdate();
   }
 
-  if (showNotification && (millis() - lastCountdownUpdate > 10000))
+  if (showNotification && (millis() - lastCountdownUpdate > COUNTDOWN_REFRESH))
   {
-    requestTFTUpdate();
+    lastCountdownUpdate = millis();
+    invalidateDisplay(RENDER_COUNTDOWN);
   }
 
   // Event 4: Filestat changed
@@ -1433,35 +2355,113 @@ void loop()
   if (groupedCount != lastGroupedCount)
   {
     lastGroupedCount = groupedCount;
+    if (currentMenuPage >= menuPageCount())
+      currentMenuPage = 0;
+    requestTFTUpdate();
+  }
+
+  // Event 6: New schedule arrived over BT - walk the user through tube setup
+  if (!setupMode && !receiving && triggerSetupAfterBT && filestat && groupedCount > 0)
+  {
+    startTubeSetupMode();
+    triggerSetupAfterBT = false;
     requestTFTUpdate();
   }
 
+  // DROP is polled without blocking: a press acts once, after DROP_DEBOUNCE_MS
+  // in setup and dispensing, after DROP_LONG_PRESS_MS on the schedule view
   if (digitalRead(DROP_BTN) == LOW)
   {
-    delay(50);
-    if (digitalRead(DROP_BTN) == LOW)
+    if (!dropHeld)
+    {
+      dropHeld = true;
+      dropHandled = false;
+      dropPressedAt = millis();
+    }
+
+    unsigned long held = millis() - dropPressedAt;
+    if (!dropHandled && held >= DROP_DEBOUNCE_MS)
     {
       if (setupMode)
       {
+        dropHandled = true;
         selectTFT();
         handleTubeSetupButton();
         deselectAll();
       }
       else if (showNotification)
       {
+        dropHandled = true;
         handleDispensing();
       }
-      delay(500);
+      else if (held >= DROP_LONG_PRESS_MS)
+      {
+        dropHandled = true;
+        if (filestat && !nightModeActive)
+          showNextMenuPage();
+      }
     }
   }
+  else
+  {
+    dropHeld = false;
+  }
+
+  // Event 7: Night mode entered or left
+  bool wantNight = isNightTime() && !setupMode && !showNotification && !triggerSetupAfterBT && !receiving;
+  if (wantNight != nightModeActive)
+  {
+    selectTFT();
+    setNightMode(wantNight);
+    deselectAll();
+    requestTFTUpdate();
+  }
+
+  // Event 8: Paged away from the first page for too long
+  if (currentMenuPage != 0 && millis() - lastMenuUpdate > MENU_PAGE_TIMEOUT)
+  {
+    currentMenuPage = 0;
+    invalidateDisplay(RENDER_CARDS);
+  }
+
+  // Event 9: Dispense records waiting and nothing else needs the SD card
+  if (dispenseLogFlushDue() && !receiving && !setupMode)
+  {
+    flushDispenseLog();
+  }
+
+  // Event 10: Schedule edits stopped arriving without an END
+  if (scheduleEdited && !receiving && millis() - lastEditAt > SCHEDULE_EDIT_IDLE_MS)
+  {
+    undoScheduleEdits();
+  }
 
   static int byteCounter = 0;
   static char tempBuffer[TEMP_BUFFER_SIZE + 1] = "";
   static int bufferPos = 0;
 
+  static LinkFrame linkFrame;
+
   while (Serial1.available())
   {
     char c = Serial1.read();
+    lastByteTime = millis();
+
+    // Framed uploads own the port once BEGIN arrives; while idle every
+    // byte is offered to both parsers, since text never passes a CRC.
+    if (linkSession || !receiving)
+    {
+      if (linkFeed((uint8_t)c, linkFrame))
+      {
+        handleLinkFrame(linkFrame);
+        bufferPos = 0;
+        tempBuffer[0] = '\0';
+        continue;
+      }
+      if (linkSession)
+        continue;
+    }
+
     Serial.print(c);
     if (bufferPos < TEMP_BUFFER_SIZE)
     {
@@ -1470,15 +2470,15 @@ void loop()
     }
 
     byteCounter++;
-    lastByteTime = millis();
 
     if (!receiving)
     {
-      char *startPos = strstr(tempBuffer, "#START#");
+      char *startPos = strstr_P(tempBuffer, PSTR("#START#"));
       if (startPos != nullptr)
       {
         receiving = true;
         receiveStartTime = millis();
+        stageBegin(STAGE_RECEIVE);
 
         int startOffset = startPos - tempBuffer + 7;
         int remainingLen = bufferPos - startOffset;
@@ -1512,9 +2512,10 @@ void loop()
     }
     else
     {
-      char *endPos = strstr(tempBuffer, "#END#");
+      char *endPos = strstr_P(tempBuffer, PSTR("#END#"));
       if (endPos != nullptr)
       {
+        stageEnd(STAGE_RECEIVE);
         int finalLen = endPos - tempBuffer;
         if (finalLen > 0)
         {
@@ -1526,42 +2527,7 @@ void loop()
         bool saved = finishStreamingSave();
         Serial.println(F("\nReceived complete JSON!"));
         Serial1.write('A');
-
-        if (saved)
-        {
-          delay(2000);
-          bool loaded = false;
-          for (int attempt = 1; attempt <= 3; attempt++)
-          {
-            loaded = loadScheduleData();
-            if (loaded)
-            {
-              Serial.print(F("Schedule loaded successfully after BT transfer (try "));
-              Serial.print(attempt);
-              Serial.println(F(")."));
-              currentTubeSetup = 0;
-              setupMode = false;
-              triggerSetupAfterBT = true;
-              break;
-            }
-            else
-            {
-              Serial.print(F("Schedule load failed after BT transfer (try "));
-              Serial.print(attempt);
-              Serial.println(F("). Retrying..."));
-              delay(500);
-            }
-          }
-          filestat = loaded;
-          requestTFTUpdate();
-          delay(2000);
-        }
-        else
-        {
-          filestat = false;
-          Serial.println(F("Failed to save JSON to SD."));
-          requestTFTUpdate();
-        }
+        applyReceivedSchedule(saved);
 
         int endOffset = (endPos - tempBuffer) + 5;
         int remainingLen = bufferPos - endOffset;
@@ -1602,7 +2568,16 @@ void loop()
     }
   }
 
-  if (receiving)
+  if (linkSession)
+  {
+    if (millis() - lastByteTime > LINK_IDLE_MS)
+    {
+      Serial.println(F("Timeout: framed upload went silent, keeping it for resume."));
+      suspendLinkSession();
+      linkReset();
+    }
+  }
+  else if (receiving)
   {
     if (millis() - lastByteTime > 5000)
     {
@@ -1628,11 +2603,16 @@ void loop()
     }
   }
 
-  if (!receiving && tftNeedsUpdate)
+  // Coalesce everything queued since the last frame into one draw pass,
+  // at most RENDER_MAX_FPS times a second.
+  if (!receiving && renderQueue != 0 && millis() - lastFrameTime >= 1000 / RENDER_MAX_FPS)
   {
+    uint8_t events = renderQueue;
+    renderQueue = 0;
+    lastFrameTime = millis();
+
     selectTFT();
-    showMainMenu();
+    renderFrame(events);
     deselectAll();
-    tftNeedsUpdate = false;
   }
 }
@@ -0,0 +1,176 @@
+"""Provisioning many dispensers at once.
+
+Provisioner scans for BLE devices once, matches each target (a device
+name or an address) against the scan, and uploads every device its own
+schedule through dispenser_core.upload(), at most `concurrency` at a
+time on one event loop. Every device gets a DeviceReport with the DONE
+status and fingerprint it acknowledged and how long it waited for a
+slot, for the link, and in total.
+
+With simulate=True no radio is used: every target becomes a
+SIM:<target> address backed by a dispenser_sim.SimulatedDispenser
+configured from sim_options, so a provisioning run can be rehearsed
+offline.
+
+    provisioner = Provisioner(concurrency=8)
+    reports = await provisioner.run([("Dispenser-01", "bed1.json"), ...])
+"""
+
+import asyncio
+import re
+import time
+
+import dispenser_core
+import dispenser_link
+import dispenser_sim
+import schedule_format
+
+RSSI_SUFFIX = re.compile(r" \(RSSI: -?\d+\)$")
+ADDRESS_RE = re.compile(r"^([0-9A-Fa-f]{2}:){5}[0-9A-Fa-f]{2}$|^[0-9A-Fa-f]{8}(-[0-9A-Fa-f]{4}){3}-[0-9A-Fa-f]{12}$")
+
+
+class DeviceReport:
+    """The outcome for one target. status is the device's DONE status
+    (0 once it confirmed the schedule), None if it never answered."""
+
+    def __init__(self, target, source):
+        self.target = target
+        self.source = source
+        self.address = None
+        self.status = None
+        self.fingerprint = None
+        self.error = None
+        self.bytes = 0
+        self.edits = False
+        self.attempts = 0
+        self.resumed_bytes = 0
+        self.queued_s = 0.0          # Waiting for a free slot
+        self.link_s = 0.0            # Connected and transferring, over all attempts
+        self.total_s = 0.0
+        self.link = {}
+
+    @property
+    def ok(self):
+        return self.status == 0
+
+    def as_dict(self):
+        return {
+            "target": self.target,
+            "file": self.source if isinstance(self.source, str) else None,
+            "address": self.address,
+            "ok": self.ok,
+            "status": self.status,
+            "fingerprint": self.fingerprint,
+            "error": self.error,
+            "bytes": self.bytes,
+            "edits": self.edits,
+            "attempts": self.attempts,
+            "resumed_bytes": self.resumed_bytes,
+            "queued_s": round(self.queued_s, 3),
+            "link_s": round(self.link_s, 3),
+            "total_s": round(self.total_s, 3),
+            "link": self.link,
+        }
+
+
+def device_name(scan_name):
+    """The advertised name from a dispenser_core.scan() key."""
+    return RSSI_SUFFIX.sub("", scan_name)
+
+
+class Provisioner:
+    def __init__(self, concurrency=4, scan_timeout=dispenser_core.SCAN_TIMEOUT,
+                 simulate=False, sim_options=None, load=None):
+        self.concurrency = concurrency
+        self.scan_timeout = scan_timeout
+        self.simulate = simulate
+        self.sim_options = sim_options or {}
+        self.load = load or dispenser_core.load_medications
+        self.schedules = {}          # address -> (medications, fingerprint), for edits on the next run
+        self.devices = None          # Advertised name -> address, from the one scan
+        self.limit = None
+        self.on_report = None
+
+    async def scan(self):
+        """Scans once per Provisioner; later calls reuse the result."""
+        if self.devices is None:
+            found = {} if self.simulate else await dispenser_core.scan(self.scan_timeout)
+            self.devices = {device_name(name): address for name, address in found.items()}
+        return self.devices
+
+    def resolve(self, target):
+        """The address to use for target, or None if the scan did not see it."""
+        if self.simulate:
+            address = target if dispenser_core.is_simulated(target) else f"SIM:{target}"
+            if address not in dispenser_core.simulated:
+                options = dict(self.sim_options)
+                options.setdefault("seed", len(dispenser_core.simulated))
+                dispenser_core.simulated[address] = dispenser_sim.SimulatedDispenser(**options)
+            return address
+        if target.startswith(("SIM:", "SERIAL:")):
+            return target
+        devices = self.devices or {}
+        if target in devices:
+            return devices[target]
+        for address in devices.values():
+            if address.lower() == target.lower():
+                return address
+        if ADDRESS_RE.match(target):
+            return target            # An address the scan missed; let the connect decide
+        return None
+
+    async def provision(self, target, source, address=None):
+        """Uploads source (a schedule file, or a medication list) to target."""
+        report = DeviceReport(target, source)
+        started = time.monotonic()
+        if self.limit is None:
+            self.limit = asyncio.Semaphore(self.concurrency)
+        try:
+            medications = self.load(source) if isinstance(source, str) else source
+            data = schedule_format.encode(medications)
+            report.bytes = len(data)
+            report.address = address or self.resolve(target)
+            if report.address is None:
+                raise Exception("not found in the scan")
+
+            async with self.limit:
+                report.queued_s = time.monotonic() - started
+                try:
+                    result = await dispenser_core.upload(report.address, data, medications, self.schedules)
+                    report.status = 0
+                    report.fingerprint = result.fingerprint
+                    report.edits = result.edits
+                    report.attempts = result.attempts
+                    report.resumed_bytes = result.resumed_bytes
+                    report.link = result.stats
+                except dispenser_link.LinkError as e:
+                    report.status = e.status
+                    report.error = str(e)
+                finally:
+                    report.link_s = time.monotonic() - started - report.queued_s
+        except Exception as e:
+            report.error = str(e)
+        report.total_s = time.monotonic() - started
+        if self.on_report:
+            self.on_report(report)
+        return report
+
+    async def run(self, jobs, on_report=None):
+        """Provisions every (target, source) in jobs; reports come back in order."""
+        self.on_report = on_report
+        await self.scan()
+        return await asyncio.gather(*(self.provision(target, source) for target, source in jobs))
+
+
+def summarize(reports, elapsed):
+    ok = sum(1 for r in reports if r.ok)
+    times = sorted(r.total_s for r in reports if r.ok)
+    return {
+        "devices": len(reports),
+        "ok": ok,
+        "failed": len(reports) - ok,
+        "elapsed_s": round(elapsed, 3),
+        "devices_per_min": round(ok * 60 / elapsed, 1) if elapsed > 0 else None,
+        "median_device_s": round(times[len(times) // 2], 3) if times else None,
+        "slowest_device_s": round(times[-1], 3) if times else None,
+    }
@@ -0,0 +1,214 @@
+"""Compact binary schedule understood by the dispenser (data.bin).
+
+Mirrors include/ScheduleFormat.h. A medication list in the app's JSON
+shape ({"tube", "type", "amount", "time_to_take": [{"time", "dosage"}]})
+encodes to a few bytes per dose instead of the pretty-printed JSON the
+firmware would otherwise have to parse with ArduinoJson:
+
+    b"PDS" version medCount
+    per medication: tube(coded) amount(LE16) nameLen name timeCount
+    per time:       minute(LE16) dosage(coded)
+
+A coded byte below TEXT_FLAG is a number ("tube<n>", "<n> tablet(s)");
+with TEXT_FLAG set its low 7 bits give the length of the text that
+follows. Text is cut to what the firmware's MedicationTime can hold.
+"""
+
+import re
+import struct
+
+MAGIC = b"PDS"
+VERSION = 1
+TEXT_FLAG = 0x80
+
+# MedicationTime field sizes minus the terminator
+TUBE_MAX = 7
+NAME_MAX = 23
+DOSAGE_MAX = 15
+
+TUBE_RE = re.compile(r"^tube([1-9][0-9]?)$")
+DOSAGE_RE = re.compile(r"^([1-9])\s+tablets?$")
+
+
+def _text(value, limit):
+    raw = value.encode("utf-8")[:limit]
+    # Never leave half a UTF-8 sequence at the cut
+    return raw.decode("utf-8", "ignore").encode("utf-8")
+
+
+def _coded(value, pattern, limit):
+    match = pattern.match(value)
+    if match:
+        return bytes([int(match.group(1))])
+    raw = _text(value, limit)
+    return bytes([TEXT_FLAG | len(raw)]) + raw
+
+
+def _minute(time_text):
+    hours, minutes = time_text.strip().split(":")
+    minute = int(hours) * 60 + int(minutes)
+    if not 0 <= minute < 1440:
+        raise ValueError(f"time out of range: {time_text}")
+    return minute
+
+
+def encode(medications):
+    if len(medications) > 255:
+        raise ValueError("too many medications")
+    out = bytearray(MAGIC)
+    out += bytes([VERSION, len(medications)])
+    for med in medications:
+        times = med.get("time_to_take", [])
+        if len(times) > 255:
+            raise ValueError("too many times for one medication")
+        name = _text(str(med.get("type", "")), NAME_MAX)
+        out += _coded(str(med.get("tube", "")), TUBE_RE, TUBE_MAX)
+        out += struct.pack("<HB", max(0, min(int(med.get("amount", 0)), 0xFFFF)), len(name))
+        out += name
+        out += bytes([len(times)])
+        for entry in times:
+            out += struct.pack("<H", _minute(entry.get("time", "")))
+            out += _coded(str(entry.get("dosage", "")).strip(), DOSAGE_RE, DOSAGE_MAX)
+    return bytes(out)
+
+
+def _read_coded(data, pos, number_format):
+    code = data[pos]
+    pos += 1
+    if code & TEXT_FLAG:
+        length = code & ~TEXT_FLAG
+        return data[pos:pos + length].decode("utf-8"), pos + length
+    return number_format(code), pos
+
+
+def decode(data):
+    """Inverse of encode(), as the firmware sees it; for checks and tooling."""
+    if data[:3] != MAGIC or data[3] != VERSION:
+        raise ValueError("not a binary schedule")
+    pos = 5
+    medications = []
+    for _ in range(data[4]):
+        tube, pos = _read_coded(data, pos, lambda n: f"tube{n}")
+        amount, name_len = struct.unpack_from("<HB", data, pos)
+        pos += 3
+        name = data[pos:pos + name_len].decode("utf-8")
+        pos += name_len
+        count = data[pos]
+        pos += 1
+        times = []
+        for _ in range(count):
+            (minute,) = struct.unpack_from("<H", data, pos)
+            dosage, pos = _read_coded(data, pos + 2, lambda n: f"{n} tablet" if n == 1 else f"{n} tablets")
+            times.append({"time": f"{minute // 60:02d}:{minute % 60:02d}", "dosage": dosage})
+        medications.append({"tube": tube, "type": name, "amount": amount, "time_to_take": times})
+    return medications
+
+
+# Delta operations (SCHEDULE_OP_* in ScheduleFormat.h). A medication is
+# identified by its tube; the firmware keeps one medication per tube.
+OP_BASE = 0
+OP_ADD_TIME = 1
+OP_REMOVE_TIME = 2
+OP_MODIFY_TIME = 3
+OP_REMOVE_MED = 4
+OP_MODIFY_MED = 5
+
+
+def _tube(tube):
+    return _coded(str(tube), TUBE_RE, TUBE_MAX)
+
+
+def _medication(amount, name):
+    raw = _text(str(name), NAME_MAX)
+    return struct.pack("<HB", max(0, min(int(amount), 0xFFFF)), len(raw)) + raw
+
+
+def _dosage(dosage):
+    return _coded(str(dosage).strip(), DOSAGE_RE, DOSAGE_MAX)
+
+
+def op_base(fingerprint):
+    return struct.pack("<BH", OP_BASE, fingerprint)
+
+
+def op_add_time(tube, amount, name, time_text, dosage):
+    return (bytes([OP_ADD_TIME]) + _tube(tube) + _medication(amount, name)
+            + struct.pack("<H", _minute(time_text)) + _dosage(dosage))
+
+
+def op_remove_time(tube, time_text):
+    return bytes([OP_REMOVE_TIME]) + _tube(tube) + struct.pack("<H", _minute(time_text))
+
+
+def op_modify_time(tube, time_text, new_time_text, dosage):
+    return (bytes([OP_MODIFY_TIME]) + _tube(tube)
+            + struct.pack("<HH", _minute(time_text), _minute(new_time_text)) + _dosage(dosage))
+
+
+def op_remove_med(tube):
+    return bytes([OP_REMOVE_MED]) + _tube(tube)
+
+
+def op_modify_med(tube, amount, name):
+    return bytes([OP_MODIFY_MED]) + _tube(tube) + _medication(amount, name)
+
+
+def _by_tube(medications):
+    tubes = {}
+    for med in medications:
+        tube = str(med.get("tube", ""))
+        if tube in tubes:
+            return None
+        times = {}
+        for entry in med.get("time_to_take", []):
+            minute = _minute(entry.get("time", ""))
+            if minute in times:
+                return None
+            times[minute] = str(entry.get("dosage", "")).strip()
+        tubes[tube] = (str(med.get("type", "")), int(med.get("amount", 0)), times)
+    return tubes
+
+
+def _time_text(minute):
+    return f"{minute // 60:02d}:{minute % 60:02d}"
+
+
+def diff(old, new):
+    """Edit operations turning medication list old into new, without OP_BASE.
+
+    Returns None when the lists can't be expressed as per-tube edits
+    (a tube used twice, a time repeated); send the whole schedule then.
+    """
+    before = _by_tube(old)
+    after = _by_tube(new)
+    if before is None or after is None:
+        return None
+
+    ops = []
+    for tube in before:
+        if tube not in after:
+            ops.append(op_remove_med(tube))
+
+    for tube, (name, amount, times) in after.items():
+        if tube not in before:
+            for minute, dosage in sorted(times.items()):
+                ops.append(op_add_time(tube, amount, name, _time_text(minute), dosage))
+            continue
+
+        old_name, old_amount, old_times = before[tube]
+        if (_text(name, NAME_MAX), amount) != (_text(old_name, NAME_MAX), old_amount):
+            ops.append(op_modify_med(tube, amount, name))
+
+        removed = sorted(m for m in old_times if m not in times)
+        added = sorted(m for m in times if m not in old_times)
+        # A moved dose is one modify rather than a remove and an add
+        for old_minute, new_minute in zip(removed, added):
+            ops.append(op_modify_time(tube, _time_text(old_minute), _time_text(new_minute), times[new_minute]))
+        for old_minute in removed[len(added):]:
+            ops.append(op_remove_time(tube, _time_text(old_minute)))
+        for new_minute in added[len(removed):]:
+            ops.append(op_add_time(tube, amount, name, _time_text(new_minute), times[new_minute]))
+        for minute in sorted(set(times) & set(old_times)):
+            if times[minute] != old_times[minute]:
+                ops.append(op_modify_time(tube, _time_text(minute), _time_text(minute), times[minute]))
+    return ops
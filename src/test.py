@@ -9,6 +9,9 @@ import time
 from tkinter import Canvas
 import math
 import json
+import dispenser_core
+import dispenser_link
+import schedule_format
 import tkinter as tk
 
 try:
@@ -33,6 +36,7 @@ class ResponsiveAutoPillDispenserApp:
         # Variables
         self.ble_var = ttk.StringVar()
         self.ble_devices = {}  # Store device name -> address mapping
+        self.device_schedules = {}  # address -> (medications, fingerprint) last confirmed by the device
         self.file_var = ttk.StringVar()
         self.upload_mode = ttk.StringVar(value="json")
         self.is_sending = False
@@ -725,26 +729,7 @@ class ResponsiveAutoPillDispenserApp:
     def process_json_file(self, path):
         """Process JSON file with validation"""
         try:
-            with open(path, 'r', encoding='utf-8') as f:
-                data = json.load(f)
-                
-            # Validate format
-            if not isinstance(data, list):
-                raise ValueError("JSON must contain a list of medications")
-                
-            # Validate each medication
-            for med in data:
-                required_fields = ['tube', 'type', 'amount', 'time_to_take']
-                for field in required_fields:
-                    if field not in med:
-                        raise ValueError(f"Missing required field: {field}")
-                        
-                if not isinstance(med['time_to_take'], list):
-                    raise ValueError("time_to_take must be a list")
-                    
-                for schedule in med['time_to_take']:
-                    if 'time' not in schedule or 'dosage' not in schedule:
-                        raise ValueError("Each schedule must have 'time' and 'dosage'")
+            data = dispenser_core.load_medications(path)
             
             # Store data
             self.medication_data = data
@@ -752,9 +737,7 @@ class ResponsiveAutoPillDispenserApp:
             filename = os.path.basename(path)
             
             # Calculate stats
-            total_medications = len(data)
-            total_tubes = len(set(med['tube'] for med in data))
-            total_schedules = sum(len(med['time_to_take']) for med in data)
+            total_medications, total_tubes, total_schedules = dispenser_core.summarize(data)
             
             # Update UI
             self.file_label.configure(text=f"📄 {filename}")
@@ -862,35 +845,26 @@ class ResponsiveAutoPillDispenserApp:
         def submit_task():
             try:
                 if mode == "json":
-                    data = "#START#" + json.dumps(self.medication_data, indent=2) + "#END#"
+                    # Binary schedule: a few bytes per dose, no JSON parsing on the device
+                    data = schedule_format.encode(self.medication_data)
                 else:
-                    data = self.qr_data
+                    # The framed link carries its own length, so the text markers go
+                    data = self.qr_data.replace("#START#", "").replace("#END#", "")
                     
-                # Simulate submission steps
-                steps = [
-                    "🔍 Validating data...",
-                    f"📶 Connecting to {device_name}...",
-                    "📡 Transmitting...",
-                    "⚙️ Configuring...",
-                    "✅ Complete!"
-                ]
-                
-                for step in steps:
-                    time.sleep(0.8)
-                    self.app.after(0, lambda s=step: self.status_label.configure(text=s))
-                
-                CHUNK_SIZE = 20  # BLE typically has smaller MTU
-                CHUNK_DELAY = 0.2  # Slightly longer delay for BLE
-                data_bytes = data.encode('utf-8')
-                total_chunks = (len(data_bytes) + CHUNK_SIZE - 1) // CHUNK_SIZE
+                def status(text):
+                    self.app.after(0, lambda: self.status_label.configure(text=text))
+
+                data_bytes = data if isinstance(data, bytes) else data.encode('utf-8')
+                total_chunks = (len(data_bytes) + dispenser_link.MAX_PAYLOAD - 1) // dispenser_link.MAX_PAYLOAD
                 
                 # Get device address from stored mapping
                 device_address = self.ble_devices.get(device_name)
                 if not device_address:
                     raise Exception(f"Device address not found for {device_name}")
                 
-                # Run BLE transmission in async context
-                asyncio.run(self.send_ble_data(device_address, data_bytes, CHUNK_SIZE, CHUNK_DELAY, total_chunks))
+                status(f"📶 Connecting to {device_name}...")
+                medications = self.medication_data if mode == "json" else None
+                asyncio.run(self.send_ble_data(device_address, data_bytes, total_chunks, medications))
                 
                 self.app.after(0, lambda: [
                     self.show_notification("Successfully submitted to dispenser!", "success"),
@@ -911,48 +885,46 @@ class ResponsiveAutoPillDispenserApp:
                 
         threading.Thread(target=submit_task, daemon=True).start()
 
-    async def send_ble_data(self, device_address, data_bytes, chunk_size, chunk_delay, total_chunks):
-        """Send data via BLE connection with improved error handling"""
-        if device_address.startswith("SIM:") or device_address == "00:00:00:00:00":
-            # Simulate BLE transmission
-            for i in range(0, len(data_bytes), chunk_size):
-                chunk_num = (i // chunk_size) + 1
-                chunk_data = data_bytes[i:i+chunk_size]
-                
-                progress_text = f"📦 Simulating chunk {chunk_num}/{total_chunks} ({len(chunk_data)} bytes)"
-                self.app.after(0, lambda t=progress_text: self.chunk_progress_label.configure(text=t))
-                
-                await asyncio.sleep(chunk_delay)
-            return
-        
-        # Standard BLE service UUID for data transmission
-        SERVICE_UUID = "12345678-1234-1234-1234-123456789abc"
-        CHARACTERISTIC_UUID = "87654321-4321-4321-4321-cba987654321"
-        
+    async def send_ble_data(self, device_address, data_bytes, total_chunks, medications=None):
+        """Send data using the framed, windowed upload protocol (see dispenser_core.upload).
+
+        When the device last confirmed a schedule we know, only the edits
+        between that and medications go out; the full upload is the fallback.
+        """
+        def report(sent, total):
+            chunk_num = (sent + dispenser_link.MAX_PAYLOAD - 1) // dispenser_link.MAX_PAYLOAD
+            progress_text = f"📦 Chunk {chunk_num}/{total_chunks} acknowledged ({sent}/{total} bytes)"
+            self.app.after(0, lambda t=progress_text: self.chunk_progress_label.configure(text=t))
+
+        def report_edit(done, total):
+            progress_text = f"✏️ Edit {done}/{total} applied"
+            self.app.after(0, lambda t=progress_text: self.chunk_progress_label.configure(text=t))
+
+        def report_retry(attempt, attempts, error):
+            retry_text = f"🔄 Link lost, reconnecting to resume ({attempt}/{attempts - 1})..."
+            self.app.after(0, lambda t=retry_text: self.chunk_progress_label.configure(text=t))
+
         try:
-            async with BleakClient(device_address, timeout=10.0) as client:
-                if not client.is_connected:
-                    raise Exception("Failed to connect to BLE device")
-                
-                await asyncio.sleep(1)  # Give device time to initialize
-                
-                for i in range(0, len(data_bytes), chunk_size):
-                    chunk_num = (i // chunk_size) + 1
-                    chunk_data = data_bytes[i:i+chunk_size]
-                    
-                    progress_text = f"📦 Sending chunk {chunk_num}/{total_chunks} ({len(chunk_data)} bytes)"
-                    self.app.after(0, lambda t=progress_text: self.chunk_progress_label.configure(text=t))
-                    
-                    # Send chunk via BLE characteristic
-                    await client.write_gatt_char(CHARACTERISTIC_UUID, chunk_data)
-                    await asyncio.sleep(chunk_delay)
-                
-                await asyncio.sleep(0.5)
-                
-        except Exception as e:
-            raise Exception(f"BLE transmission failed: {str(e)}")
+            result = await dispenser_core.upload(device_address, data_bytes, medications, self.device_schedules,
+                                                 progress=report, edit_progress=report_edit, on_retry=report_retry)
+        except dispenser_link.LinkError as e:
+            if e.status is not None:
+                raise Exception(f"Dispenser rejected the upload: {str(e)}")
+            raise
+        if result.resumed_bytes:
+            print(f"Upload resumed: {result.resumed_bytes} bytes were already on the device")
+        if result.stats:
+            print(f"Upload stats: {result.stats}")
 
     def get_ble_devices(self):
+        """Get available devices, plus a serial port from DISPENSER_SERIAL if set"""
+        devices = self.scan_devices()
+        serial_path = os.environ.get("DISPENSER_SERIAL")
+        if serial_path:
+            devices = {f"Serial ({serial_path})": f"SERIAL:{serial_path}", **devices}
+        return devices
+
+    def scan_devices(self):
         """Get available BLE devices with improved error handling"""
         if not BLEAK_AVAILABLE:
             messagebox.showerror("BLE Error", "BLE library not available. Please install bleak: pip install bleak")
@@ -1042,21 +1014,7 @@ class ResponsiveAutoPillDispenserApp:
         devices = {}
         
         try:
-            scanner = BleakScanner()
-            
-            # Use shorter timeout to avoid hanging
-            discovered_devices = await asyncio.wait_for(
-                scanner.discover(), 
-                timeout=10.0  # Increased timeout for better device discovery
-            )
-            
-            for device in discovered_devices:
-                device_name = device.name if device.name else f"Unknown Device"
-                if device.address:
-                    # Add RSSI info if available
-                    rssi_info = f" (RSSI: {device.rssi})" if hasattr(device, 'rssi') and device.rssi else ""
-                    full_name = f"{device_name}{rssi_info}"
-                    devices[full_name] = device.address
+            devices = await dispenser_core.scan()
             
             # Add some example devices for testing if no real devices found
             if not devices:
@@ -0,0 +1,170 @@
+/*
+ * Schedule edit batches through the real firmware: src/main.cpp runs on
+ * the emulator's HAL (tools/firmware_emu) and the test plays the app on
+ * the Serial1 pty. Only END saves a batch; one that is cut off, by
+ * silence or by the next batch's BASE, must leave the schedule and
+ * data.bin exactly as they were.
+ *
+ *   pio test -e native_emu_test
+ */
+#include <Arduino.h>
+#include <unity.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include "Emulator.h"
+#include "ScheduleFormat.h"
+#include "UploadLink.h"
+#include "../test_schedule_delta/vectors.h"
+
+#define EDIT_IDLE_WAIT_MS 4000       // Past SCHEDULE_EDIT_IDLE_MS in main.cpp
+
+void setup();
+void loop();
+extern MedicationTime schedules[];
+extern int scheduleCount;
+
+static int appFd = -1;
+static char sdDir[] = "/tmp/edit_batch_XXXXXX";
+
+static const DeltaVector &vectorNamed(const char *name)
+{
+  size_t v = 0;
+  while (v + 1 < sizeof(deltaVectors) / sizeof(deltaVectors[0]) && strcmp(deltaVectors[v].name, name) != 0)
+    v++;
+  return deltaVectors[v];
+}
+
+// Runs loop() for ms of firmware time, dropping whatever it answers
+static void runFor(unsigned long ms)
+{
+  unsigned long start = millis();
+  while (millis() - start < ms)
+  {
+    loop();
+    emuSkip(1000);
+    uint8_t reply[64];
+    while (read(appFd, reply, sizeof(reply)) > 0)
+    {
+    }
+  }
+}
+
+static void sendFrame(uint8_t type, uint16_t seq, const uint8_t *payload, uint8_t len)
+{
+  uint8_t frame[LINK_MAX_PAYLOAD + 7];
+  frame[0] = LINK_SOF;
+  frame[1] = type;
+  frame[2] = seq & 0xFF;
+  frame[3] = seq >> 8;
+  frame[4] = len;
+  memcpy(frame + 5, payload, len);
+  uint16_t crc = linkCrc16(0xFFFF, frame + 1, 4 + len);
+  frame[5 + len] = crc & 0xFF;
+  frame[6 + len] = crc >> 8;
+  TEST_ASSERT_EQUAL_INT(7 + len, write(appFd, frame, 7 + len));
+  runFor(20);
+}
+
+// BASE quoting the fingerprint of the app's last DONE, then the
+// vector's edits; no END
+static void sendEdits(uint16_t fingerprint, const DeltaVector &vector)
+{
+  uint8_t base[3] = {SCHEDULE_OP_BASE, (uint8_t)(fingerprint & 0xFF), (uint8_t)(fingerprint >> 8)};
+  sendFrame(LINK_FRAME_DELTA, 0, base, sizeof(base));
+
+  uint16_t seq = 1;
+  for (uint16_t pos = 0; pos < vector.opsLen; pos += 1 + vector.ops[pos])
+    sendFrame(LINK_FRAME_DELTA, seq++, vector.ops + pos + 1, vector.ops[pos]);
+}
+
+static bool writeScheduleFile(const uint8_t *data, size_t len)
+{
+  char path[64];
+  snprintf(path, sizeof(path), "%s/%s", sdDir, SCHEDULE_BIN_FILE);
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(data, 1, len, f) == len;
+  fclose(f);
+  return ok;
+}
+
+static uint16_t scheduleFileFingerprint()
+{
+  char path[64];
+  snprintf(path, sizeof(path), "%s/%s", sdDir, SCHEDULE_BIN_FILE);
+  uint8_t data[1024];
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return 0;
+  size_t len = fread(data, 1, sizeof(data), f);
+  fclose(f);
+  return linkCrc16(0xFFFF, data, len);
+}
+
+void test_batch_without_end_is_undone()
+{
+  const DeltaVector &vector = vectorNamed("remove_med");
+  uint16_t saved = linkCrc16(0xFFFF, vector.before, vector.beforeLen);
+  TEST_ASSERT_EQUAL_HEX16(saved, scheduleFingerprint(schedules, scheduleCount));
+
+  sendEdits(saved, vector);
+  TEST_ASSERT_EQUAL_HEX16(linkCrc16(0xFFFF, vector.after, vector.afterLen),
+                          scheduleFingerprint(schedules, scheduleCount));
+
+  // The link drops: END never comes
+  runFor(EDIT_IDLE_WAIT_MS);
+  TEST_ASSERT_EQUAL_HEX16(saved, scheduleFingerprint(schedules, scheduleCount));
+  TEST_ASSERT_EQUAL_HEX16(saved, scheduleFileFingerprint());
+}
+
+void test_next_base_undoes_unfinished_batch()
+{
+  const DeltaVector &dropped = vectorNamed("remove_time");
+  const DeltaVector &vector = vectorNamed("remove_med");
+  uint16_t saved = linkCrc16(0xFFFF, vector.before, vector.beforeLen);
+
+  sendEdits(saved, dropped);
+  TEST_ASSERT_NOT_EQUAL(saved, scheduleFingerprint(schedules, scheduleCount));
+
+  // The app reconnects and sends a new batch against the saved schedule
+  sendEdits(saved, vector);
+  sendFrame(LINK_FRAME_END, 1 + vector.opCount, NULL, 0);
+
+  uint16_t expected = linkCrc16(0xFFFF, vector.after, vector.afterLen);
+  TEST_ASSERT_EQUAL_HEX16(expected, scheduleFingerprint(schedules, scheduleCount));
+  TEST_ASSERT_EQUAL_HEX16(expected, scheduleFileFingerprint());
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main()
+{
+  if (!mkdtemp(sdDir) || !writeScheduleFile(remove_med_before, sizeof(remove_med_before)))
+    return 1;
+  emuOptions.sdDir = sdDir;
+
+  char path[64];
+  if (!emuOpenPty(path, sizeof(path)))
+    return 1;
+  appFd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  struct termios attrs;
+  tcgetattr(appFd, &attrs);
+  cfmakeraw(&attrs);
+  tcsetattr(appFd, TCSANOW, &attrs);
+
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_batch_without_end_is_undone);
+  RUN_TEST(test_next_base_undoes_unfinished_batch);
+  int failures = UNITY_END();
+
+  close(appFd);
+  emuClosePty();
+  return failures;
+}
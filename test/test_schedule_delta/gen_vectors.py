@@ -0,0 +1,89 @@
+"""Writes vectors.h for test_main.cpp from src/schedule_format.py.
+
+Each vector is a schedule before and after an edit, and the edits
+schedule_format.diff() sends between them, so the test checks the app's
+diff against the firmware's scheduleApplyDelta(). Rerun after changing
+either side's format:
+
+    python test/test_schedule_delta/gen_vectors.py
+"""
+
+import copy
+import json
+import os
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.join(HERE, "..", "..")
+sys.path.insert(0, os.path.join(ROOT, "src"))
+
+import schedule_format  # noqa: E402
+
+
+def med(tube, name, amount, *times):
+    return {"tube": tube, "type": name, "amount": amount,
+            "time_to_take": [{"time": t, "dosage": d} for t, d in times]}
+
+
+def cases():
+    with open(os.path.join(ROOT, "src", "data.json"), "r", encoding="utf-8") as f:
+        base = json.load(f)
+
+    def edited(change):
+        new = copy.deepcopy(base)
+        change(new)
+        return new
+
+    yield "remove_med", base, edited(lambda m: m.pop(0))
+    yield "remove_time", base, edited(lambda m: m[1]["time_to_take"].pop())
+    yield "add_time", base, edited(lambda m: m[1]["time_to_take"].append({"time": "13:15", "dosage": "3 tablets"}))
+    yield "move_time", base, edited(lambda m: m[0]["time_to_take"][0].update(time="21:45"))
+    yield "change_dosage", base, edited(lambda m: m[2]["time_to_take"][0].update(dosage="half a tablet"))
+    yield "modify_med", base, edited(lambda m: m[0].update(type="Acetaminophen", amount=100))
+    yield "add_med", base, edited(lambda m: m.append(med("tube5", "Omeprazole", 28, ("06:45", "1 tablet"))))
+    yield "from_empty", [], [med("tube2", "Vitamin C", 60, ("09:00", "2 tablets"), ("21:00", "1 tablet"))]
+    yield "to_empty", base, []
+
+    def mixed(m):
+        m.pop(2)
+        m[0]["time_to_take"].append({"time": "16:00", "dosage": "2 tablets"})
+        m[1]["time_to_take"][0].update(time="08:30")
+        m[1]["amount"] = 45
+        m.append(med("tube6", "Custom text tube", 10, ("10:10", "5 ml")))
+    yield "mixed", base, edited(mixed)
+
+
+def array(name, data):
+    rows = [", ".join(f"0x{b:02x}" for b in data[i:i + 16]) for i in range(0, len(data), 16)]
+    body = ",\n  ".join(rows) if rows else "0"
+    return f"static const uint8_t {name}[] = {{\n  {body}\n}};\n"
+
+
+def main():
+    out = ["// Generated by gen_vectors.py from src/schedule_format.py; do not edit.",
+           "#ifndef SCHEDULE_DELTA_VECTORS_H", "#define SCHEDULE_DELTA_VECTORS_H", "",
+           "#include <stdint.h>", ""]
+    entries = []
+    for name, old, new in cases():
+        ops = schedule_format.diff(old, new)
+        if ops is None:
+            raise SystemExit(f"{name}: diff() refused the edit")
+        packed = b"".join(bytes([len(op)]) + op for op in ops)
+        out.append(array(f"{name}_before", schedule_format.encode(old)))
+        out.append(array(f"{name}_ops", packed))
+        out.append(array(f"{name}_after", schedule_format.encode(new)))
+        entries.append(f'  {{"{name}", {name}_before, sizeof({name}_before), {name}_ops, '
+                       f'{len(packed)}, {len(ops)}, {name}_after, sizeof({name}_after)}},')
+
+    out += ["struct DeltaVector", "{", "  const char *name;",
+            "  const uint8_t *before;", "  uint16_t beforeLen;",
+            "  const uint8_t *ops;                // Each op prefixed by its length",
+            "  uint16_t opsLen;", "  uint8_t opCount;",
+            "  const uint8_t *after;", "  uint16_t afterLen;", "};", "",
+            "static const DeltaVector deltaVectors[] = {"] + entries + ["};", "", "#endif", ""]
+    with open(os.path.join(HERE, "vectors.h"), "w", encoding="utf-8") as f:
+        f.write("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
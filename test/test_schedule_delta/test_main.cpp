@@ -0,0 +1,141 @@
+/*
+ * Schedule edits: the app's schedule_format.diff() against the firmware's
+ * scheduleApplyDelta(). Each vector in vectors.h (gen_vectors.py) is
+ * decoded, edited with the app's ops and compared with the schedule the
+ * app meant to send, so both sides agree on what an edit batch does.
+ *
+ *   pio test -e native_test
+ */
+#include <Arduino.h>
+#include <unity.h>
+#include "ScheduleFormat.h"
+#include "UploadLink.h"
+#include "vectors.h"
+
+#define TABLE_SIZE 12                // MAX_SCHEDULES in main.cpp
+
+// Stream::timedRead() in the host core waits on millis(); the decoder
+// reads with read() and never waits
+unsigned long millis()
+{
+  return 0;
+}
+
+class MemoryStream : public Stream
+{
+public:
+  MemoryStream(const uint8_t *data, size_t len) : data(data), len(len), pos(0) {}
+  int available() { return len - pos; }
+  int read() { return pos < len ? data[pos++] : -1; }
+  int peek() { return pos < len ? data[pos] : -1; }
+  size_t write(uint8_t) { return 0; }
+
+private:
+  const uint8_t *data;
+  size_t len;
+  size_t pos;
+};
+
+static int decode(const uint8_t *data, size_t len, MedicationTime *table)
+{
+  MemoryStream in(data, len);
+  return scheduleDecode(in, table, TABLE_SIZE);
+}
+
+// The firmware keeps a tube's times where they were added, the app
+// sorts nothing either, so schedules match entry for entry by tube and
+// time rather than by position
+static void assertSameSchedule(const char *name, const MedicationTime *expected, int expectedCount,
+                               const MedicationTime *actual, int actualCount)
+{
+  TEST_ASSERT_EQUAL_INT_MESSAGE(expectedCount, actualCount, name);
+  for (int i = 0; i < expectedCount; i++)
+  {
+    const MedicationTime *match = NULL;
+    for (int j = 0; j < actualCount && !match; j++)
+    {
+      if (strcmp(expected[i].tube, actual[j].tube) == 0 && strcmp(expected[i].time, actual[j].time) == 0)
+        match = &actual[j];
+    }
+    TEST_ASSERT_NOT_NULL_MESSAGE(match, name);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected[i].medication, match->medication, name);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected[i].amount, match->amount, name);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected[i].dosage, match->dosage, name);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected[i].pills, match->pills, name);
+  }
+}
+
+void test_diff_round_trip()
+{
+  for (size_t v = 0; v < sizeof(deltaVectors) / sizeof(deltaVectors[0]); v++)
+  {
+    const DeltaVector &vector = deltaVectors[v];
+    MedicationTime table[TABLE_SIZE];
+    MedicationTime expected[TABLE_SIZE];
+    int count = decode(vector.before, vector.beforeLen, table);
+    int expectedCount = decode(vector.after, vector.afterLen, expected);
+    TEST_ASSERT_TRUE_MESSAGE(count >= 0 && expectedCount >= 0, vector.name);
+
+    // OP_BASE quotes this, so it has to be the CRC of the app's encoding
+    TEST_ASSERT_EQUAL_HEX16_MESSAGE(linkCrc16(0xFFFF, vector.before, vector.beforeLen),
+                                    scheduleFingerprint(table, count), vector.name);
+
+    uint16_t pos = 0;
+    uint8_t ops = 0;
+    while (pos < vector.opsLen)
+    {
+      uint8_t len = vector.ops[pos];
+      ScheduleDelta delta;
+      TEST_ASSERT_TRUE_MESSAGE(scheduleReadDelta(vector.ops + pos + 1, len, delta), vector.name);
+      uint8_t result = scheduleApplyDelta(delta, table, count, TABLE_SIZE);
+      TEST_ASSERT_TRUE_MESSAGE(result == SCHEDULE_DELTA_OK || result == SCHEDULE_DELTA_REFILL, vector.name);
+      pos += 1 + len;
+      ops++;
+    }
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(vector.opCount, ops, vector.name);
+    assertSameSchedule(vector.name, expected, expectedCount, table, count);
+  }
+}
+
+// A rejected edit leaves the table alone; main.cpp undoes the rest of
+// the batch, but an edit itself must never half-apply
+void test_rejected_edit_changes_nothing()
+{
+  const DeltaVector &vector = deltaVectors[0];
+  MedicationTime table[TABLE_SIZE];
+  int count = decode(vector.before, vector.beforeLen, table);
+  uint16_t before = scheduleFingerprint(table, count);
+
+  ScheduleDelta delta;
+  memset(&delta, 0, sizeof(delta));
+  strcpy(delta.tube, "tube9");
+  delta.op = SCHEDULE_OP_REMOVE_TIME;
+  delta.minute = 8 * 60;
+  TEST_ASSERT_EQUAL_UINT8(SCHEDULE_DELTA_NOT_FOUND, scheduleApplyDelta(delta, table, count, TABLE_SIZE));
+  delta.op = SCHEDULE_OP_MODIFY_TIME;
+  TEST_ASSERT_EQUAL_UINT8(SCHEDULE_DELTA_NOT_FOUND, scheduleApplyDelta(delta, table, count, TABLE_SIZE));
+  delta.op = SCHEDULE_OP_MODIFY_MED;
+  TEST_ASSERT_EQUAL_UINT8(SCHEDULE_DELTA_NOT_FOUND, scheduleApplyDelta(delta, table, count, TABLE_SIZE));
+  TEST_ASSERT_EQUAL_HEX16(before, scheduleFingerprint(table, count));
+
+  // Full table: the add is refused, not written past the end
+  MedicationTime full[TABLE_SIZE];
+  int fullCount = 0;
+  while (fullCount < TABLE_SIZE)
+    full[fullCount++] = table[0];
+  delta.op = SCHEDULE_OP_ADD_TIME;
+  strcpy(delta.dosage, "1 tablet");
+  TEST_ASSERT_EQUAL_UINT8(SCHEDULE_DELTA_FULL, scheduleApplyDelta(delta, full, fullCount, TABLE_SIZE));
+  TEST_ASSERT_EQUAL_INT(TABLE_SIZE, fullCount);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_diff_round_trip);
+  RUN_TEST(test_rejected_edit_changes_nothing);
+  return UNITY_END();
+}
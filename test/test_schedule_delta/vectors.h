@@ -0,0 +1,249 @@
+// Generated by gen_vectors.py from src/schedule_format.py; do not edit.
+#ifndef SCHEDULE_DELTA_VECTORS_H
+#define SCHEDULE_DELTA_VECTORS_H
+
+#include <stdint.h>
+
+static const uint8_t remove_med_before[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01,
+  0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e,
+  0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t remove_med_ops[] = {
+  0x02, 0x04, 0x01
+};
+
+static const uint8_t remove_med_after[] = {
+  0x50, 0x44, 0x53, 0x01, 0x03, 0x02, 0x3c, 0x00, 0x09, 0x56, 0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e,
+  0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03, 0x5a, 0x00, 0x09, 0x49, 0x62, 0x75,
+  0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01, 0x38, 0x04, 0x01, 0x04, 0x5a, 0x00,
+  0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t remove_time_before[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01,
+  0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e,
+  0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t remove_time_ops[] = {
+  0x04, 0x02, 0x02, 0xec, 0x04
+};
+
+static const uint8_t remove_time_after[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x01, 0x1c, 0x02, 0x02, 0x03, 0x5a, 0x00, 0x09,
+  0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01, 0x38, 0x04, 0x01,
+  0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x32, 0x31, 0x01,
+  0xc2, 0x01, 0x01
+};
+
+static const uint8_t add_time_before[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01,
+  0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e,
+  0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t add_time_ops[] = {
+  0x11, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56, 0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x1b,
+  0x03, 0x03
+};
+
+static const uint8_t add_time_after[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x03, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x1b,
+  0x03, 0x03, 0x03, 0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02,
+  0xc2, 0x01, 0x01, 0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f,
+  0x66, 0x65, 0x6e, 0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t move_time_before[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01,
+  0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e,
+  0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t move_time_ops[] = {
+  0x07, 0x03, 0x01, 0xb0, 0x04, 0x19, 0x05, 0x01
+};
+
+static const uint8_t move_time_after[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0x19, 0x05, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01,
+  0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e,
+  0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t change_dosage_before[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01,
+  0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e,
+  0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t change_dosage_ops[] = {
+  0x14, 0x03, 0x03, 0xc2, 0x01, 0xc2, 0x01, 0x8d, 0x68, 0x61, 0x6c, 0x66, 0x20, 0x61, 0x20, 0x74,
+  0x61, 0x62, 0x6c, 0x65, 0x74
+};
+
+static const uint8_t change_dosage_after[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x8d,
+  0x68, 0x61, 0x6c, 0x66, 0x20, 0x61, 0x20, 0x74, 0x61, 0x62, 0x6c, 0x65, 0x74, 0x38, 0x04, 0x01,
+  0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x32, 0x31, 0x01,
+  0xc2, 0x01, 0x01
+};
+
+static const uint8_t modify_med_before[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01,
+  0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e,
+  0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t modify_med_ops[] = {
+  0x12, 0x05, 0x01, 0x64, 0x00, 0x0d, 0x41, 0x63, 0x65, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x6f, 0x70,
+  0x68, 0x65, 0x6e
+};
+
+static const uint8_t modify_med_after[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x64, 0x00, 0x0d, 0x41, 0x63, 0x65, 0x74, 0x61, 0x6d, 0x69,
+  0x6e, 0x6f, 0x70, 0x68, 0x65, 0x6e, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00,
+  0x09, 0x56, 0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04,
+  0x01, 0x03, 0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2,
+  0x01, 0x01, 0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66,
+  0x65, 0x6e, 0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t add_med_before[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01,
+  0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e,
+  0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t add_med_ops[] = {
+  0x12, 0x01, 0x05, 0x1c, 0x00, 0x0a, 0x4f, 0x6d, 0x65, 0x70, 0x72, 0x61, 0x7a, 0x6f, 0x6c, 0x65,
+  0x95, 0x01, 0x01
+};
+
+static const uint8_t add_med_after[] = {
+  0x50, 0x44, 0x53, 0x01, 0x05, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01,
+  0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e,
+  0x32, 0x31, 0x01, 0xc2, 0x01, 0x01, 0x05, 0x1c, 0x00, 0x0a, 0x4f, 0x6d, 0x65, 0x70, 0x72, 0x61,
+  0x7a, 0x6f, 0x6c, 0x65, 0x01, 0x95, 0x01, 0x01
+};
+
+static const uint8_t from_empty_before[] = {
+  0x50, 0x44, 0x53, 0x01, 0x00
+};
+
+static const uint8_t from_empty_ops[] = {
+  0x11, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56, 0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x1c,
+  0x02, 0x02, 0x11, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56, 0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20,
+  0x43, 0xec, 0x04, 0x01
+};
+
+static const uint8_t from_empty_after[] = {
+  0x50, 0x44, 0x53, 0x01, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56, 0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e,
+  0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01
+};
+
+static const uint8_t to_empty_before[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01,
+  0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e,
+  0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t to_empty_ops[] = {
+  0x02, 0x04, 0x01, 0x02, 0x04, 0x02, 0x02, 0x04, 0x03, 0x02, 0x04, 0x04
+};
+
+static const uint8_t to_empty_after[] = {
+  0x50, 0x44, 0x53, 0x01, 0x00
+};
+
+static const uint8_t mixed_before[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x02, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0x02, 0x3c, 0x00, 0x09, 0x56,
+  0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0x1c, 0x02, 0x02, 0xec, 0x04, 0x01, 0x03,
+  0x5a, 0x00, 0x09, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x02, 0xc2, 0x01, 0x01,
+  0x38, 0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e,
+  0x32, 0x31, 0x01, 0xc2, 0x01, 0x01
+};
+
+static const uint8_t mixed_ops[] = {
+  0x02, 0x04, 0x03, 0x13, 0x01, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0xc0, 0x03, 0x02, 0x0e, 0x05, 0x02, 0x2d, 0x00, 0x09, 0x56, 0x69, 0x74,
+  0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x07, 0x03, 0x02, 0x1c, 0x02, 0xfe, 0x01, 0x02, 0x1c, 0x01,
+  0x06, 0x0a, 0x00, 0x10, 0x43, 0x75, 0x73, 0x74, 0x6f, 0x6d, 0x20, 0x74, 0x65, 0x78, 0x74, 0x20,
+  0x74, 0x75, 0x62, 0x65, 0x62, 0x02, 0x84, 0x35, 0x20, 0x6d, 0x6c
+};
+
+static const uint8_t mixed_after[] = {
+  0x50, 0x44, 0x53, 0x01, 0x04, 0x01, 0x78, 0x00, 0x0b, 0x50, 0x61, 0x72, 0x61, 0x63, 0x65, 0x74,
+  0x61, 0x6d, 0x6f, 0x6c, 0x03, 0xb0, 0x04, 0x01, 0xd0, 0x02, 0x01, 0xc0, 0x03, 0x02, 0x02, 0x2d,
+  0x00, 0x09, 0x56, 0x69, 0x74, 0x61, 0x6d, 0x69, 0x6e, 0x20, 0x43, 0x02, 0xfe, 0x01, 0x02, 0xec,
+  0x04, 0x01, 0x04, 0x5a, 0x00, 0x0b, 0x49, 0x62, 0x75, 0x70, 0x72, 0x6f, 0x66, 0x65, 0x6e, 0x32,
+  0x31, 0x01, 0xc2, 0x01, 0x01, 0x06, 0x0a, 0x00, 0x10, 0x43, 0x75, 0x73, 0x74, 0x6f, 0x6d, 0x20,
+  0x74, 0x65, 0x78, 0x74, 0x20, 0x74, 0x75, 0x62, 0x65, 0x01, 0x62, 0x02, 0x84, 0x35, 0x20, 0x6d,
+  0x6c
+};
+
+struct DeltaVector
+{
+  const char *name;
+  const uint8_t *before;
+  uint16_t beforeLen;
+  const uint8_t *ops;                // Each op prefixed by its length
+  uint16_t opsLen;
+  uint8_t opCount;
+  const uint8_t *after;
+  uint16_t afterLen;
+};
+
+static const DeltaVector deltaVectors[] = {
+  {"remove_med", remove_med_before, sizeof(remove_med_before), remove_med_ops, 3, 1, remove_med_after, sizeof(remove_med_after)},
+  {"remove_time", remove_time_before, sizeof(remove_time_before), remove_time_ops, 5, 1, remove_time_after, sizeof(remove_time_after)},
+  {"add_time", add_time_before, sizeof(add_time_before), add_time_ops, 18, 1, add_time_after, sizeof(add_time_after)},
+  {"move_time", move_time_before, sizeof(move_time_before), move_time_ops, 8, 1, move_time_after, sizeof(move_time_after)},
+  {"change_dosage", change_dosage_before, sizeof(change_dosage_before), change_dosage_ops, 21, 1, change_dosage_after, sizeof(change_dosage_after)},
+  {"modify_med", modify_med_before, sizeof(modify_med_before), modify_med_ops, 19, 1, modify_med_after, sizeof(modify_med_after)},
+  {"add_med", add_med_before, sizeof(add_med_before), add_med_ops, 19, 1, add_med_after, sizeof(add_med_after)},
+  {"from_empty", from_empty_before, sizeof(from_empty_before), from_empty_ops, 36, 2, from_empty_after, sizeof(from_empty_after)},
+  {"to_empty", to_empty_before, sizeof(to_empty_before), to_empty_ops, 12, 4, to_empty_after, sizeof(to_empty_after)},
+  {"mixed", mixed_before, sizeof(mixed_before), mixed_ops, 75, 5, mixed_after, sizeof(mixed_after)},
+};
+
+#endif
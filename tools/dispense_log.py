@@ -0,0 +1,59 @@
+"""Print the binary dispense log (dispense.log) written by the firmware.
+
+Records are 16 bytes, little endian, laid out as DispenseLogRecord in
+include/DispenseLog.h. Records whose check byte does not match are flagged
+rather than skipped, so a damaged card still shows everything it holds.
+
+Usage:
+    python tools/dispense_log.py /media/sd/dispense.log
+    python tools/dispense_log.py --csv dispense.log > dispense.csv
+"""
+
+import argparse
+import datetime
+import functools
+import operator
+import struct
+import sys
+
+RECORD = struct.Struct("<IHHHBBBBBB")
+OUTCOMES = {0: "pending", 1: "ok", 2: "timeout", 3: "unknown-tube", 4: "jammed", 5: "missed"}
+
+
+def read_records(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    usable = len(data) - len(data) % RECORD.size
+    for offset in range(0, usable, RECORD.size):
+        raw = data[offset:offset + RECORD.size]
+        fields = RECORD.unpack(raw)
+        valid = functools.reduce(operator.xor, raw[:-1], 0) == raw[-1]
+        yield fields, valid
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log")
+    parser.add_argument("--csv", action="store_true", help="comma-separated output")
+    args = parser.parse_args()
+
+    header = ["seq", "time", "slot", "tube", "pills", "wanted", "latency_ms", "outcome", "valid"]
+    print(",".join(header) if args.csv else "  ".join(header))
+    for fields, valid in read_records(args.log):
+        timestamp, seq, slot, latency, tube, wanted, seen, outcome, _version, _check = fields
+        row = [
+            str(seq),
+            datetime.datetime.fromtimestamp(timestamp, datetime.timezone.utc).strftime("%Y-%m-%d %H:%M:%S"),
+            "%02d:%02d" % divmod(slot, 60),
+            "tube%d" % tube if tube else "?",
+            str(seen),
+            str(wanted),
+            str(latency),
+            OUTCOMES.get(outcome, str(outcome)),
+            "yes" if valid else "NO",
+        ]
+        print(",".join(row) if args.csv else "  ".join(row))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
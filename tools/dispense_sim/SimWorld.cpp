@@ -0,0 +1,395 @@
+#include <math.h>
+#include <stdio.h>
+#include "SimWorld.h"
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <Servo.h>
+
+SimWorld *simWorld = nullptr;
+bool simVerbose = false;
+SimSerial Serial;
+static bool serialLineStart = true;
+EEPROMClass EEPROM;
+
+SimWorld::SimWorld(uint64_t seed) : rng(seed ? seed : 0x9E3779B97F4A7C15ULL)
+{
+}
+
+double SimWorld::uniform()
+{
+  // xorshift64*
+  rng ^= rng >> 12;
+  rng ^= rng << 25;
+  rng ^= rng >> 27;
+  return ((rng * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double SimWorld::gaussian(double mean, double sd)
+{
+  double u1 = uniform();
+  double u2 = uniform();
+  if (u1 < 1e-12)
+    u1 = 1e-12;
+  return mean + sd * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+double SimWorld::drawPitch()
+{
+  return 1.0 + params.pitchJitter * (2.0 * uniform() - 1.0);
+}
+
+void SimWorld::bindTube(uint8_t tube, uint8_t motorPin, int8_t brakePin, Servo *servo)
+{
+  tubes[tube].motorPin = motorPin;
+  tubes[tube].brakePin = brakePin;
+  tubes[tube].servo = servo;
+}
+
+void SimWorld::registerServo(Servo *servo)
+{
+  if (servoCount < SIM_TUBES)
+    servos[servoCount++] = servo;
+}
+
+void SimWorld::startCycle()
+{
+  for (Tube &tube : tubes)
+  {
+    tube.jammed = uniform() < params.jamRate;
+    tube.progress = uniform() * 0.8;   // Where the feeder stopped last time is unknown
+    tube.nextPitch = drawPitch();
+    tube.count = {0, 0, tube.jammed};
+  }
+}
+
+void SimWorld::dropPill(Tube &tube, bool dragged)
+{
+  tube.count.dropped++;
+  if (dragged)
+    tube.count.doubles++;
+  if (fallingCount == SIM_MAX_FALLING)
+    return;
+
+  double fall = gaussian(params.fallMs, params.fallJitterMs);
+  double occlude = gaussian(params.occludeMs, params.occludeJitterMs);
+  if (occlude < 2)
+    occlude = 2;
+  // A dragged pill trails the first one by a few ms and may merge with it in the beam
+  if (dragged)
+    fall += 3 + uniform() * 30;
+
+  Falling &pill = falling[fallingCount++];
+  pill.blockFrom = now + (uint64_t)(fall * 1000);
+  pill.blockUntil = pill.blockFrom + (uint64_t)(occlude * 1000);
+}
+
+void SimWorld::step(double dtMs)
+{
+  for (Tube &tube : tubes)
+  {
+    if (tube.motorPin == 0xFF)
+      continue;
+
+    // Continuous-rotation gate: speed follows the pulse offset from standby
+    if (tube.servo)
+    {
+      int offset = tube.servo->readMicroseconds() - DEFAULT_PULSE_WIDTH;
+      if (offset > 20 || offset < -20)
+      {
+        double rate = params.gateRateDegPerS * constrain(offset / 400.0, -1.0, 1.0);
+        // Opening is the negative direction (SERVO_OPEN_POS < standby)
+        tube.gateDeg = constrain(tube.gateDeg - rate * dtMs / 1000.0, 0.0, params.gateOpenDeg);
+      }
+    }
+
+    // First-order motor with stiction; braking shortens the spin-down
+    double drive = tube.duty / 255.0;
+    double target = drive > params.motorStiction ? (drive - params.motorStiction) / (1 - params.motorStiction) : 0;
+    double tau = (target == 0 && tube.braking) ? params.brakeTauMs : params.motorTauMs;
+    tube.speed += (target - tube.speed) * (1 - exp(-dtMs / tau));
+    if (target == 0 && tube.speed < 0.01)
+      tube.speed = 0;
+
+    if (!tube.jammed && tube.speed > 0)
+    {
+      tube.progress += tube.speed * params.feedPitchesPerS * dtMs / 1000.0;
+      if (tube.progress >= tube.nextPitch)
+      {
+        tube.progress -= tube.nextPitch;
+        tube.nextPitch = drawPitch();
+        tube.pillWaiting = true;
+      }
+    }
+
+    if (tube.pillWaiting && tube.gateDeg >= params.gatePassDeg)
+    {
+      tube.pillWaiting = false;
+      dropPill(tube, false);
+      // Faster feed, more bounce: a neighbour gets dragged along
+      if (uniform() < params.doubleDropRate * tube.speed * tube.speed)
+        dropPill(tube, true);
+    }
+  }
+
+  // Forget pills that have passed the beam
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < fallingCount; i++)
+  {
+    if (falling[i].blockUntil > now)
+      falling[kept++] = falling[i];
+  }
+  fallingCount = kept;
+}
+
+void SimWorld::advanceUs(uint64_t us)
+{
+  while (us > 0)
+  {
+    uint64_t slice = us < 100 ? us : 100;
+    now += slice;
+    us -= slice;
+    while (now >= nextServoFrame)
+    {
+      for (uint8_t i = 0; i < servoCount; i++)
+        servos[i]->frame();
+      nextServoFrame += REFRESH_INTERVAL;
+    }
+    step(slice / 1000.0);
+  }
+}
+
+void SimWorld::settle(unsigned long ms)
+{
+  advanceUs((uint64_t)ms * 1000);
+}
+
+bool SimWorld::beamBlocked() const
+{
+  for (uint8_t i = 0; i < fallingCount; i++)
+  {
+    if (now >= falling[i].blockFrom && now < falling[i].blockUntil)
+      return true;
+  }
+  return false;
+}
+
+void SimWorld::setPin(uint8_t pin, int value)
+{
+  for (Tube &tube : tubes)
+  {
+    if (tube.motorPin == pin)
+      tube.duty = value ? 255 : 0;
+    else if (tube.brakePin == pin)
+      tube.braking = value;
+  }
+}
+
+void SimWorld::setPwm(uint8_t pin, int duty)
+{
+  for (Tube &tube : tubes)
+  {
+    if (tube.motorPin == pin)
+      tube.duty = constrain(duty, 0, 255);
+  }
+}
+
+int SimWorld::readPin(uint8_t pin) const
+{
+  if (pin == SIM_SENSOR_PIN)
+    return beamBlocked() ? LOW : HIGH;   // Receiver pulls low when the beam is broken
+  return LOW;
+}
+
+/* ---- Arduino HAL ---- */
+
+unsigned long millis()
+{
+  return simWorld->nowUs() / 1000;
+}
+
+unsigned long micros()
+{
+  return simWorld->nowUs();
+}
+
+void delay(unsigned long ms)
+{
+  simWorld->advanceUs((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  simWorld->advanceUs(us);
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  simWorld->setPin(pin, value);
+}
+
+int digitalRead(uint8_t pin)
+{
+  return simWorld->readPin(pin);
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+  simWorld->setPwm(pin, value);
+}
+
+void SimSerial::print(const __FlashStringHelper *s)
+{
+  print(reinterpret_cast<const char *>(s));
+}
+
+// Stamps each line with simulated time in ms
+static bool serialBegin()
+{
+  if (!simVerbose)
+    return false;
+  if (serialLineStart)
+    printf("[%9.1f] ", simWorld->nowUs() / 1000.0);
+  serialLineStart = false;
+  return true;
+}
+
+void SimSerial::print(const char *s)
+{
+  if (serialBegin())
+    fputs(s, stdout);
+}
+
+void SimSerial::print(char c)
+{
+  if (serialBegin())
+    putchar(c);
+}
+
+void SimSerial::print(long value)
+{
+  if (serialBegin())
+    printf("%ld", value);
+}
+
+void SimSerial::print(unsigned long value)
+{
+  if (serialBegin())
+    printf("%lu", value);
+}
+
+void SimSerial::println()
+{
+  if (simVerbose)
+    putchar('\n');
+  serialLineStart = true;
+}
+
+/* ---- Servo, same trapezoid as lib/Servo/src/avr/Servo.cpp, in microseconds ---- */
+
+Servo::Servo()
+    : attachedPin(-1), index(0), pulse(DEFAULT_PULSE_WIDTH), state(0), sweep(false), target(0),
+      returnTarget(0), speed(0), maxSpeed(1), accel(1), holdFrames(0), onComplete(nullptr)
+{
+}
+
+uint8_t Servo::attach(int pin)
+{
+  attachedPin = pin;
+  simWorld->registerServo(this);
+  return index;
+}
+
+int Servo::toMicroseconds(int value)
+{
+  if (value < MIN_PULSE_WIDTH)
+  {
+    value = constrain(value, 0, 180);
+    value = MIN_PULSE_WIDTH + (long)value * (MAX_PULSE_WIDTH - MIN_PULSE_WIDTH) / 180;
+  }
+  return constrain(value, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);
+}
+
+void Servo::write(int value)
+{
+  writeMicroseconds(toMicroseconds(value));
+}
+
+void Servo::writeMicroseconds(int value)
+{
+  pulse = toMicroseconds(value);
+  state = 0;
+}
+
+void Servo::startProfile(int value, int maxSpeedUs, int accelUs, unsigned int hold, int returnValue, bool isSweep, ServoMoveCallback done)
+{
+  state = 1;
+  sweep = isSweep;
+  target = toMicroseconds(value);
+  returnTarget = isSweep ? toMicroseconds(returnValue) : target;
+  speed = 0;
+  maxSpeed = maxSpeedUs > 0 ? maxSpeedUs : 1;
+  accel = accelUs > 0 ? accelUs : 1;
+  holdFrames = hold;
+  onComplete = done;
+}
+
+void Servo::moveTo(int value, int maxSpeedUs, int accelUs, ServoMoveCallback done)
+{
+  startProfile(value, maxSpeedUs, accelUs, 0, value, false, done);
+}
+
+void Servo::sweepTo(int value, int maxSpeedUs, int accelUs, unsigned int holdMs, int returnValue, ServoMoveCallback done)
+{
+  startProfile(value, maxSpeedUs, accelUs, (unsigned long)holdMs * 1000UL / REFRESH_INTERVAL, returnValue, true, done);
+}
+
+void Servo::frame()
+{
+  if (state == 0)
+    return;
+
+  if (state == 2)
+  {
+    if (holdFrames > 0)
+    {
+      holdFrames--;
+      return;
+    }
+    target = returnTarget;
+    state = 3;
+  }
+
+  int dist = abs(pulse - target);
+  long stopping = (long)speed * speed / (2L * accel);
+
+  if (stopping >= dist)
+    speed = speed > accel ? speed - accel : accel;
+  else if (speed < maxSpeed && stopping + speed + accel < dist)
+    speed = speed + accel < maxSpeed ? speed + accel : maxSpeed;
+  else if (speed == 0)
+    speed = accel;
+
+  if (speed >= dist)
+    pulse = target;
+  else if (pulse > target)
+    pulse -= speed;
+  else
+    pulse += speed;
+
+  if (pulse == target)
+  {
+    speed = 0;
+    if (state == 1 && sweep)
+      state = 2;
+    else
+    {
+      state = 0;
+      if (onComplete)
+        onComplete(index);
+    }
+  }
+}
@@ -0,0 +1,99 @@
+// Physics-lite model of the dispenser hardware behind the fake Arduino HAL
+#ifndef SIM_WORLD_H
+#define SIM_WORLD_H
+
+#include <stdint.h>
+
+#define SIM_TUBES 4
+#define SIM_SENSOR_PIN 32
+#define SIM_MAX_FALLING 16
+
+struct SimParams
+{
+  double gateRateDegPerS = 200;      // Gate speed at full servo command
+  double gateOpenDeg = 90;           // Mechanical stop
+  double gatePassDeg = 70;           // Pills only get through beyond this opening
+  double motorTauMs = 60;            // Spin-up / coast time constant
+  double brakeTauMs = 12;            // Time constant while the driver brakes
+  double motorStiction = 0.15;       // Duty fraction needed before the feeder turns
+  double feedPitchesPerS = 2.5;      // Pills per second at full speed
+  double pitchJitter = 0.35;         // Pitch varies by +-35 %
+  double fallMs = 120;               // Exit to beam
+  double fallJitterMs = 15;          // Gaussian sd
+  double occludeMs = 14;             // Beam blocked per pill
+  double occludeJitterMs = 4;
+  double doubleDropRate = 0.25;      // Chance a pill drags a second one at full speed
+  double jamRate = 0.0;              // Chance a tube is jammed for a whole cycle
+};
+
+struct SimTubeCounters
+{
+  unsigned dropped;                  // Pills that actually fell this cycle
+  unsigned doubles;                  // Of which dragged along by another pill
+  bool jammed;                       // The feeder was jammed for the whole cycle
+};
+
+class SimWorld
+{
+public:
+  explicit SimWorld(uint64_t seed);
+
+  SimParams params;
+
+  void bindTube(uint8_t tube, uint8_t motorPin, int8_t brakePin, class Servo *servo);
+  void startCycle();                 // New jam draw and feeder phase per tube, counters cleared
+  void advanceUs(uint64_t us);
+  void settle(unsigned long ms);     // Let coasting motors and falling pills finish
+
+  uint64_t nowUs() const { return now; }
+  bool beamBlocked() const;
+  void setPin(uint8_t pin, int value);
+  void setPwm(uint8_t pin, int duty);
+  int readPin(uint8_t pin) const;
+  void registerServo(class Servo *servo);
+  const SimTubeCounters &counters(uint8_t tube) const { return tubes[tube].count; }
+
+  double uniform();                  // [0, 1)
+  double gaussian(double mean, double sd);
+
+private:
+  struct Tube
+  {
+    uint8_t motorPin = 0xFF;
+    int8_t brakePin = -1;
+    bool braking = false;
+    class Servo *servo = nullptr;
+    double gateDeg = 0;
+    double speed = 0;                // Feeder speed, 0..1
+    int duty = 0;                    // Last PWM duty, 0..255
+    double progress = 0;             // Feeder travel towards the next pill, in pitches
+    double nextPitch = 1;
+    bool jammed = false;
+    bool pillWaiting = false;        // A pill reached the exit while the gate was shut
+    SimTubeCounters count = {0, 0, false};
+  };
+
+  struct Falling
+  {
+    uint64_t blockFrom;
+    uint64_t blockUntil;
+  };
+
+  void step(double dtMs);
+  void dropPill(Tube &tube, bool dragged);
+  double drawPitch();
+
+  uint64_t rng;
+  uint64_t now = 0;
+  uint64_t nextServoFrame = 0;
+  Tube tubes[SIM_TUBES];
+  Falling falling[SIM_MAX_FALLING];
+  uint8_t fallingCount = 0;
+  class Servo *servos[SIM_TUBES];
+  uint8_t servoCount = 0;
+};
+
+extern SimWorld *simWorld;
+extern bool simVerbose;
+
+#endif
@@ -0,0 +1,65 @@
+// Host stand-in for the Arduino core, just enough for the dispense modules.
+// Time, pins and PWM are backed by the simulated world in SimWorld.cpp.
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+// Serial output is dropped unless the simulator runs with --verbose
+class SimSerial
+{
+public:
+  void print(const __FlashStringHelper *s);
+  void print(const char *s);
+  void print(char c);
+  void print(long value);
+  void print(unsigned long value);
+  void print(int value) { print((long)value); }
+  void print(unsigned int value) { print((unsigned long)value); }
+  template <typename T>
+  void println(T value)
+  {
+    print(value);
+    println();
+  }
+  void println();
+};
+
+extern SimSerial Serial;
+
+#endif
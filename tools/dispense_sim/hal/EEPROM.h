@@ -0,0 +1,43 @@
+// Host stand-in for the AVR EEPROM library: 4 KB in RAM, starts erased
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include <Arduino.h>
+
+class EEPROMClass
+{
+public:
+  EEPROMClass() { memset(cells, 0xFF, sizeof(cells)); }
+
+  template <typename T>
+  T &get(int address, T &value)
+  {
+    memcpy(&value, cells + address, sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  const T &put(int address, const T &value)
+  {
+    const uint8_t *bytes = (const uint8_t *)&value;
+    for (size_t i = 0; i < sizeof(T); i++)
+    {
+      if (cells[address + i] != bytes[i])
+      {
+        cells[address + i] = bytes[i];
+        writes++;
+      }
+    }
+    return value;
+  }
+
+  uint8_t read(int address) { return cells[address]; }
+  uint16_t length() { return sizeof(cells); }
+
+  uint8_t cells[4096];
+  unsigned long writes = 0;          // Cell writes, for wear reports
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,51 @@
+// Host stand-in for lib/Servo with the same profiled-move API. The
+// simulator steps every attached servo once per 20 ms refresh frame, like
+// the timer ISR does on the Mega, using the same trapezoid.
+#ifndef SIM_SERVO_H
+#define SIM_SERVO_H
+
+#include <Arduino.h>
+
+#define MIN_PULSE_WIDTH 544
+#define MAX_PULSE_WIDTH 2400
+#define DEFAULT_PULSE_WIDTH 1500
+#define REFRESH_INTERVAL 20000
+
+typedef void (*ServoMoveCallback)(uint8_t servoIndex);
+
+class Servo
+{
+public:
+  Servo();
+  uint8_t attach(int pin);
+  void detach() { attachedPin = -1; }
+  void write(int value);
+  void writeMicroseconds(int value);
+  int readMicroseconds() { return pulse; }
+  bool attached() { return attachedPin >= 0; }
+
+  void moveTo(int value, int maxSpeed, int accel, ServoMoveCallback onComplete = nullptr);
+  void sweepTo(int value, int maxSpeed, int accel, unsigned int holdMs, int returnValue, ServoMoveCallback onComplete = nullptr);
+  bool moving() { return state != 0; }
+
+  void frame();                      // Simulator: one refresh frame
+
+private:
+  static int toMicroseconds(int value);
+  void startProfile(int value, int maxSpeed, int accel, unsigned int holdFrames, int returnValue, bool sweep, ServoMoveCallback onComplete);
+
+  int attachedPin;
+  uint8_t index;
+  int pulse;
+  uint8_t state;
+  bool sweep;
+  int target;
+  int returnTarget;
+  int speed;
+  int maxSpeed;
+  int accel;
+  unsigned int holdFrames;
+  ServoMoveCallback onComplete;
+};
+
+#endif
@@ -0,0 +1,256 @@
+/*
+ * Host-side dispense simulator.
+ *
+ * Runs the real Dispenser, MotorDrive and DispenseTiming code against the
+ * physics-lite model in SimWorld for many dispense cycles and reports
+ * latency distribution, timeouts, double-drops and miscounts. Randomness
+ * is seeded, so a run is reproducible and two builds can be compared.
+ *
+ *   pio run -e native_sim && .pio/build/native_sim/program --cycles 5000 --tubes 3
+ *
+ * Options:
+ *   --cycles N       dispense sequences to run (default 2000)
+ *   --seed N         random seed (default 1)
+ *   --tubes N        tubes per sequence, 1-4 (default 3)
+ *   --pills N        pills per tube (default 1)
+ *   --jam-rate X     chance a tube is jammed for a cycle (default 0)
+ *   --double-rate X  chance of a dragged second pill at full feed speed (default 0.25)
+ *   --legacy-motor   full-on start, no coast (the pre-PWM behaviour)
+ *   --brake          give every motor driver a brake input
+ *   --sequential     also run the same cycles one actuator at a time
+ *                    (MAX_ACTIVE_ACTUATORS 1) and compare sequence times
+ *   --verbose        print the firmware's Serial output
+ */
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "SimWorld.h"
+#include "Dispenser.h"
+#include "DispenseTiming.h"
+#include <EEPROM.h>
+
+static const uint8_t motorPins[SIM_TUBES] = {5, 2, 3, 12};
+static const int8_t brakePins[SIM_TUBES] = {40, 41, 42, 43};
+
+struct Options
+{
+  unsigned long cycles = 2000;
+  uint64_t seed = 1;
+  uint8_t tubes = 3;
+  uint8_t pills = 1;
+  double jamRate = 0;
+  double doubleRate = 0.25;
+  bool legacyMotor = false;
+  bool brake = false;
+  bool sequential = false;
+};
+
+struct PassResult
+{
+  std::vector<unsigned long> latencies;
+  std::vector<unsigned long> sequences;
+  unsigned long jobsRun = 0, ok = 0, timeouts = 0, jammed = 0;
+  unsigned long jamsInjected = 0, jamsReported = 0;  // Jammed feeders, and of those reported DISPENSE_JAMMED
+  unsigned long doubleDrops = 0, overDispensed = 0, underCounted = 0, shortDoses = 0;
+  unsigned long eepromWrites = 0;
+};
+
+static bool parseOptions(int argc, char **argv, Options &opt)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(arg, "--verbose"))
+      simVerbose = true;
+    else if (!strcmp(arg, "--legacy-motor"))
+      opt.legacyMotor = true;
+    else if (!strcmp(arg, "--brake"))
+      opt.brake = true;
+    else if (!strcmp(arg, "--sequential"))
+      opt.sequential = true;
+    else if (value && !strcmp(arg, "--cycles"))
+      opt.cycles = strtoul(argv[++i], nullptr, 10);
+    else if (value && !strcmp(arg, "--seed"))
+      opt.seed = strtoull(argv[++i], nullptr, 10);
+    else if (value && !strcmp(arg, "--tubes"))
+    {
+      int tubes = atoi(argv[++i]);
+      opt.tubes = constrain(tubes, 1, SIM_TUBES);
+    }
+    else if (value && !strcmp(arg, "--pills"))
+    {
+      int pills = atoi(argv[++i]);
+      opt.pills = constrain(pills, 1, DISPENSE_MAX_PILLS);
+    }
+    else if (value && !strcmp(arg, "--jam-rate"))
+      opt.jamRate = atof(argv[++i]);
+    else if (value && !strcmp(arg, "--double-rate"))
+      opt.doubleRate = atof(argv[++i]);
+    else
+    {
+      fprintf(stderr, "unknown option %s (see the comment at the top of main.cpp)\n", arg);
+      return false;
+    }
+  }
+  return true;
+}
+
+static unsigned long percentile(std::vector<unsigned long> &values, unsigned pct)
+{
+  if (values.empty())
+    return 0;
+  size_t at = (values.size() - 1) * pct / 100;
+  std::nth_element(values.begin(), values.begin() + at, values.end());
+  return values[at];
+}
+
+static void printHistogram(const std::vector<unsigned long> &latencies)
+{
+  const unsigned long bucketMs = 250;
+  const int buckets = 16;
+  unsigned long counts[buckets] = {0};
+  for (unsigned long latency : latencies)
+    counts[std::min<unsigned long>(latency / bucketMs, buckets - 1)]++;
+
+  unsigned long peak = *std::max_element(counts, counts + buckets);
+  for (int i = 0; i < buckets; i++)
+  {
+    if (counts[i] == 0)
+      continue;
+    int bar = peak ? (int)(counts[i] * 50 / peak) : 0;
+    printf("  %5lu-%-5lu ms %7lu |%.*s\n", i * bucketMs, (i + 1) * bucketMs - 1, counts[i], bar,
+           "##################################################");
+  }
+}
+
+static void printSequences(const char *label, std::vector<unsigned long> &sequences)
+{
+  printf("  %-22s p50 %lu  p90 %lu  p99 %lu  max %lu\n", label, percentile(sequences, 50),
+         percentile(sequences, 90), percentile(sequences, 99), percentile(sequences, 100));
+}
+
+// One run of opt.cycles sequences from a fresh world and erased EEPROM,
+// so two passes with the same seed see the same pills and jams
+static void runPass(const Options &opt, uint8_t actuatorLimit, PassResult &result)
+{
+  SimWorld world(opt.seed);
+  world.params.jamRate = opt.jamRate;
+  world.params.doubleDropRate = opt.doubleRate;
+  simWorld = &world;
+  memset(EEPROM.cells, 0xFF, sizeof(EEPROM.cells));
+  EEPROM.writes = 0;
+
+  static Servo servos[SIM_TUBES];
+  static TubeMapping tubes[SIM_TUBES] = {
+      {"tube1", 0, motorPins[0], &servos[0], MOTOR_PROFILE_DEFAULT},
+      {"tube2", 1, motorPins[1], &servos[1], MOTOR_PROFILE_DEFAULT},
+      {"tube3", 2, motorPins[2], &servos[2], MOTOR_PROFILE_DEFAULT},
+      {"tube4", 3, motorPins[3], &servos[3], MOTOR_PROFILE_DEFAULT}};
+
+  for (uint8_t i = 0; i < SIM_TUBES; i++)
+  {
+    if (opt.legacyMotor)
+      tubes[i].motor = {255, 255, 255, 0, -1};
+    if (opt.brake)
+      tubes[i].motor.brakePin = brakePins[i];
+    servos[i].attach(46 + i);
+    servos[i].write(SERVO_STANDBY_POS);
+    world.bindTube(i, motorPins[i], tubes[i].motor.brakePin, &servos[i]);
+  }
+  dispenserBegin(tubes, SIM_TUBES, SIM_SENSOR_PIN);
+  dispenserSetActuatorLimit(actuatorLimit);
+
+  char name[8];
+  for (unsigned long cycle = 0; cycle < opt.cycles; cycle++)
+  {
+    world.startCycle();
+    dispenserReset();
+    for (uint8_t t = 0; t < opt.tubes; t++)
+    {
+      snprintf(name, sizeof(name), "tube%u", t + 1);
+      dispenserQueue(name, opt.pills);
+    }
+
+    unsigned long start = millis();
+    runDispenseSequence();
+    result.sequences.push_back(millis() - start);
+    world.settle(1500);              // Coasting feeders and falling pills finish
+
+    for (uint8_t i = 0; i < dispenserJobCount(); i++)
+    {
+      const DispenseJob *job = dispenserJob(i);
+      const SimTubeCounters &count = world.counters(i);
+      result.jobsRun++;
+      if (job->outcome == DISPENSE_OK)
+      {
+        result.ok++;
+        result.latencies.push_back(job->latency);
+      }
+      else if (job->outcome == DISPENSE_JAMMED)
+        result.jammed++;
+      else
+        result.timeouts++;
+
+      if (count.jammed)
+      {
+        result.jamsInjected++;
+        if (job->outcome == DISPENSE_JAMMED)
+          result.jamsReported++;
+      }
+      result.doubleDrops += count.doubles;
+      if (count.dropped > job->pillsWanted)
+        result.overDispensed++;
+      if (count.dropped < job->pillsWanted)
+        result.shortDoses++;
+      if (job->pillsSeen < count.dropped && count.dropped <= job->pillsWanted)
+        result.underCounted++;
+    }
+  }
+  result.eepromWrites = EEPROM.writes;
+  simWorld = nullptr;
+}
+
+int main(int argc, char **argv)
+{
+  Options opt;
+  if (!parseOptions(argc, argv, opt))
+    return 2;
+
+  PassResult r;
+  runPass(opt, MAX_ACTIVE_ACTUATORS, r);
+
+  printf("Dispense simulation: %lu cycles x %u tubes x %u pills, seed %llu%s%s\n", opt.cycles, opt.tubes,
+         opt.pills, (unsigned long long)opt.seed, opt.legacyMotor ? ", legacy motor" : "",
+         opt.brake ? ", braking" : "");
+  printf("  jobs %lu: ok %lu, timeout %lu, jammed %lu\n", r.jobsRun, r.ok, r.timeouts, r.jammed);
+  printf("  jammed feeders %lu, reported as jammed %lu\n", r.jamsInjected, r.jamsReported);
+  printf("  double-drops %lu, over-dispensed jobs %lu, short doses %lu, beam undercounts %lu\n",
+         r.doubleDrops, r.overDispensed, r.shortDoses, r.underCounted);
+  printf("  first-pill latency ms: p50 %lu  p90 %lu  p99 %lu  max %lu\n", percentile(r.latencies, 50),
+         percentile(r.latencies, 90), percentile(r.latencies, 99), percentile(r.latencies, 100));
+  printSequences("sequence ms:", r.sequences);
+  printf("  EEPROM cell writes %lu\n", r.eepromWrites);
+
+  if (opt.sequential)
+  {
+    PassResult base;
+    runPass(opt, 1, base);
+    printf("Sequential baseline (1 actuator at a time), same seed:\n");
+    printf("  jobs %lu: ok %lu, timeout %lu, jammed %lu\n", base.jobsRun, base.ok, base.timeouts, base.jammed);
+    printSequences("sequence ms:", base.sequences);
+    printf("Concurrent (%d actuators):\n", MAX_ACTIVE_ACTUATORS);
+    printSequences("sequence ms:", r.sequences);
+    unsigned long concurrent = percentile(r.sequences, 50);
+    if (concurrent)
+      printf("  p50 speedup %.2fx\n", (double)percentile(base.sequences, 50) / concurrent);
+  }
+
+  printf("Latency histogram:\n");
+  printHistogram(r.latencies);
+  if (simVerbose)
+    timingPrint();
+  return 0;
+}
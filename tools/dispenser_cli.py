@@ -0,0 +1,306 @@
+"""Headless schedule tool: check, encode, render and upload in batches.
+
+Schedules are either the app's medication JSON (*.json) or prescription
+text in the builder's line format (anything else, see pyproject/main.py),
+which becomes one tube per line in order.
+
+Usage:
+    python tools/dispenser_cli.py check schedules/*.json
+    python tools/dispenser_cli.py encode -o out/ schedules/*.json ward3.txt
+    python tools/dispenser_cli.py render -o pages/ --workers 8 --hospital "Ward 3" rx/*.txt
+    zbarimg --raw -q page*.png | python tools/dispenser_cli.py qr-decode --json - > bed1.json
+    python tools/dispenser_cli.py upload --jobs 8 AA:BB:CC:DD:EE:01=bed1.json SERIAL:/dev/ttyUSB0=bed2.txt
+    generate_jobs | python tools/dispenser_cli.py upload -
+    python tools/dispenser_cli.py provision --jobs 8 Dispenser-01=bed1.json Dispenser-02=bed2.json
+    python tools/dispenser_cli.py provision --simulate --sim-loss 0.02 --manifest ward3.csv
+
+An upload job is ADDRESS=FILE, with the same addresses the GUI uses
+(SIM:..., SERIAL:<path> or a BLE address). With "-" jobs are read from
+stdin, one per line, and start as they arrive. A provision job is
+TARGET=FILE where TARGET may also be an advertised device name: one
+scan finds them all before the uploads start (see src/provision.py).
+A manifest holds one TARGET,FILE per line.
+
+qr-decode takes the scanned contents of a rendered prescription's QR
+codes, one per line in any order, and rebuilds the prescription text
+(see pyproject/qr_parts.py).
+
+Each finished job prints one JSON line on stdout; progress goes to
+stderr. The exit status is 1 if any file or job failed.
+"""
+
+import argparse
+import asyncio
+import json
+import os
+import sys
+import time
+
+ROOT = os.path.join(os.path.dirname(__file__), "..")
+sys.path.insert(0, os.path.join(ROOT, "src"))
+sys.path.insert(0, os.path.join(ROOT, "pyproject"))
+
+import dispenser_core  # noqa: E402
+import provision  # noqa: E402
+import schedule_format  # noqa: E402
+
+
+def load(path):
+    """The medication list in path; raises ValueError or OSError."""
+    if path.lower().endswith(".json"):
+        return dispenser_core.load_medications(path)
+    import prescription  # Needs Pillow; only text prescriptions pay for it
+    with open(path, "r", encoding="utf-8") as f:
+        meds, _ = prescription.parse_multiline(f.read())
+    if not meds:
+        raise ValueError("No valid medications found")
+    return dispenser_core.validate_medications(prescription.to_medications(meds))
+
+
+def log(text):
+    print(text, file=sys.stderr, flush=True)
+
+
+def cmd_check(args):
+    failed = 0
+    for path in args.files:
+        try:
+            medications = load(path)
+            schedule_format.encode(medications)
+            meds, tubes, schedules = dispenser_core.summarize(medications)
+            print(f"{path}: {meds} meds | {tubes} tubes | {schedules} schedules")
+        except (ValueError, OSError) as e:
+            print(f"{path}: {e}")
+            failed += 1
+    return 1 if failed else 0
+
+
+def cmd_encode(args):
+    os.makedirs(args.output, exist_ok=True)
+    failed = 0
+    for path in args.files:
+        try:
+            data = schedule_format.encode(load(path))
+        except (ValueError, OSError) as e:
+            log(f"{path}: {e}")
+            failed += 1
+            continue
+        out = os.path.join(args.output, os.path.splitext(os.path.basename(path))[0] + ".bin")
+        with open(out, "wb") as f:
+            f.write(data)
+        print(f"{out}: {len(data)} bytes")
+    return 1 if failed else 0
+
+
+def cmd_render(args):
+    import prescription
+
+    os.makedirs(args.output, exist_ok=True)
+    jobs = []
+    failed = 0
+    for path in args.files:
+        try:
+            with open(path, "r", encoding="utf-8") as f:
+                text = f.read()
+        except OSError as e:
+            log(f"{path}: {e}")
+            failed += 1
+            continue
+        jobs.append({"name": os.path.splitext(os.path.basename(path))[0], "text": text,
+                     "out_dir": args.output, "format": args.format,
+                     "hospital_name": args.hospital, "logo_path": args.logo, "doctor_name": args.doctor,
+                     "patient_name": args.patient, "notes": args.notes})
+
+    def done(name, pages, error):
+        if error:
+            log(f"{name}: {error}")
+        else:
+            print(f"{name}: {pages} page(s)")
+
+    totals = prescription.render_batch(jobs, workers=args.workers, on_done=done)
+    log(f"{totals['pages']} pages from {totals['prescriptions']} prescriptions in {totals['elapsed_s']} s"
+        f" ({totals['pages_per_s']} pages/s)")
+    return 1 if failed or totals["failed"] else 0
+
+
+def cmd_qr_decode(args):
+    import prescription
+    import qr_parts
+
+    scanned = []
+    try:
+        for path in args.files:
+            if path == "-":
+                lines = sys.stdin.readlines()
+            else:
+                with open(path, "r", encoding="utf-8") as f:
+                    lines = f.readlines()
+            scanned += [line.rstrip("\r\n") for line in lines]  # Base45 may end in a space
+        text = qr_parts.decode_parts(scanned)
+    except (ValueError, OSError) as e:
+        log(str(e))
+        return 1
+    if not args.json:
+        print(text)
+        return 0
+    try:
+        meds, _ = prescription.parse_multiline(text)
+    except ValueError as e:
+        log(str(e))
+        return 1
+    print(json.dumps(prescription.to_medications(meds), indent=2))
+    return 0
+
+
+def parse_job(text, separator="="):
+    target, sep, path = text.strip().partition(separator)
+    if not sep or not target.strip() or not path.strip():
+        raise ValueError(f"expected TARGET{separator}FILE, got '{text.strip()}'")
+    return target.strip(), path.strip()
+
+
+def report_line(report):
+    if report.ok:
+        log(f"{report.target}: {report.bytes} bytes confirmed in {report.total_s:.2f} s"
+            f" (fingerprint {report.fingerprint})")
+    else:
+        log(f"{report.target}: failed: {report.error}")
+    print(json.dumps(report.as_dict()), flush=True)
+
+
+async def read_jobs(stream):
+    """Yields lines from stream without blocking the event loop."""
+    loop = asyncio.get_running_loop()
+    while True:
+        line = await loop.run_in_executor(None, stream.readline)
+        if not line:
+            return
+        if line.strip() and not line.lstrip().startswith("#"):
+            yield line
+
+
+async def upload_all(args):
+    provisioner = provision.Provisioner(concurrency=args.jobs, load=load)
+    provisioner.on_report = report_line
+    failed = 0
+    tasks = []
+
+    def start(text):
+        nonlocal failed
+        try:
+            address, path = parse_job(text)
+        except ValueError as e:
+            log(str(e))
+            failed += 1
+            return
+        tasks.append(asyncio.ensure_future(provisioner.provision(address, path, address=address)))
+
+    for job in args.jobs_list:
+        if job == "-":
+            async for line in read_jobs(sys.stdin):
+                start(line)
+        else:
+            start(job)
+
+    reports = await asyncio.gather(*tasks)
+    failed += sum(1 for r in reports if not r.ok)
+    return 1 if failed else 0
+
+
+def cmd_upload(args):
+    if args.jobs < 1:
+        log("--jobs must be at least 1")
+        return 2
+    return asyncio.run(upload_all(args))
+
+
+async def provision_all(args, jobs):
+    sim_options = {"loss": args.sim_loss, "drops": args.sim_drops}
+    provisioner = provision.Provisioner(concurrency=args.jobs, scan_timeout=args.scan_timeout,
+                                        simulate=args.simulate, sim_options=sim_options, load=load)
+    if not args.simulate:
+        log(f"Scanning for {args.scan_timeout:.0f} s...")
+    started = time.monotonic()
+    reports = await provisioner.run(jobs, on_report=report_line)
+    summary = provision.summarize(reports, time.monotonic() - started)
+    log(f"{summary['ok']}/{summary['devices']} dispensers provisioned in {summary['elapsed_s']} s"
+        f" ({summary['devices_per_min']} per minute)")
+    if args.report:
+        with open(args.report, "w", encoding="utf-8") as f:
+            json.dump({"summary": summary, "devices": [r.as_dict() for r in reports]}, f, indent=2)
+    return 0 if summary["failed"] == 0 else 1
+
+
+def cmd_provision(args):
+    if args.jobs < 1:
+        log("--jobs must be at least 1")
+        return 2
+    try:
+        jobs = [parse_job(job) for job in args.jobs_list]
+        if args.manifest:
+            with open(args.manifest, "r", encoding="utf-8") as f:
+                jobs += [parse_job(line, ",") for line in f
+                         if line.strip() and not line.lstrip().startswith("#")]
+    except (ValueError, OSError) as e:
+        log(str(e))
+        return 2
+    if not jobs:
+        log("nothing to provision")
+        return 2
+    return asyncio.run(provision_all(args, jobs))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    check = sub.add_parser("check", help="parse and validate schedules")
+    check.add_argument("files", nargs="+")
+    check.set_defaults(run=cmd_check)
+
+    encode = sub.add_parser("encode", help="write the dispenser's binary schedule for each file")
+    encode.add_argument("files", nargs="+")
+    encode.add_argument("-o", "--output", default=".")
+    encode.set_defaults(run=cmd_encode)
+
+    render = sub.add_parser("render", help="render prescription text files to PNG pages or PDFs")
+    render.add_argument("files", nargs="+")
+    render.add_argument("-o", "--output", default=".")
+    render.add_argument("--hospital", default="")
+    render.add_argument("--logo", default="")
+    render.add_argument("--doctor", default="")
+    render.add_argument("--patient", default="")
+    render.add_argument("--notes", default="")
+    render.add_argument("--format", choices=("png", "pdf"), default="png")
+    render.add_argument("--workers", type=int, default=None, help="render processes (default: one per CPU)")
+    render.set_defaults(run=cmd_render)
+
+    qr = sub.add_parser("qr-decode", help="rebuild a prescription from its scanned QR codes")
+    qr.add_argument("files", nargs="+", help='files with one scanned code per line, or "-" for stdin')
+    qr.add_argument("--json", action="store_true", help="print the medication JSON instead of the text")
+    qr.set_defaults(run=cmd_qr_decode)
+
+    upload = sub.add_parser("upload", help="send schedules to dispensers concurrently")
+    upload.add_argument("jobs_list", nargs="+", metavar="ADDRESS=FILE", help='a job, or "-" to read jobs from stdin')
+    upload.add_argument("--jobs", type=int, default=4, help="uploads in flight at once")
+    upload.set_defaults(run=cmd_upload)
+
+    prov = sub.add_parser("provision", help="scan once, then provision many dispensers by name or address")
+    prov.add_argument("jobs_list", nargs="*", metavar="TARGET=FILE")
+    prov.add_argument("--manifest", help="file with one TARGET,FILE per line")
+    prov.add_argument("--jobs", type=int, default=4, help="dispensers connected at once")
+    prov.add_argument("--scan-timeout", type=float, default=dispenser_core.SCAN_TIMEOUT)
+    prov.add_argument("--report", help="write the summary and every device's report here as JSON")
+    prov.add_argument("--simulate", action="store_true", help="simulated dispensers instead of BLE")
+    prov.add_argument("--sim-loss", type=float, default=0.0, help="chance a simulated write is lost")
+    prov.add_argument("--sim-drops", type=int, default=0, help="connections each simulated device drops")
+    prov.set_defaults(run=cmd_provision)
+
+    args = parser.parse_args()
+    if getattr(args, "workers", None) is not None and args.workers < 1:
+        parser.error("--workers must be at least 1")
+    sys.exit(args.run(args))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,134 @@
+// String, Print and Stream for the host builds. Kept apart from Hal.cpp
+// so the unit tests can link src/ without the emulator behind it.
+#include <Arduino.h>
+
+/* ---- String ---- */
+
+String::String(const char *s) : buf(nullptr), len(0)
+{
+  concat(s, strlen(s));
+}
+
+String::String(const String &other) : buf(nullptr), len(0)
+{
+  concat(other.buf, other.len);
+}
+
+String::String(int value) : buf(nullptr), len(0)
+{
+  char digits[12];
+  snprintf(digits, sizeof(digits), "%d", value);
+  concat(digits, strlen(digits));
+}
+
+String::~String()
+{
+  free(buf);
+}
+
+String &String::operator=(const String &other)
+{
+  if (this != &other)
+  {
+    len = 0;
+    concat(other.buf, other.len);
+  }
+  return *this;
+}
+
+bool String::concat(const char *s, unsigned int n)
+{
+  char *grown = (char *)realloc(buf, len + n + 1);
+  if (!grown)
+    return false;
+  buf = grown;
+  memcpy(buf + len, s, n);
+  len += n;
+  buf[len] = '\0';
+  return true;
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+  if (to > len)
+    to = len;
+  if (from >= to)
+    return String();
+  String out;
+  out.concat(buf + from, to - from);
+  return out;
+}
+
+bool String::endsWith(const char *suffix) const
+{
+  size_t n = strlen(suffix);
+  return n <= len && memcmp(buf + len - n, suffix, n) == 0;
+}
+
+String &String::operator+=(char c)
+{
+  concat(&c, 1);
+  return *this;
+}
+
+String &String::operator+=(const char *s)
+{
+  concat(s, strlen(s));
+  return *this;
+}
+
+/* ---- Print, Stream ---- */
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (size--)
+    n += write(*buffer++);
+  return n;
+}
+
+size_t Print::print(long value, int base)
+{
+  if (value < 0 && base == DEC)
+    return print('-') + print((unsigned long)-value, base);
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+  char digits[24];
+  snprintf(digits, sizeof(digits), base == HEX ? "%lX" : "%lu", value);
+  return write(digits);
+}
+
+size_t Print::print(double value, int digits)
+{
+  char text[32];
+  snprintf(text, sizeof(text), "%.*f", digits, value);
+  return write(text);
+}
+
+int Stream::timedRead()
+{
+  unsigned long start = millis();
+  do
+  {
+    int c = read();
+    if (c >= 0)
+      return c;
+  } while (millis() - start < timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+  size_t count = 0;
+  while (count < length)
+  {
+    int c = timedRead();
+    if (c < 0)
+      break;
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
@@ -0,0 +1,233 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "Emulator.h"
+
+EmuOptions emuOptions;
+EmuCounters emuCounters;
+
+static uint64_t startUs = 0;
+static uint64_t skippedUs = 0;
+static int ptyMaster = -1;
+static int ptySlave = -1;              // Held open so the pty survives clients closing it
+
+static const char *const stageNames[STAGE_COUNT] = {"receive", "save", "load", "regroup"};
+
+struct StageClock
+{
+  uint64_t hostUs;
+  uint64_t clockUs;
+  unsigned long entries;
+  uint8_t depth;
+  uint64_t hostStart;
+  uint64_t clockStart;
+};
+
+// One pipeline runs from the first stage after a report to the end of
+// the regroup that makes the new schedule live
+static StageClock stages[STAGE_COUNT];
+static bool pipelineOpen = false;
+static bool reportDue = false;
+static unsigned long uploadsLive = 0;
+static uint64_t pipelineHost = 0;
+static uint64_t pipelineClock = 0;
+static EmuCounters pipelineCounters;
+
+uint64_t emuHostUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t now = (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+  if (startUs == 0)
+    startUs = now;
+  return now - startUs;
+}
+
+uint64_t emuClockUs()
+{
+  return emuHostUs() + skippedUs;
+}
+
+void emuSkip(uint64_t us)
+{
+  skippedUs += us;
+}
+
+bool emuOpenPty(char *path, size_t size)
+{
+  ptyMaster = posix_openpt(O_RDWR | O_NOCTTY);
+  if (ptyMaster < 0 || grantpt(ptyMaster) != 0 || unlockpt(ptyMaster) != 0)
+    return false;
+  const char *name = ptsname(ptyMaster);
+  if (!name)
+    return false;
+  snprintf(path, size, "%s", name);
+
+  ptySlave = open(name, O_RDWR | O_NOCTTY);
+  if (ptySlave < 0)
+    return false;
+  struct termios tio;
+  tcgetattr(ptySlave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(ptySlave, TCSANOW, &tio);
+
+  fcntl(ptyMaster, F_SETFL, fcntl(ptyMaster, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+size_t emuSerialFill(uint8_t *buffer, size_t size)
+{
+  if (ptyMaster < 0 || size == 0)
+    return 0;
+  ssize_t n = read(ptyMaster, buffer, size);
+  return n > 0 ? (size_t)n : 0;
+}
+
+void emuSerialWrite(const uint8_t *data, size_t len)
+{
+  emuCounters.serialOut += len;
+  while (len > 0 && ptyMaster >= 0)
+  {
+    ssize_t n = write(ptyMaster, data, len);
+    if (n < 0)
+    {
+      if (errno != EAGAIN)
+        return;
+      struct pollfd p = {ptyMaster, POLLOUT, 0};
+      poll(&p, 1, 10);
+      continue;
+    }
+    data += n;
+    len -= n;
+  }
+}
+
+// Gives the client up to a second to read the last reply before the pty goes
+void emuClosePty()
+{
+  for (int i = 0; i < 100 && ptySlave >= 0; i++)
+  {
+    int pending = 0;
+    if (ioctl(ptySlave, FIONREAD, &pending) != 0 || pending == 0)
+      break;
+    usleep(10000);
+  }
+  close(ptyMaster);
+  close(ptySlave);
+  ptyMaster = ptySlave = -1;
+}
+
+void emuWaitForSerial(int timeoutMs)
+{
+  struct pollfd p = {ptyMaster, POLLIN, 0};
+  poll(&p, 1, timeoutMs);
+}
+
+static void openPipeline()
+{
+  memset(stages, 0, sizeof(stages));
+  pipelineOpen = true;
+  pipelineHost = emuHostUs();
+  pipelineClock = emuClockUs();
+  pipelineCounters = emuCounters;
+}
+
+void stageBegin(uint8_t stage)
+{
+  if (stage >= STAGE_COUNT)
+    return;
+
+  // A new upload starts a new pipeline, unless the last one is still
+  // receiving: a resumed upload keeps adding to the same report. One
+  // that follows within the same loop() pass flushes the last report.
+  if (reportDue && stage == STAGE_RECEIVE)
+    emuReport();
+  if (!pipelineOpen || (stage == STAGE_RECEIVE && stages[STAGE_LOAD].entries > 0))
+    openPipeline();
+
+  StageClock &s = stages[stage];
+  if (s.depth > 0 && stage == STAGE_RECEIVE)
+    s.depth = 0;                       // The previous attempt never finished
+  if (s.depth++ == 0)
+  {
+    s.hostStart = emuHostUs();
+    s.clockStart = emuClockUs();
+  }
+}
+
+void stageEnd(uint8_t stage)
+{
+  if (stage >= STAGE_COUNT || !pipelineOpen)
+    return;
+
+  StageClock &s = stages[stage];
+  if (s.depth == 0 || --s.depth > 0)
+    return;
+  s.hostUs += emuHostUs() - s.hostStart;
+  s.clockUs += emuClockUs() - s.clockStart;
+  s.entries++;
+  if (stage == STAGE_REGROUP)
+    reportDue = true;
+}
+
+bool emuReportDue()
+{
+  return reportDue;
+}
+
+unsigned long emuUploadsLive()
+{
+  return uploadsLive;
+}
+
+// Normally called between loop() passes, so the total covers the reply
+// the firmware sends once the schedule is live
+void emuReport()
+{
+  reportDue = false;
+  pipelineOpen = false;
+
+  uint64_t totalHost = emuHostUs() - pipelineHost;
+  uint64_t totalClock = emuClockUs() - pipelineClock;
+  EmuCounters d;
+  d.serialIn = emuCounters.serialIn - pipelineCounters.serialIn;
+  d.serialOut = emuCounters.serialOut - pipelineCounters.serialOut;
+  d.sdRead = emuCounters.sdRead - pipelineCounters.sdRead;
+  d.sdWritten = emuCounters.sdWritten - pipelineCounters.sdWritten;
+  d.sdSyncs = emuCounters.sdSyncs - pipelineCounters.sdSyncs;
+  d.pixels = emuCounters.pixels - pipelineCounters.pixels;
+  bool upload = stages[STAGE_RECEIVE].entries > 0;
+  if (upload)
+    uploadsLive++;
+
+  printf("%s: schedule live after %.1f ms firmware time, %.1f ms of it in delay()\n",
+         upload ? "Upload" : "Load", totalClock / 1000.0, (totalClock - totalHost) / 1000.0);
+  printf("  %-8s %11s %13s %8s\n", "stage", "host ms", "firmware ms", "entries");
+  for (uint8_t i = 0; i < STAGE_COUNT; i++)
+  {
+    const StageClock &s = stages[i];
+    printf("  %-8s %11.3f %13.3f %8lu\n", stageNames[i], s.hostUs / 1000.0, s.clockUs / 1000.0, s.entries);
+  }
+  printf("  Serial1 %lu B in, %lu B out; SD %lu B written, %lu B read, %lu syncs; display %lu px\n",
+         d.serialIn, d.serialOut, d.sdWritten, d.sdRead, d.sdSyncs, d.pixels);
+  fflush(stdout);
+
+  FILE *f = emuOptions.statsPath ? fopen(emuOptions.statsPath, "a") : nullptr;
+  if (!f)
+    return;
+  fprintf(f, "{\"kind\": \"%s\", \"total_ms\": %.3f, \"delay_ms\": %.3f", upload ? "upload" : "load",
+          totalClock / 1000.0, (totalClock - totalHost) / 1000.0);
+  for (uint8_t i = 0; i < STAGE_COUNT; i++)
+    fprintf(f, ", \"%s_ms\": %.3f, \"%s_host_ms\": %.3f", stageNames[i], stages[i].clockUs / 1000.0,
+            stageNames[i], stages[i].hostUs / 1000.0);
+  fprintf(f, ", \"serial_in\": %lu, \"serial_out\": %lu, \"sd_written\": %lu, \"sd_read\": %lu, \"sd_syncs\": %lu}\n",
+          d.serialIn, d.serialOut, d.sdWritten, d.sdRead, d.sdSyncs);
+  fclose(f);
+}
@@ -0,0 +1,47 @@
+// Host side of the firmware emulator: clock, the Serial1 pty and the
+// per-stage accounting behind StageTrace.h
+#ifndef EMULATOR_H
+#define EMULATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "StageTrace.h"
+
+struct EmuOptions
+{
+  const char *sdDir = "emu_sd";      // Directory standing in for the SD card
+  const char *linkPath = nullptr;    // Symlink to the pty, for a stable path
+  const char *statsPath = nullptr;   // Append one JSON line per report
+  bool realDelays = false;           // delay() sleeps instead of moving the clock on
+  bool verbose = false;              // Echo the firmware's Serial output
+  unsigned long exitAfter = 0;       // Quit after this many uploads were reported
+};
+
+struct EmuCounters
+{
+  unsigned long serialIn;            // Bytes the firmware read from Serial1
+  unsigned long serialOut;
+  unsigned long sdRead;
+  unsigned long sdWritten;
+  unsigned long sdSyncs;
+  unsigned long pixels;              // Pixels the display would have been sent
+};
+
+extern EmuOptions emuOptions;
+extern EmuCounters emuCounters;
+
+uint64_t emuHostUs();                // Host monotonic time
+uint64_t emuClockUs();               // Firmware time: host time plus skipped delay()s
+void emuSkip(uint64_t us);
+
+bool emuOpenPty(char *path, size_t size);
+size_t emuSerialFill(uint8_t *buffer, size_t size); // Non-blocking pty read
+void emuSerialWrite(const uint8_t *data, size_t len);
+void emuWaitForSerial(int timeoutMs);
+void emuClosePty();
+
+bool emuReportDue();                 // A schedule finished loading since the last report
+void emuReport();
+unsigned long emuUploadsLive();
+
+#endif
@@ -0,0 +1,559 @@
+// Fake Arduino HAL for the firmware emulator. Only what src/ uses.
+#include <errno.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include "Emulator.h"
+#include <Arduino.h>
+#include <Adafruit_ST7789.h>
+#include <EEPROM.h>
+#include <RTClib.h>
+#include <SdFat.h>
+#include <SPI.h>
+#include <StreamUtils.h>
+
+#define SERIAL_RX_BUFFER_SIZE 64     // Same as the AVR core
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+SPIClass SPI;
+EEPROMClass EEPROM;
+
+/* ---- Time, pins ---- */
+
+unsigned long millis()
+{
+  return emuClockUs() / 1000;
+}
+
+unsigned long micros()
+{
+  return emuClockUs();
+}
+
+void delay(unsigned long ms)
+{
+  if (emuOptions.realDelays)
+    usleep(ms * 1000);
+  else
+    emuSkip((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  emuSkip(us);
+}
+
+static uint8_t pinLevels[70];
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (pin < sizeof(pinLevels) && mode == INPUT_PULLUP)
+    pinLevels[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  if (pin < sizeof(pinLevels))
+    pinLevels[pin] = value;
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pin < sizeof(pinLevels) ? pinLevels[pin] : LOW;
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+  digitalWrite(pin, value > 127 ? HIGH : LOW);
+}
+
+int analogRead(uint8_t pin)
+{
+  (void)pin;
+  return 0;
+}
+
+long random(long howBig)
+{
+  return howBig > 0 ? rand() % howBig : 0;
+}
+
+long random(long howSmall, long howBig)
+{
+  return howBig > howSmall ? howSmall + random(howBig - howSmall) : howSmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+  srand(seed);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+/* ---- Serial: stdout, and Serial1 on the pty behind a 64-byte ring ---- */
+
+static uint8_t rxRing[SERIAL_RX_BUFFER_SIZE];
+static size_t rxHead = 0;
+static size_t rxCount = 0;
+
+static void fillRing()
+{
+  if (rxCount == 0)
+    rxHead = 0;
+  if (rxHead > 0 && rxHead + rxCount == SERIAL_RX_BUFFER_SIZE)
+  {
+    memmove(rxRing, rxRing + rxHead, rxCount);
+    rxHead = 0;
+  }
+  size_t tail = rxHead + rxCount;
+  rxCount += emuSerialFill(rxRing + tail, SERIAL_RX_BUFFER_SIZE - tail);
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  if (port == 1)
+    emuSerialWrite(buffer, size);
+  else if (emuOptions.verbose)
+    fwrite(buffer, 1, size, stdout);
+  return size;
+}
+
+int HardwareSerial::available()
+{
+  if (port != 1)
+    return 0;
+  fillRing();
+  return rxCount;
+}
+
+int HardwareSerial::read()
+{
+  if (available() == 0)
+    return -1;
+  uint8_t c = rxRing[rxHead++];
+  rxCount--;
+  emuCounters.serialIn++;
+  return c;
+}
+
+int HardwareSerial::peek()
+{
+  return available() ? rxRing[rxHead] : -1;
+}
+
+/* ---- SdFat on a host directory ---- */
+
+struct EmuFileHandle
+{
+  FILE *fp;
+  int refs;
+  bool readable;
+  bool writable;
+  bool append;
+};
+
+static std::string sdPath(const char *path)
+{
+  while (*path == '/')
+    path++;
+  return std::string(emuOptions.sdDir) + "/" + path;
+}
+
+bool SdFat::begin(uint8_t csPin, uint32_t speed)
+{
+  (void)csPin;
+  (void)speed;
+  struct stat st;
+  if (stat(emuOptions.sdDir, &st) != 0)
+    mkdir(emuOptions.sdDir, 0755);
+  return stat(emuOptions.sdDir, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool SdFat::exists(const char *path)
+{
+  struct stat st;
+  return stat(sdPath(path).c_str(), &st) == 0;
+}
+
+bool SdFat::remove(const char *path)
+{
+  return unlink(sdPath(path).c_str()) == 0;
+}
+
+// FAT rename fails if the new name exists, unlike POSIX
+bool SdFat::rename(const char *oldPath, const char *newPath)
+{
+  if (exists(newPath))
+    return false;
+  return ::rename(sdPath(oldPath).c_str(), sdPath(newPath).c_str()) == 0;
+}
+
+File SdFat::open(const char *path, int oflag)
+{
+  std::string full = sdPath(path);
+  bool write = (oflag & (O_WRONLY | O_RDWR)) != 0;
+  if (!exists(path) && !(write && (oflag & O_CREAT)))
+    return File();
+
+  FILE *fp;
+  if (!write)
+    fp = fopen(full.c_str(), "rb");
+  else if ((oflag & O_TRUNC) || !exists(path))
+    fp = fopen(full.c_str(), "w+b");
+  else
+    fp = fopen(full.c_str(), "r+b");
+  if (!fp)
+    return File();
+
+  EmuFileHandle *h = new EmuFileHandle{fp, 1, (oflag & O_WRONLY) == 0, write, (oflag & O_APPEND) != 0};
+  if (oflag & O_AT_END)
+    fseek(fp, 0, SEEK_END);
+  return File(h);
+}
+
+File::File(const File &other) : Stream(other), handle(other.handle)
+{
+  if (handle)
+    handle->refs++;
+}
+
+File &File::operator=(const File &other)
+{
+  if (this != &other)
+  {
+    release();
+    handle = other.handle;
+    if (handle)
+      handle->refs++;
+  }
+  return *this;
+}
+
+File::~File()
+{
+  release();
+}
+
+void File::release()
+{
+  if (handle && --handle->refs == 0)
+  {
+    if (handle->fp)
+      fclose(handle->fp);
+    delete handle;
+  }
+  handle = nullptr;
+}
+
+File::operator bool() const
+{
+  return handle && handle->fp;
+}
+
+void File::close()
+{
+  if (*this)
+  {
+    fclose(handle->fp);
+    handle->fp = nullptr;
+  }
+}
+
+size_t File::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buffer, size_t size)
+{
+  if (!*this || !handle->writable)
+    return 0;
+  // stdio needs a seek between reads and writes on the same stream
+  fseek(handle->fp, handle->append ? 0 : ftell(handle->fp), handle->append ? SEEK_END : SEEK_SET);
+  size_t n = fwrite(buffer, 1, size, handle->fp);
+  emuCounters.sdWritten += n;
+  return n;
+}
+
+int File::read()
+{
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::read(void *buffer, size_t size)
+{
+  if (!*this || !handle->readable)
+    return -1;
+  fseek(handle->fp, ftell(handle->fp), SEEK_SET);
+  size_t n = fread(buffer, 1, size, handle->fp);
+  emuCounters.sdRead += n;
+  return (int)n;
+}
+
+int File::peek()
+{
+  if (!*this)
+    return -1;
+  int c = fgetc(handle->fp);
+  if (c != EOF)
+    ungetc(c, handle->fp);
+  return c == EOF ? -1 : c;
+}
+
+int File::available()
+{
+  if (!*this)
+    return 0;
+  uint32_t left = size() - position();
+  return left > 0x7FFF ? 0x7FFF : left;
+}
+
+bool File::sync()
+{
+  if (!*this)
+    return false;
+  emuCounters.sdSyncs++;
+  return fflush(handle->fp) == 0;
+}
+
+uint32_t File::size() const
+{
+  if (!*this)
+    return 0;
+  fflush(handle->fp);
+  struct stat st;
+  return fstat(fileno(handle->fp), &st) == 0 ? st.st_size : 0;
+}
+
+uint32_t File::position() const
+{
+  return *this ? ftell(handle->fp) : 0;
+}
+
+bool File::seekSet(uint32_t pos)
+{
+  if (!*this || pos > size())
+    return false;
+  return fseek(handle->fp, pos, SEEK_SET) == 0;
+}
+
+bool File::truncate(uint32_t length)
+{
+  if (!*this || !handle->writable)
+    return false;
+  fflush(handle->fp);
+  return ftruncate(fileno(handle->fp), length) == 0;
+}
+
+/* ---- StreamUtils ---- */
+
+ReadBufferingStream::ReadBufferingStream(Stream &upstream, size_t capacity)
+    : upstream(upstream), data(new char[capacity]), capacity(capacity), begin(0), end(0)
+{
+}
+
+ReadBufferingStream::~ReadBufferingStream()
+{
+  delete[] data;
+}
+
+// Only asks upstream for what it has, so the tail of a file doesn't sit
+// out Stream's read timeout
+bool ReadBufferingStream::refill()
+{
+  if (begin < end)
+    return true;
+  int ready = upstream.available();
+  if (ready <= 0)
+    return false;
+  begin = 0;
+  end = upstream.readBytes(data, (size_t)ready < capacity ? (size_t)ready : capacity);
+  return end > 0;
+}
+
+int ReadBufferingStream::read()
+{
+  return refill() ? (uint8_t)data[begin++] : -1;
+}
+
+int ReadBufferingStream::peek()
+{
+  return refill() ? (uint8_t)data[begin] : -1;
+}
+
+/* ---- Display: counts pixels, draws nothing ---- */
+
+static void countPixels(int32_t w, int32_t h)
+{
+  if (w > 0 && h > 0)
+    emuCounters.pixels += (unsigned long)w * h;
+}
+
+size_t Adafruit_GFX::write(uint8_t c)
+{
+  if (c == '\n')
+  {
+    cursor_x = 0;
+    cursor_y += 8 * textsize;
+  }
+  else if (c != '\r')
+  {
+    countPixels(6 * textsize, 8 * textsize);
+    cursor_x += 6 * textsize;
+  }
+  return 1;
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  (void)x;
+  (void)y;
+  (void)color;
+  countPixels(w, h);
+}
+
+void Adafruit_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+{
+  (void)color;
+  countPixels(max(abs(x1 - x0), abs(y1 - y0)) + 1, 1);
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  (void)x;
+  (void)y;
+  (void)color;
+  countPixels(2 * (w + h), 1);
+}
+
+void Adafruit_GFX::fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color)
+{
+  (void)r;
+  fillRect(x, y, w, h, color);
+}
+
+void Adafruit_GFX::drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color)
+{
+  (void)r;
+  drawRect(x, y, w, h, color);
+}
+
+void Adafruit_GFX::fillCircle(int16_t x, int16_t y, int16_t r, uint16_t color)
+{
+  (void)x;
+  (void)y;
+  (void)color;
+  countPixels(2 * r + 1, 2 * r + 1);
+}
+
+void Adafruit_GFX::setRotation(uint8_t r)
+{
+  rotation = r & 3;
+  _width = (rotation & 1) ? HEIGHT : WIDTH;
+  _height = (rotation & 1) ? WIDTH : HEIGHT;
+}
+
+void Adafruit_SPITFT::writeColor(uint16_t color, uint32_t len)
+{
+  (void)color;
+  countPixels(len, 1);
+}
+
+void Adafruit_SPITFT::sendCommand(uint8_t command, const uint8_t *data, uint8_t len)
+{
+  (void)command;
+  (void)data;
+  (void)len;
+}
+
+void Adafruit_ST77xx::setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  (void)x;
+  (void)y;
+  (void)w;
+  (void)h;
+}
+
+void Adafruit_ST7789::init(uint16_t width, uint16_t height, uint8_t spiMode)
+{
+  (void)spiMode;
+  WIDTH = width;
+  HEIGHT = height;
+  setRotation(0);
+}
+
+void Adafruit_ST7789::setRotation(uint8_t r)
+{
+  Adafruit_GFX::setRotation(r);
+}
+
+/* ---- RTC ---- */
+
+static const uint32_t SECONDS_PER_DAY = 86400UL;
+
+// Days since 1970-01-01 (civil calendar, valid from 1970 on)
+static uint32_t daysFromCivil(uint16_t y, uint8_t m, uint8_t d)
+{
+  int32_t yy = y - (m <= 2);
+  int32_t era = yy / 400;
+  uint32_t yoe = yy - era * 400;
+  uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+DateTime::DateTime(uint32_t unixTime)
+{
+  uint32_t days = unixTime / SECONDS_PER_DAY;
+  uint32_t secs = unixTime % SECONDS_PER_DAY;
+  hh = secs / 3600;
+  mm = secs / 60 % 60;
+  ss = secs % 60;
+
+  int32_t z = days + 719468;
+  int32_t era = z / 146097;
+  uint32_t doe = z - era * 146097;
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  y = yoe + era * 400 + (m <= 2);
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec)
+    : y(year), m(month), d(day), hh(hour), mm(min), ss(sec)
+{
+}
+
+uint32_t DateTime::unixtime() const
+{
+  return daysFromCivil(y, m, d) * SECONDS_PER_DAY + hh * 3600UL + mm * 60UL + ss;
+}
+
+uint8_t DateTime::dayOfTheWeek() const
+{
+  return (daysFromCivil(y, m, d) + 4) % 7;   // 1970-01-01 was a Thursday
+}
+
+void RTC_DS3231::adjust(const DateTime &dt)
+{
+  setTo = dt.unixtime();
+  setAt = millis();
+}
+
+DateTime RTC_DS3231::now()
+{
+  return DateTime(setTo + (millis() - setAt) / 1000);
+}
@@ -0,0 +1,23 @@
+#ifndef EMU_ADAFRUIT_SPITFT_H
+#define EMU_ADAFRUIT_SPITFT_H
+
+#include <Adafruit_GFX.h>
+#include <SPI.h>
+
+class Adafruit_SPITFT : public Adafruit_GFX
+{
+public:
+  Adafruit_SPITFT(uint16_t w, uint16_t h) : Adafruit_GFX(w, h) {}
+
+  virtual void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) = 0;
+  void startWrite() {}
+  void endWrite() {}
+  void writeColor(uint16_t color, uint32_t len);
+  void sendCommand(uint8_t command, const uint8_t *data = nullptr, uint8_t len = 0);
+  uint16_t color565(uint8_t r, uint8_t g, uint8_t b)
+  {
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+  }
+};
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef EMU_ADAFRUIT_ST7789_H
+#define EMU_ADAFRUIT_ST7789_H
+
+#include <Adafruit_ST77xx.h>
+
+class Adafruit_ST7789 : public Adafruit_ST77xx
+{
+public:
+  Adafruit_ST7789(int8_t cs, int8_t dc, int8_t rst) : Adafruit_ST77xx(240, 320)
+  {
+    (void)cs;
+    (void)dc;
+    (void)rst;
+  }
+  void init(uint16_t width, uint16_t height, uint8_t spiMode = SPI_MODE0);
+  void setRotation(uint8_t r) override;
+};
+
+#endif
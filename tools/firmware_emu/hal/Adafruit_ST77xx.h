@@ -0,0 +1,25 @@
+#ifndef EMU_ADAFRUIT_ST77XX_H
+#define EMU_ADAFRUIT_ST77XX_H
+
+#include <Adafruit_SPITFT.h>
+
+#define ST77XX_BLACK 0x0000
+#define ST77XX_WHITE 0xFFFF
+#define ST77XX_RED 0xF800
+#define ST77XX_GREEN 0x07E0
+#define ST77XX_BLUE 0x001F
+#define ST77XX_CYAN 0x07FF
+#define ST77XX_MAGENTA 0xF81F
+#define ST77XX_YELLOW 0xFFE0
+#define ST77XX_ORANGE 0xFC00
+
+class Adafruit_ST77xx : public Adafruit_SPITFT
+{
+public:
+  Adafruit_ST77xx(uint16_t w, uint16_t h) : Adafruit_SPITFT(w, h) {}
+  void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) override;
+  void enableDisplay(bool enable) { (void)enable; }
+  void enableSleep(bool enable) { (void)enable; }
+};
+
+#endif
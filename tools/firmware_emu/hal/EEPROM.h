@@ -0,0 +1,35 @@
+// Host stand-in for the AVR EEPROM library: 4 KB in RAM, starts erased
+#ifndef EMU_EEPROM_H
+#define EMU_EEPROM_H
+
+#include <Arduino.h>
+
+class EEPROMClass
+{
+public:
+  EEPROMClass() { memset(cells, 0xFF, sizeof(cells)); }
+
+  template <typename T>
+  T &get(int address, T &value)
+  {
+    memcpy(&value, cells + address, sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  const T &put(int address, const T &value)
+  {
+    memcpy(cells + address, &value, sizeof(T));
+    return value;
+  }
+
+  uint8_t read(int address) { return cells[address]; }
+  void update(int address, uint8_t value) { cells[address] = value; }
+  uint16_t length() { return sizeof(cells); }
+
+  uint8_t cells[4096];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,41 @@
+// Host stand-in for RTClib: the DS3231 counts from its last adjust() on
+// the emulator's clock, so delays skipped by the emulator still pass
+#ifndef EMU_RTCLIB_H
+#define EMU_RTCLIB_H
+
+#include <Arduino.h>
+
+class DateTime
+{
+public:
+  DateTime(uint32_t unixTime = 946684800UL);
+  DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0);
+
+  uint16_t year() const { return y; }
+  uint8_t month() const { return m; }
+  uint8_t day() const { return d; }
+  uint8_t hour() const { return hh; }
+  uint8_t minute() const { return mm; }
+  uint8_t second() const { return ss; }
+  uint8_t dayOfTheWeek() const;
+  uint32_t unixtime() const;
+
+private:
+  uint16_t y;
+  uint8_t m, d, hh, mm, ss;
+};
+
+class RTC_DS3231
+{
+public:
+  bool begin() { return true; }
+  void adjust(const DateTime &dt);
+  DateTime now();
+  bool lostPower() { return false; }
+
+private:
+  uint32_t setTo = 946684800UL;
+  unsigned long setAt = 0;
+};
+
+#endif
@@ -0,0 +1,24 @@
+// SPI is not used on the host; the SD card and display are emulated above it
+#ifndef EMU_SPI_H
+#define EMU_SPI_H
+
+#include <Arduino.h>
+
+#define SPI_CLOCK_DIV2 0x04
+#define SPI_CLOCK_DIV4 0x00
+#define SPI_CLOCK_DIV64 0x02
+#define SPI_MODE0 0x00
+#define MSBFIRST 1
+
+class SPIClass
+{
+public:
+  void begin() {}
+  uint8_t transfer(uint8_t data) { return data; }
+  void setClockDivider(uint8_t divider) { (void)divider; }
+  void setDataMode(uint8_t mode) { (void)mode; }
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,67 @@
+// Host stand-in for SdFat: the card is a directory on the host (--sd).
+// Like FAT, a file can't be seeked past its end.
+#ifndef EMU_SDFAT_H
+#define EMU_SDFAT_H
+
+#include <Arduino.h>
+
+#define O_RDONLY 0x00
+#define O_WRONLY 0x01
+#define O_RDWR 0x02
+#define O_AT_END 0x04
+#define O_APPEND 0x08
+#define O_CREAT 0x10
+#define O_TRUNC 0x20
+#define O_READ O_RDONLY
+#define O_WRITE O_WRONLY
+#define FILE_READ O_RDONLY
+#define FILE_WRITE (O_RDWR | O_CREAT | O_AT_END)
+#define SPI_HALF_SPEED 1
+
+struct EmuFileHandle;
+
+class File : public Stream
+{
+public:
+  File() : handle(nullptr) {}
+  File(const File &other);
+  File &operator=(const File &other);
+  ~File();
+
+  operator bool() const;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int read(void *buffer, size_t size);
+  int peek() override;
+  void flush() override { sync(); }
+  bool sync();
+  void close();
+  uint32_t size() const;
+  uint32_t position() const;
+  uint32_t curPosition() const { return position(); }
+  bool seek(uint32_t pos) { return seekSet(pos); }
+  bool seekSet(uint32_t pos);
+  bool truncate(uint32_t length);
+
+private:
+  friend class SdFat;
+  explicit File(EmuFileHandle *handle) : handle(handle) {}
+  void release();
+
+  EmuFileHandle *handle;
+};
+
+class SdFat
+{
+public:
+  bool begin(uint8_t csPin, uint32_t speed);
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool rename(const char *oldPath, const char *newPath);
+  File open(const char *path, int oflag = O_RDONLY);
+};
+
+#endif
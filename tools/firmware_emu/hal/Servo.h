@@ -0,0 +1,44 @@
+// Host stand-in for lib/Servo: moves finish at once, nothing is driven
+#ifndef EMU_SERVO_H
+#define EMU_SERVO_H
+
+#include <Arduino.h>
+
+typedef void (*ServoMoveCallback)(uint8_t servoIndex);
+
+class Servo
+{
+public:
+  uint8_t attach(int pin)
+  {
+    attachedPin = pin;
+    return 0;
+  }
+  void detach() { attachedPin = -1; }
+  void write(int value) { position = value; }
+  void writeMicroseconds(int value) { (void)value; }
+  bool attached() { return attachedPin >= 0; }
+
+  void moveTo(int value, int maxSpeed, int accel, ServoMoveCallback onComplete = nullptr)
+  {
+    (void)maxSpeed;
+    (void)accel;
+    position = value;
+    if (onComplete)
+      onComplete(0);
+  }
+  void sweepTo(int value, int maxSpeed, int accel, unsigned int holdMs, int returnValue,
+               ServoMoveCallback onComplete = nullptr)
+  {
+    (void)value;
+    (void)holdMs;
+    moveTo(returnValue, maxSpeed, accel, onComplete);
+  }
+  bool moving() { return false; }
+
+private:
+  int attachedPin = -1;
+  int position = 90;
+};
+
+#endif
@@ -0,0 +1,28 @@
+// Host stand-in for StreamUtils' ReadBufferingStream
+#ifndef EMU_STREAMUTILS_H
+#define EMU_STREAMUTILS_H
+
+#include <Arduino.h>
+
+class ReadBufferingStream : public Stream
+{
+public:
+  ReadBufferingStream(Stream &upstream, size_t capacity);
+  ~ReadBufferingStream();
+
+  size_t write(uint8_t c) override { return upstream.write(c); }
+  int available() override { return (int)(end - begin) + upstream.available(); }
+  int read() override;
+  int peek() override;
+
+private:
+  bool refill();
+
+  Stream &upstream;
+  char *data;
+  size_t capacity;
+  size_t begin;
+  size_t end;
+};
+
+#endif
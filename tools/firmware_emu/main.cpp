@@ -0,0 +1,114 @@
+/*
+ * Firmware emulator.
+ *
+ * Runs src/main.cpp natively, setup() and then loop() forever, against a
+ * fake HAL: Serial1 is a pseudo-terminal, the SD card is a host directory,
+ * and the display and servos do nothing. The desktop app streams
+ * schedules into it end to end exactly as it would through the BLE module:
+ *
+ *   pio run -e native_emu && .pio/build/native_emu/program --link /tmp/dispenser
+ *   DISPENSER_SERIAL=/tmp/dispenser python src/test.py
+ *
+ * Each time a schedule goes live (at boot, after an upload or after an
+ * edit batch) it prints how long the receive, SD save, load and regroup
+ * stages took, marked in the firmware with StageTrace.h. Firmware time
+ * includes the delay() calls the emulator skips; host time is what the
+ * code itself took on this machine, not on the Mega.
+ *
+ * Options:
+ *   --sd DIR         directory standing in for the SD card (default emu_sd)
+ *   --link PATH      also make PATH a symlink to the pty
+ *   --stats FILE     append every report to FILE as a JSON line
+ *   --exit-after N   quit once N uploads have gone live
+ *   --real-delays    let delay() sleep instead of skipping ahead
+ *   --verbose        print the firmware's Serial output
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Emulator.h"
+#include <Arduino.h>
+
+void setup();
+void loop();
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int)
+{
+  stopRequested = 1;
+}
+
+static bool parseOptions(int argc, char **argv, EmuOptions &opt)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(arg, "--verbose"))
+      opt.verbose = true;
+    else if (!strcmp(arg, "--real-delays"))
+      opt.realDelays = true;
+    else if (value && !strcmp(arg, "--sd"))
+      opt.sdDir = argv[++i];
+    else if (value && !strcmp(arg, "--link"))
+      opt.linkPath = argv[++i];
+    else if (value && !strcmp(arg, "--stats"))
+      opt.statsPath = argv[++i];
+    else if (value && !strcmp(arg, "--exit-after"))
+      opt.exitAfter = strtoul(argv[++i], nullptr, 10);
+    else
+    {
+      fprintf(stderr, "unknown option %s (see the comment at the top of main.cpp)\n", arg);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  if (!parseOptions(argc, argv, emuOptions))
+    return 2;
+
+  char path[64];
+  if (!emuOpenPty(path, sizeof(path)))
+  {
+    perror("pty");
+    return 1;
+  }
+  if (emuOptions.linkPath)
+  {
+    unlink(emuOptions.linkPath);
+    if (symlink(path, emuOptions.linkPath) != 0)
+    {
+      perror(emuOptions.linkPath);
+      return 1;
+    }
+  }
+  printf("Serial1 on %s%s%s, SD card in %s/\n", path, emuOptions.linkPath ? " -> " : "",
+         emuOptions.linkPath ? emuOptions.linkPath : "", emuOptions.sdDir);
+  fflush(stdout);
+
+  signal(SIGINT, requestStop);
+  signal(SIGTERM, requestStop);
+
+  setup();
+  while (!stopRequested)
+  {
+    if (emuReportDue())
+      emuReport();
+    if (emuOptions.exitAfter && emuUploadsLive() >= emuOptions.exitAfter)
+      break;
+    loop();
+    if (!emuReportDue() && Serial1.available() == 0)
+      emuWaitForSerial(1);
+  }
+
+  emuClosePty();
+  if (emuOptions.linkPath)
+    unlink(emuOptions.linkPath);
+  return 0;
+}
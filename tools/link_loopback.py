@@ -0,0 +1,242 @@
+"""Firmware stand-in on a pseudo-terminal, for benchmarking the upload link.
+
+The stand-in speaks the device side of the framed upload protocol
+(include/UploadLink.h) behind a model of the real path into the Mega:
+
+    host writes -> BLE air (--air-rate B/s) -> module buffer (--module-buffer)
+                -> UART 115200 8N1 -> 64-byte Serial1 ring -> loop()
+
+Bytes that overflow the module buffer or the Serial1 ring are lost, and
+loop() stops draining the ring while it writes a chunk to SD (--sd-ms)
+or the resume map (--map-ms every 8 chunks), just like the firmware.
+Replies come back after --reply-ms. The pty merges the host's writes,
+so the stand-in cannot see write boundaries and --write-size changes
+nothing here; on BLE each write is one ATT packet and the MTU matters.
+
+Usage:
+    python tools/link_loopback.py serve          # prints a pty path; use it as
+                                                 # DISPENSER_SERIAL for src/test.py
+    python tools/link_loopback.py bench --size 8192 --write-size 20
+"""
+
+import argparse
+import asyncio
+import os
+import pty
+import random
+import struct
+import sys
+import time
+import tty
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "src"))
+
+import dispenser_link as link  # noqa: E402
+
+UART_RATE = 115200 / 10        # Bytes per second through 8N1
+SERIAL_RING = 64               # Arduino Serial1 receive buffer
+MAP_SAVE_EVERY = 8             # LINK_MAP_SAVE_EVERY
+MAX_CHUNKS = 256               # LINK_MAX_CHUNKS
+
+
+class StandIn:
+    """Device side of the upload protocol over a pty master."""
+
+    def __init__(self, fd, args):
+        self.fd = fd
+        self.args = args
+        self.parser = link.FrameParser()
+        self.air = bytearray()         # Written by the host, not yet over the air
+        self.module = bytearray()      # In the BLE module, waiting for the UART
+        self.ring = bytearray()        # Serial1 receive buffer
+        self.busy_until = 0.0
+        self.lost_bytes = 0
+        self.session = None
+        self.last_tick = time.monotonic()
+        self.air_credit = 0.0
+        self.uart_credit = 0.0
+
+    def start(self):
+        loop = asyncio.get_running_loop()
+        loop.add_reader(self.fd, self._readable)
+        self.task = loop.create_task(self._run())
+
+    def stop(self):
+        asyncio.get_running_loop().remove_reader(self.fd)
+        self.task.cancel()
+
+    def _readable(self):
+        try:
+            self.air += os.read(self.fd, 4096)
+        except OSError:
+            pass
+
+    def _reply(self, frame_type, seq, payload=b""):
+        frame = link.build_frame(frame_type, seq, payload)
+        asyncio.get_running_loop().call_later(self.args.reply_ms / 1000, self._write, frame)
+
+    def _write(self, data):
+        try:
+            os.write(self.fd, data)
+        except OSError:
+            pass
+
+    def _move(self, src, dst, count, limit):
+        count = min(count, len(src))
+        moved = src[:count]
+        del src[:count]
+        room = max(limit - len(dst), 0)
+        dst += moved[:room]
+        self.lost_bytes += max(len(moved) - room, 0)
+
+    async def _run(self):
+        while True:
+            await asyncio.sleep(0.001)
+            now = time.monotonic()
+            dt = now - self.last_tick
+            self.last_tick = now
+
+            # Links idle with nothing queued don't bank time for a later burst
+            self.air_credit = self.air_credit + dt * self.args.air_rate if self.air else 0.0
+            air = int(self.air_credit)
+            self.air_credit -= air
+            self._move(self.air, self.module, air, self.args.module_buffer)
+
+            self.uart_credit = self.uart_credit + dt * UART_RATE if self.module else 0.0
+            uart = int(self.uart_credit)
+            self.uart_credit -= uart
+
+            # Bytes arrive one at a time; loop() keeps up with the UART
+            # unless a frame made it busy, and then the ring fills up
+            for _ in range(min(uart, len(self.module))):
+                self._move(self.module, self.ring, 1, SERIAL_RING)
+                self._drain()
+            self._drain()
+
+    def _drain(self):
+        while self.ring and time.monotonic() >= self.busy_until:
+            byte = bytes(self.ring[:1])
+            del self.ring[:1]
+            for frame in self.parser.feed(byte):
+                self._handle(*frame)
+
+    def _handle(self, frame_type, seq, payload):
+        s = self.session
+        if frame_type == link.BEGIN:
+            size, crc, chunk = struct.unpack_from("<IHB", payload)
+            if s is None or s["key"] != (size, crc, chunk):
+                count = (size + chunk - 1) // chunk
+                if count > MAX_CHUNKS:
+                    self._reply(link.DONE, 0, bytes([1, 0, 0]))
+                    return
+                s = self.session = {"key": (size, crc, chunk), "size": size, "crc": crc, "chunk": chunk,
+                                    "count": count, "data": bytearray(size), "have": [False] * count,
+                                    "expected": 0, "nak": False, "since_save": 0}
+                self.busy_until = time.monotonic() + self.args.sd_ms * count / 1000
+            self._reply(link.ACK, s["expected"], self._resume(s))
+        elif s is None:
+            if frame_type in (link.END, link.DELTA):
+                self._reply(link.DONE, seq, bytes([5, 0, 0]))
+        elif frame_type == link.DATA and seq < s["count"]:
+            if not s["have"][seq]:
+                s["data"][seq * s["chunk"]:seq * s["chunk"] + len(payload)] = payload
+                s["have"][seq] = True
+                cost = self.args.sd_ms
+                s["since_save"] += 1
+                if s["since_save"] >= MAP_SAVE_EVERY:
+                    s["since_save"] = 0
+                    cost += self.args.map_ms
+                self.busy_until = time.monotonic() + cost / 1000
+            first = s["expected"]
+            while first < s["count"] and s["have"][first]:
+                first += 1
+            if first != s["expected"]:
+                s["expected"] = first
+                s["nak"] = False
+            if seq > s["expected"] and not s["nak"]:
+                s["nak"] = True
+                self._reply(link.NAK, s["expected"])
+            else:
+                self._reply(link.ACK, s["expected"])
+        elif frame_type == link.END:
+            if s["expected"] < s["count"]:
+                self._reply(link.NAK, s["expected"])
+                return
+            status = 0 if link.crc16(s["data"]) == s["crc"] else 1
+            self.session = None
+            self._reply(link.DONE, s["count"], bytes([status]) + struct.pack("<H", s["crc"]))
+        elif frame_type == link.ABORT:
+            self.session = None
+
+    def _resume(self, s):
+        bitmap = bytearray(MAX_CHUNKS // 8)
+        for i, have in enumerate(s["have"]):
+            if have:
+                bitmap[i >> 3] |= 1 << (i & 7)
+        return struct.pack("<I", min(s["expected"] * s["chunk"], s["size"])) + bytes(bitmap)
+
+
+def open_pty():
+    master, slave = pty.openpty()
+    tty.setraw(master)
+    os.set_blocking(master, False)
+    return master, os.ttyname(slave), slave
+
+
+async def serve(args):
+    master, path, _slave = open_pty()
+    device = StandIn(master, args)
+    device.start()
+    print(f"Firmware stand-in on {path}", flush=True)
+    print(f"  DISPENSER_SERIAL={path} python src/test.py", flush=True)
+    await asyncio.Event().wait()
+
+
+async def run_one(args, data, label, **uploader_args):
+    master, path, slave = open_pty()
+    device = StandIn(master, args)
+    device.start()
+    serial = link.SerialLink(path)
+    try:
+        uploader = link.Uploader(serial.write, write_size=args.write_size, **uploader_args)
+        serial.attach(uploader)
+        await uploader.send(data)
+    finally:
+        serial.close()
+        device.stop()
+        os.close(master)
+        os.close(slave)
+    stats = uploader.stats()
+    rate = len(data) / stats["elapsed_s"] if stats["elapsed_s"] else 0
+    print(f"{label:<22} {stats['elapsed_s']:>8.2f} {rate:>9.0f} {stats['retransmits']:>6} "
+          f"{device.lost_bytes:>6} {stats['srtt_ms'] or 0:>8.1f} {stats['window']:>6}")
+
+
+async def bench(args):
+    data = random.Random(args.seed).randbytes(args.size)
+    legacy = len(data) / 20 * 0.2
+    print(f"{len(data)} bytes, air {args.air_rate} B/s, SD {args.sd_ms} ms/chunk, write size {args.write_size}")
+    print(f"{'sender':<22} {'seconds':>8} {'B/s':>9} {'retx':>6} {'lost':>6} {'srtt_ms':>8} {'window':>6}")
+    print(f"{'fixed 0.2 s sleeps':<22} {legacy:>8.2f} {len(data) / legacy:>9.0f}      -      -        -      -")
+    await run_one(args, data, "stop and wait", window=1, max_window=1, bdp_cap=False)
+    await run_one(args, data, "fixed window of 8", window=8, max_window=8, bdp_cap=False)
+    await run_one(args, data, "adaptive (AIMD)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("mode", choices=["serve", "bench"])
+    parser.add_argument("--air-rate", type=int, default=2600, help="BLE payload bytes/s (default 2600)")
+    parser.add_argument("--module-buffer", type=int, default=256, help="BLE module buffer bytes")
+    parser.add_argument("--sd-ms", type=float, default=3.0, help="loop() time per chunk written")
+    parser.add_argument("--map-ms", type=float, default=12.0, help="extra time for a resume map save")
+    parser.add_argument("--reply-ms", type=float, default=15.0, help="device to host latency")
+    parser.add_argument("--size", type=int, default=8192, help="bench upload size")
+    parser.add_argument("--write-size", type=int, default=20, help="host write size (BLE MTU - 3)")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+    asyncio.run(serve(args) if args.mode == "serve" else bench(args))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,238 @@
+"""Convert PNG images into RLE-compressed, palette-indexed PROGMEM bitmaps.
+
+Each image is reduced to at most 16 RGB565 colours and encoded row by row:
+every byte is one run, palette index in the high nibble and (run length - 1)
+in the low nibble. Runs never cross a row boundary, so the firmware decoder
+(RleImage.cpp) can stream an image straight to the display without a frame
+or row buffer.
+
+Usage:
+    python tools/png2rle.py -o include/Assets.h assets/logo.png assets/battery_*.png
+    python tools/png2rle.py -o include/Prescription.h --width 120 pyproject/124.png
+
+Pillow is used when installed; otherwise a built-in decoder handles
+non-interlaced 8-bit PNGs, which is what the assets in this repo use.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import zlib
+
+MAX_COLORS = 16
+MAX_RUN = 16
+
+
+def read_png_builtin(path):
+    """Decode a non-interlaced 8-bit PNG into (width, height, rows of RGBA)."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise ValueError(f"{path}: not a PNG file")
+
+    pos = 8
+    idat = b""
+    palette = []
+    trns = b""
+    while pos < len(data):
+        length, ctype = struct.unpack(">I4s", data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if ctype == b"IHDR":
+            width, height, depth, color_type, _, _, interlace = struct.unpack(">IIBBBBB", body)
+        elif ctype == b"PLTE":
+            palette = [tuple(body[i:i + 3]) for i in range(0, len(body), 3)]
+        elif ctype == b"tRNS":
+            trns = body
+        elif ctype == b"IDAT":
+            idat += body
+        elif ctype == b"IEND":
+            break
+
+    if depth != 8 or interlace:
+        raise ValueError(f"{path}: only 8-bit non-interlaced PNGs are supported without Pillow")
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color_type]
+    stride = width * channels
+    raw = zlib.decompress(idat)
+
+    rows = []
+    prev = bytearray(stride)
+    for y in range(height):
+        offset = y * (stride + 1)
+        ftype = raw[offset]
+        line = bytearray(raw[offset + 1:offset + 1 + stride])
+        for i in range(stride):
+            left = line[i - channels] if i >= channels else 0
+            up = prev[i]
+            up_left = prev[i - channels] if i >= channels else 0
+            if ftype == 1:
+                line[i] = (line[i] + left) & 0xFF
+            elif ftype == 2:
+                line[i] = (line[i] + up) & 0xFF
+            elif ftype == 3:
+                line[i] = (line[i] + ((left + up) >> 1)) & 0xFF
+            elif ftype == 4:
+                p = left + up - up_left
+                pa, pb, pc = abs(p - left), abs(p - up), abs(p - up_left)
+                pred = left if pa <= pb and pa <= pc else (up if pb <= pc else up_left)
+                line[i] = (line[i] + pred) & 0xFF
+        prev = line
+
+        row = []
+        for x in range(width):
+            px = line[x * channels:(x + 1) * channels]
+            if color_type == 0:
+                row.append((px[0], px[0], px[0], 255))
+            elif color_type == 2:
+                row.append((px[0], px[1], px[2], 255))
+            elif color_type == 3:
+                alpha = trns[px[0]] if px[0] < len(trns) else 255
+                row.append(palette[px[0]] + (alpha,))
+            elif color_type == 4:
+                row.append((px[0], px[0], px[0], px[1]))
+            else:
+                row.append(tuple(px))
+        rows.append(row)
+    return width, height, rows
+
+
+def read_png(path):
+    try:
+        from PIL import Image
+    except ImportError:
+        return read_png_builtin(path)
+
+    img = Image.open(path).convert("RGBA")
+    width, height = img.size
+    px = list(img.getdata())
+    return width, height, [px[y * width:(y + 1) * width] for y in range(height)]
+
+
+def resize_nearest(width, height, rows, new_width):
+    if not new_width or new_width == width:
+        return width, height, rows
+    new_height = max(1, round(height * new_width / width))
+    out = []
+    for y in range(new_height):
+        src = rows[y * height // new_height]
+        out.append([src[x * width // new_width] for x in range(new_width)])
+    return new_width, new_height, out
+
+
+def to_rgb565(r, g, b):
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+
+def rgb565_parts(c):
+    return (c >> 11) << 3, ((c >> 5) & 0x3F) << 2, (c & 0x1F) << 3
+
+
+def flatten(rows, background):
+    """Blend alpha onto the background and convert every pixel to RGB565."""
+    br, bg, bb = background
+    out = []
+    for row in rows:
+        line = []
+        for r, g, b, a in row:
+            r = (r * a + br * (255 - a)) // 255
+            g = (g * a + bg * (255 - a)) // 255
+            b = (b * a + bb * (255 - a)) // 255
+            line.append(to_rgb565(r, g, b))
+        out.append(line)
+    return out
+
+
+def build_palette(pixels, max_colors):
+    """Keep the most frequent colours and map the rest to the nearest one."""
+    counts = {}
+    for row in pixels:
+        for c in row:
+            counts[c] = counts.get(c, 0) + 1
+    palette = [c for c, _ in sorted(counts.items(), key=lambda kv: (-kv[1], kv[0]))[:max_colors]]
+
+    parts = [rgb565_parts(c) for c in palette]
+    lookup = {}
+    for c in counts:
+        r, g, b = rgb565_parts(c)
+        lookup[c] = min(range(len(palette)),
+                        key=lambda i: (r - parts[i][0]) ** 2 + (g - parts[i][1]) ** 2 + (b - parts[i][2]) ** 2)
+    return palette, lookup
+
+
+def encode_rle(pixels, lookup):
+    out = bytearray()
+    for row in pixels:
+        x = 0
+        while x < len(row):
+            index = lookup[row[x]]
+            run = 1
+            while x + run < len(row) and run < MAX_RUN and lookup[row[x + run]] == index:
+                run += 1
+            out.append((index << 4) | (run - 1))
+            x += run
+    return bytes(out)
+
+
+def symbol_name(path):
+    base = os.path.splitext(os.path.basename(path))[0]
+    parts = [p for p in re.split(r"[^0-9A-Za-z]+", base) if p]
+    name = "".join(p[:1].upper() + p[1:] for p in parts)
+    return "img" + (name if not name[:1].isdigit() else "_" + name)
+
+
+def emit_image(name, width, height, palette, rle):
+    lines = [f"// {width}x{height}, {len(palette)} colours, {len(rle)} bytes RLE "
+             f"(raw RGB565 would be {width * height * 2})"]
+    lines.append(f"static const uint16_t {name}Palette[] PROGMEM = {{")
+    lines.append("    " + ", ".join(f"0x{c:04X}" for c in palette) + "};")
+    lines.append(f"static const uint8_t {name}Data[] PROGMEM = {{")
+    for i in range(0, len(rle), 16):
+        lines.append("    " + ", ".join(f"0x{b:02X}" for b in rle[i:i + 16]) + ",")
+    lines.append("};")
+    lines.append(f"static const RleImage {name} PROGMEM = {{{width}, {height}, {len(palette)}, "
+                 f"{name}Palette, {name}Data, sizeof({name}Data)}};")
+    return "\n".join(lines)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("images", nargs="+", help="PNG files to convert")
+    parser.add_argument("-o", "--output", required=True, help="header file to write")
+    parser.add_argument("--width", type=int, default=0, help="resize to this width (nearest neighbour)")
+    parser.add_argument("--colors", type=int, default=MAX_COLORS, help="palette size, at most 16")
+    parser.add_argument("--background", default="000000", help="RGB hex blended under transparent pixels")
+    args = parser.parse_args(argv)
+
+    if not 1 <= args.colors <= MAX_COLORS:
+        parser.error(f"--colors must be between 1 and {MAX_COLORS}")
+    background = tuple(int(args.background[i:i + 2], 16) for i in (0, 2, 4))
+
+    guard = re.sub(r"[^0-9A-Za-z]", "_", os.path.basename(args.output)).upper()
+    out = [f"// Generated by tools/png2rle.py - do not edit by hand.",
+           f"#ifndef {guard}",
+           f"#define {guard}",
+           "",
+           '#include "RleImage.h"',
+           ""]
+
+    for path in args.images:
+        width, height, rows = read_png(path)
+        width, height, rows = resize_nearest(width, height, rows, args.width)
+        pixels = flatten(rows, background)
+        palette, lookup = build_palette(pixels, args.colors)
+        rle = encode_rle(pixels, lookup)
+        name = symbol_name(path)
+        out.append(emit_image(name, width, height, palette, rle))
+        out.append("")
+        print(f"{path}: {name} {width}x{height}, {len(palette)} colours, "
+              f"{len(rle)} bytes ({width * height * 2} raw)", file=sys.stderr)
+
+    out.append("#endif")
+    with open(args.output, "w", newline="\n") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,246 @@
+/*
+ * Servo pulse jitter harness.
+ *
+ * Drives one servo on pin 46 and times its pulses with the input capture
+ * unit of timer 4 (ICP4, pin 49; jumper 46 -> 49). Capture latches the
+ * edge time in hardware, so the measurement itself is not disturbed by
+ * interrupt latency. Each phase collects PULSES_PER_PHASE pulses under a
+ * different load and reports width and period spread:
+ *   idle    - nothing else running
+ *   display - back to back full-screen fills on the TFT (SPI at 27 MHz)
+ *   serial  - Serial and Serial1 transmitting continuously at 115200
+ *   both    - display and serial together
+ *
+ * Build once per backend and compare the reports:
+ *   pio run -e servo_jitter_isr -t upload -t monitor
+ *   pio run -e servo_jitter_hw -t upload -t monitor
+ */
+#include <Arduino.h>
+#include <SPI.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_ST7789.h>
+#include <Servo.h>
+
+#define SD_CS 11
+#define TFT_CS 10
+#define TFT_RST 9
+#define TFT_DC 8
+#define SERVO_PIN 46
+#define CAPTURE_PIN 49            // ICP4
+
+#define TEST_PULSE_US 1500
+#define PULSES_PER_PHASE 500
+#define CAPTURE_QUEUE 16          // Must be a power of two
+#define TICKS_PER_US 16           // Timer 4 at clk/1
+
+#define PHASE_IDLE 0
+#define PHASE_DISPLAY 1
+#define PHASE_SERIAL 2
+#define PHASE_BOTH 3
+#define PHASE_COUNT 4
+
+Adafruit_ST7789 tft = Adafruit_ST7789(TFT_CS, TFT_DC, TFT_RST);
+Servo servo;
+
+struct Pulse
+{
+  uint32_t rise;                  // Rising edge, timer 4 ticks extended to 32 bits
+  uint16_t width;                 // Ticks
+};
+
+static volatile Pulse captureQueue[CAPTURE_QUEUE];
+static volatile uint8_t captureHead = 0;
+static volatile uint8_t captureTail = 0;
+static volatile uint16_t overflowCount = 0;
+static uint32_t pendingRise = 0;
+
+ISR(TIMER4_OVF_vect)
+{
+  overflowCount++;
+}
+
+ISR(TIMER4_CAPT_vect)
+{
+  uint16_t stamp = ICR4;
+  uint16_t high = overflowCount;
+  // An overflow that is still pending happened before this capture if the stamp is small
+  if ((TIFR4 & _BV(TOV4)) && stamp < 0x8000)
+    high++;
+  uint32_t now = ((uint32_t)high << 16) | stamp;
+
+  if (TCCR4B & _BV(ICES4))
+  {
+    pendingRise = now;
+    TCCR4B &= ~_BV(ICES4);        // Next: falling edge
+  }
+  else
+  {
+    uint8_t next = (captureHead + 1) & (CAPTURE_QUEUE - 1);
+    if (next != captureTail)
+    {
+      captureQueue[captureHead].rise = pendingRise;
+      captureQueue[captureHead].width = now - pendingRise;
+      captureHead = next;
+    }
+    TCCR4B |= _BV(ICES4);
+  }
+  TIFR4 = _BV(ICF4);              // Edge change can set a false capture flag
+}
+
+struct Stats
+{
+  uint16_t count;
+  uint16_t widthMin;
+  uint16_t widthMax;
+  uint32_t widthSum;
+  uint32_t periodMin;
+  uint32_t periodMax;
+  uint32_t lastRise;
+};
+
+static Stats stats;
+
+static void resetStats()
+{
+  stats.count = 0;
+  stats.widthMin = 0xFFFF;
+  stats.widthMax = 0;
+  stats.widthSum = 0;
+  stats.periodMin = 0xFFFFFFFF;
+  stats.periodMax = 0;
+  stats.lastRise = 0;
+
+  noInterrupts();
+  captureTail = captureHead;
+  interrupts();
+}
+
+static void drainCaptures()
+{
+  while (captureTail != captureHead)
+  {
+    Pulse p;
+    p.rise = captureQueue[captureTail].rise;
+    p.width = captureQueue[captureTail].width;
+    captureTail = (captureTail + 1) & (CAPTURE_QUEUE - 1);
+
+    if (stats.count < PULSES_PER_PHASE)
+    {
+      if (p.width < stats.widthMin)
+        stats.widthMin = p.width;
+      if (p.width > stats.widthMax)
+        stats.widthMax = p.width;
+      stats.widthSum += p.width;
+      if (stats.count > 0)
+      {
+        uint32_t period = p.rise - stats.lastRise;
+        if (period < stats.periodMin)
+          stats.periodMin = period;
+        if (period > stats.periodMax)
+          stats.periodMax = period;
+      }
+      stats.lastRise = p.rise;
+      stats.count++;
+    }
+  }
+}
+
+static void startCapture()
+{
+  pinMode(CAPTURE_PIN, INPUT);
+  noInterrupts();
+  TCCR4A = 0;                                 // Normal mode
+  TCCR4B = _BV(ICNC4) | _BV(ICES4) | _BV(CS40); // Noise canceler, rising edge, clk/1
+  TCNT4 = 0;
+  TIFR4 = _BV(ICF4) | _BV(TOV4);
+  TIMSK4 = _BV(ICIE4) | _BV(TOIE4);
+  interrupts();
+}
+
+static void printNs(uint32_t ticks)
+{
+  // 62.5 ns per tick
+  Serial.print(ticks * 125 / 2);
+  Serial.print(F(" ns"));
+}
+
+static void report(uint8_t phase)
+{
+  static const char *const names[PHASE_COUNT] = {"idle", "display", "serial", "both"};
+
+  Serial.print(names[phase]);
+  Serial.print(F(": width mean "));
+  printNs(stats.widthSum / stats.count);
+  Serial.print(F(", p-p "));
+  printNs(stats.widthMax - stats.widthMin);
+  Serial.print(F(" | period min "));
+  printNs(stats.periodMin);
+  Serial.print(F(", p-p "));
+  printNs(stats.periodMax - stats.periodMin);
+  Serial.println();
+}
+
+static void displayLoad()
+{
+  static uint16_t color = 0;
+  tft.fillScreen(color);
+  color += 0x0841;
+}
+
+static void serialLoad()
+{
+  // Keep both UART transmit buffers full so their UDRE interrupts run constantly
+  while (Serial.availableForWrite() > 8)
+    Serial.print(F("0123456"));
+  while (Serial1.availableForWrite() > 8)
+    Serial1.print(F("0123456"));
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial1.begin(115200);
+  pinMode(53, OUTPUT);
+  pinMode(SD_CS, OUTPUT);
+  digitalWrite(SD_CS, HIGH);
+
+  tft.init(240, 280);
+  tft.setRotation(1);
+  tft.setSPISpeed(27000000);
+
+  servo.attach(SERVO_PIN);
+  servo.writeMicroseconds(TEST_PULSE_US);
+  startCapture();
+
+#if defined(SERVO_HW_PWM)
+  Serial.println(F("\nServo jitter, hardware PWM backend"));
+#else
+  Serial.println(F("\nServo jitter, ISR backend"));
+#endif
+  Serial.print(PULSES_PER_PHASE);
+  Serial.print(F(" pulses per phase at "));
+  Serial.print(TEST_PULSE_US);
+  Serial.println(F(" us"));
+}
+
+void loop()
+{
+  for (uint8_t phase = 0; phase < PHASE_COUNT; phase++)
+  {
+    Serial.flush();
+    resetStats();
+    while (stats.count < PULSES_PER_PHASE)
+    {
+      if (phase == PHASE_DISPLAY || phase == PHASE_BOTH)
+        displayLoad();
+      if (phase == PHASE_SERIAL || phase == PHASE_BOTH)
+        serialLoad();
+      drainCaptures();
+    }
+    Serial.flush();
+    Serial.println();
+    report(phase);
+  }
+  Serial.println();
+  delay(5000);
+}